@@ -0,0 +1,96 @@
+#include "external_sort.hpp"
+#include "run_generator.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+// Сравнение способов сортировки чанка в памяти.
+// Использование: chunk_sort_bench [элементов в чанке] [повторов]
+namespace {
+
+struct Distribution {
+    std::string name;
+    int32_t min_value;
+    int32_t max_value;
+};
+
+std::vector<int32_t> randomChunk(std::size_t n, const Distribution& d, std::mt19937& gen) {
+    std::uniform_int_distribution<int32_t> dist(d.min_value, d.max_value);
+    std::vector<int32_t> data(n);
+    for (int32_t& value : data) {
+        value = dist(gen);
+    }
+    return data;
+}
+
+// Лучшее время из repeats запусков, в миллисекундах
+double bestTimeMs(const std::vector<int32_t>& source, ext_sort::RunFormation formation, std::size_t repeats) {
+    double best = std::numeric_limits<double>::max();
+    std::vector<int32_t> scratch;
+    for (std::size_t r = 0; r < repeats; ++r) {
+        std::vector<int32_t> chunk = source;
+
+        auto t0 = std::chrono::steady_clock::now();
+        if (formation == ext_sort::RunFormation::RadixSort) {
+            ext_sort::RadixSortChunk(chunk, scratch);
+        } else {
+            ext_sort::SortChunk(chunk, formation);
+        }
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - t0;
+
+        if (!std::is_sorted(chunk.begin(), chunk.end())) {
+            std::cerr << "Chunk is not sorted\n";
+            std::exit(1);
+        }
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    // По умолчанию - чанк в 50 МБ
+    std::size_t n = argc > 1 ? std::stoull(argv[1]) : 50 * 1024 * 1024 / sizeof(int32_t);
+    std::size_t repeats = argc > 2 ? std::stoull(argv[2]) : 3;
+
+    const std::vector<Distribution> distributions = {
+        {"full int32", std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::max()},
+        {"[-1e6, 1e6]", -1000000, 1000000},
+        {"[0, 255]", 0, 255},
+    };
+    const std::vector<std::pair<std::string, ext_sort::RunFormation>> kernels = {
+        {"std::sort", ext_sort::RunFormation::Sort},
+        {"heap sort", ext_sort::RunFormation::HeapSort},
+        {"radix sort", ext_sort::RunFormation::RadixSort},
+    };
+
+    std::cout << "Chunk: " << n << " elements (" << n * sizeof(int32_t) / (1024 * 1024) << " MB), "
+              << "best of " << repeats << "\n\n";
+
+    std::mt19937 gen(2025);
+    for (const Distribution& d : distributions) {
+        std::vector<int32_t> source = randomChunk(n, d, gen);
+        std::cout << d.name << ":\n";
+        for (const auto& [name, formation] : kernels) {
+            double ms = bestTimeMs(source, formation, repeats);
+            double rate = n / ms / 1000.0;
+            std::cout << "  " << std::left << std::setw(12) << name
+                      << std::right << std::fixed << std::setprecision(1)
+                      << std::setw(10) << ms << " ms"
+                      << std::setw(10) << rate << " M elements/s\n";
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,362 @@
+#include "delays.hpp"
+#include "external_sort.hpp"
+#include "file_tape.hpp"
+#include "tape.hpp"
+#include "temp_pool.hpp"
+
+#include "vector_tape.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Пропускная способность сортировок на лентах без задержек.
+// Использование: tape_sort_bench [--elements=N] [--memory=BYTES]
+//                                [--dist=uniform,sorted,reverse,few-unique,zipf]
+//                                [--tape=file,pooled,vector]
+//                                [--algo=chunk-merge,kway,distribution,counting-range,counting]
+// pooled - FileTape, временные файлы которой берутся из общего для всех запусков пула
+namespace {
+
+// Сколько прочитано и записано через ленты одного запуска
+struct IoStats {
+    std::size_t input_read = 0;
+    std::size_t temp_read = 0;
+    std::size_t temp_written = 0;
+};
+
+// Обёртка над лентой, считающая прочитанные и записанные ячейки.
+// Временные ленты и участки тоже оборачиваются и считаются как временные
+class MeteredTape : public Tape {
+public:
+    MeteredTape(std::unique_ptr<Tape> owned, Tape& tape, std::shared_ptr<IoStats> stats, bool temporary)
+        : owned_(std::move(owned))
+        , tape_(tape)
+        , stats_(std::move(stats))
+        , temporary_(temporary) {}
+
+    int32_t Read() override {
+        countRead(1);
+        return tape_.Read();
+    }
+
+    void Write(int32_t value) override {
+        countWrite(1);
+        tape_.Write(value);
+    }
+
+    std::size_t ReadBlock(int32_t* out, std::size_t n) override {
+        n = tape_.ReadBlock(out, n);
+        countRead(n);
+        return n;
+    }
+
+    std::size_t WriteBlock(const int32_t* in, std::size_t n) override {
+        n = tape_.WriteBlock(in, n);
+        countWrite(n);
+        return n;
+    }
+
+    bool Next() override { return tape_.Next(); }
+    bool Prev() override { return tape_.Prev(); }
+    bool Rewind(std::ptrdiff_t offset) override { return tape_.Rewind(offset); }
+    void Reset() override { tape_.Reset(); }
+
+    std::size_t Size() const override { return tape_.Size(); }
+    std::size_t Position() const override { return tape_.Position(); }
+    void SetMemoryLimit(std::size_t bytes) override { tape_.SetMemoryLimit(bytes); }
+
+    std::unique_ptr<Tape> OpenSection(std::size_t first, std::size_t length, std::size_t buffer_bytes) override {
+        std::unique_ptr<Tape> section = tape_.OpenSection(first, length, buffer_bytes);
+        return section ? wrap(std::move(section), temporary_) : nullptr;
+    }
+    bool SupportsSections() const override { return tape_.SupportsSections(); }
+
+    std::unique_ptr<Tape> CreateTemporary(std::size_t size, std::size_t buffer_bytes) const override {
+        return wrap(tape_.CreateTemporary(size, buffer_bytes), true);
+    }
+
+private:
+    std::unique_ptr<Tape> wrap(std::unique_ptr<Tape> tape, bool temporary) const {
+        Tape& ref = *tape;
+        return std::make_unique<MeteredTape>(std::move(tape), ref, stats_, temporary);
+    }
+
+    void countRead(std::size_t n) {
+        (temporary_ ? stats_->temp_read : stats_->input_read) += n;
+    }
+
+    void countWrite(std::size_t n) {
+        if (temporary_) {
+            stats_->temp_written += n;
+        }
+    }
+
+    std::unique_ptr<Tape> owned_;
+    Tape& tape_;
+    std::shared_ptr<IoStats> stats_;
+    bool temporary_;
+};
+
+struct Options {
+    std::size_t elements = 1 << 20;
+    std::size_t memory = 16 * 1024 * 1024;
+    std::vector<std::string> distributions = {"uniform", "sorted", "reverse", "few-unique", "zipf"};
+    std::vector<std::string> tapes = {"file", "vector"};
+    std::vector<std::string> algorithms = {"chunk-merge", "kway", "distribution", "counting-range", "counting"};
+};
+
+std::vector<std::string> splitList(const std::string& value) {
+    std::vector<std::string> items;
+    std::stringstream ss(value);
+    for (std::string item; std::getline(ss, item, ',');) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+Options parseOptions(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        std::size_t eq = arg.find('=');
+        std::string key = arg.substr(0, eq);
+        std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+
+        if (key == "--elements") {
+            options.elements = std::stoull(value);
+        } else if (key == "--memory") {
+            options.memory = std::stoull(value);
+        } else if (key == "--dist") {
+            options.distributions = splitList(value);
+        } else if (key == "--tape") {
+            options.tapes = splitList(value);
+        } else if (key == "--algo") {
+            options.algorithms = splitList(value);
+        } else {
+            throw std::runtime_error("Unknown option: " + arg);
+        }
+    }
+    return options;
+}
+
+std::vector<int32_t> generate(const std::string& distribution, std::size_t n) {
+    std::mt19937 gen(2025);
+    std::uniform_int_distribution<int32_t> full(std::numeric_limits<int32_t>::min(),
+                                                std::numeric_limits<int32_t>::max());
+    std::vector<int32_t> data(n);
+
+    if (distribution == "uniform" || distribution == "sorted" || distribution == "reverse") {
+        for (int32_t& value : data) {
+            value = full(gen);
+        }
+        if (distribution == "sorted") {
+            std::sort(data.begin(), data.end());
+        } else if (distribution == "reverse") {
+            std::sort(data.rbegin(), data.rend());
+        }
+    } else if (distribution == "few-unique") {
+        std::vector<int32_t> values(16);
+        for (int32_t& value : values) {
+            value = full(gen);
+        }
+        std::uniform_int_distribution<std::size_t> pick(0, values.size() - 1);
+        for (int32_t& value : data) {
+            value = values[pick(gen)];
+        }
+    } else if (distribution == "zipf") {
+        // Ранги 1..K с вероятностью ~ 1 / rank^s, ранг отображается в случайное значение
+        const std::size_t ranks = 1 << 16;
+        const double s = 1.1;
+        std::vector<double> cdf(ranks);
+        double sum = 0;
+        for (std::size_t r = 0; r < ranks; ++r) {
+            sum += 1.0 / std::pow(static_cast<double>(r + 1), s);
+            cdf[r] = sum;
+        }
+        std::vector<int32_t> values(ranks);
+        for (int32_t& value : values) {
+            value = full(gen);
+        }
+        std::uniform_real_distribution<double> uniform(0, sum);
+        for (int32_t& value : data) {
+            std::size_t rank = std::lower_bound(cdf.begin(), cdf.end(), uniform(gen)) - cdf.begin();
+            value = values[std::min(rank, ranks - 1)];
+        }
+    } else {
+        throw std::runtime_error("Unknown distribution: " + distribution);
+    }
+
+    return data;
+}
+
+void writeIntFile(const std::string& path, const std::vector<int32_t>& data) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(data.data()), data.size() * sizeof(int32_t));
+}
+
+// Пик RSS процесса (VmHWM) в КБ. resetPeakRss() сбрасывает его до текущего RSS
+void resetPeakRss() {
+    std::ofstream("/proc/self/clear_refs") << "5";
+}
+
+std::size_t peakRssKb() {
+    std::ifstream status("/proc/self/status");
+    for (std::string line; std::getline(status, line);) {
+        if (line.rfind("VmHWM:", 0) == 0) {
+            return std::stoull(line.substr(6));
+        }
+    }
+    return 0;
+}
+
+// Входная и выходная ленты одного запуска
+struct TapePair {
+    std::unique_ptr<Tape> input;
+    std::unique_ptr<Tape> output;
+};
+
+TapePair openTapes(const std::string& kind, const std::vector<int32_t>& data,
+                   const std::shared_ptr<TempTapePool>& pool) {
+    if (kind == "vector") {
+        return {std::make_unique<VectorTape>(data),
+                std::make_unique<VectorTape>(std::vector<int32_t>(data.size(), 0))};
+    }
+    if (kind == "file" || kind == "pooled") {
+        writeIntFile("tmp/bench_input.bin", data);
+        writeIntFile("tmp/bench_output.bin", std::vector<int32_t>(data.size(), 0));
+        Delays none{0, 0, 0, 0};
+        auto input = std::make_unique<FileTape>("tmp/bench_input.bin", none);
+        if (kind == "pooled") {
+            input->SetTemporaryPool(pool);
+        }
+        return {std::move(input), std::make_unique<FileTape>("tmp/bench_output.bin", none)};
+    }
+    throw std::runtime_error("Unknown tape: " + kind);
+}
+
+std::function<void(Tape&, Tape&)> algorithm(const std::string& name, const std::vector<int32_t>& data,
+                                            std::size_t memory) {
+    if (name == "chunk-merge") {
+        return [memory](Tape& in, Tape& out) {
+            ext_sort::ChunkMergeSort(in, out, memory, ext_sort::RunFormation::Sort);
+        };
+    }
+    if (name == "kway") {
+        return [memory](Tape& in, Tape& out) {
+            ext_sort::KWayMergeSort(in, out, memory, ext_sort::RunFormation::Sort, 16, false);
+        };
+    }
+    if (name == "distribution") {
+        return [memory](Tape& in, Tape& out) {
+            ext_sort::DistributionSort(in, out, memory, ext_sort::RunFormation::Sort);
+        };
+    }
+    if (name == "counting-range") {
+        auto [lo, hi] = std::minmax_element(data.begin(), data.end());
+        int32_t min_value = data.empty() ? 0 : *lo;
+        int32_t max_value = data.empty() ? 0 : *hi;
+        return [memory, min_value, max_value](Tape& in, Tape& out) {
+            ext_sort::CountingSort(in, out, memory, min_value, max_value);
+        };
+    }
+    if (name == "counting") {
+        return [memory](Tape& in, Tape& out) {
+            ext_sort::CountingSort(in, out, memory);
+        };
+    }
+    throw std::runtime_error("Unknown algorithm: " + name);
+}
+
+bool isSorted(Tape& tape) {
+    tape.Reset();
+    std::vector<int32_t> data(tape.Size());
+    tape.ReadBlock(data.data(), data.size());
+    tape.Reset();
+    return std::is_sorted(data.begin(), data.end());
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    try {
+        options = parseOptions(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+
+    std::filesystem::create_directory("tmp");
+
+    double data_mb = options.elements * sizeof(int32_t) / (1024.0 * 1024.0);
+    std::cout << "Elements: " << options.elements << " (" << std::fixed << std::setprecision(1)
+              << data_mb << " MB), memory limit: " << options.memory << " bytes\n\n";
+    std::cout << std::left << std::setw(8) << "tape" << std::setw(12) << "dist" << std::setw(16) << "algorithm"
+              << std::right << std::setw(10) << "MB/s" << std::setw(14) << "temp MB w"
+              << std::setw(14) << "temp MB r" << std::setw(8) << "passes" << std::setw(14) << "peak RSS MB"
+              << "\n";
+
+    try {
+        auto pool = std::make_shared<TempTapePool>("tmp/bench_pool");
+        for (const std::string& distribution : options.distributions) {
+            std::vector<int32_t> data = generate(distribution, options.elements);
+            for (const std::string& tape_kind : options.tapes) {
+                for (const std::string& name : options.algorithms) {
+                    auto sort = algorithm(name, data, options.memory);
+                    TapePair tapes = openTapes(tape_kind, data, pool);
+
+                    auto stats = std::make_shared<IoStats>();
+                    MeteredTape input(nullptr, *tapes.input, stats, false);
+
+                    resetPeakRss();
+                    auto t0 = std::chrono::steady_clock::now();
+                    sort(input, *tapes.output);
+                    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - t0;
+                    std::size_t rss_kb = peakRssKb();
+
+                    if (!isSorted(*tapes.output)) {
+                        std::cerr << "Error: " << name << " on " << distribution << " left output unsorted\n";
+                        return 1;
+                    }
+
+                    // Проходы - сколько раз данные целиком прочитаны со входа и временных лент
+                    double cells = std::max<std::size_t>(options.elements, 1);
+                    double to_mb = sizeof(int32_t) / (1024.0 * 1024.0);
+                    std::cout << std::left << std::setw(8) << tape_kind << std::setw(12) << distribution
+                              << std::setw(16) << name << std::right << std::fixed << std::setprecision(1)
+                              << std::setw(10) << data_mb / elapsed.count()
+                              << std::setw(14) << stats->temp_written * to_mb
+                              << std::setw(14) << stats->temp_read * to_mb
+                              << std::setw(8) << (stats->input_read + stats->temp_read) / cells
+                              << std::setw(14) << rss_kb / 1024.0 << "\n";
+                }
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+
+    std::filesystem::remove("tmp/bench_input.bin");
+    std::filesystem::remove("tmp/bench_output.bin");
+    return 0;
+}
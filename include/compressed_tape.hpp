@@ -0,0 +1,115 @@
+#pragma once
+
+#include "delays.hpp"
+#include "metrics.hpp"
+#include "tape.hpp"
+#include "temp_pool.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Временная лента со сжатием для промежуточных серий.
+// Ячейки хранятся в файле блоками по block_cells: первое значение блока,
+// дальше разности соседних значений в zigzag-кодировании, из которых вычтен
+// их минимум (frame of reference) и упакованные по числу бит наибольшей.
+// У отсортированных серий разности малы, и блок занимает в 2-4 раза меньше.
+// Буфер ленты - один раскодированный блок; блок, который начали писать с первой
+// ячейки, не читается с носителя. Участков и async_io нет.
+// Кроме буфера, в памяти - таблица мест блоков: 16 байт на блок, то есть
+// не больше 1/256 объёма ленты в int32 (блок не короче MIN_BLOCK_CELLS)
+class CompressedTape : public Tape {
+public:
+    // Короче блоки не делаем: иначе на каждую ячейку - вызов ввода-вывода и место
+    // в таблице блоков, а сжимать нечего
+    static constexpr std::size_t MIN_BLOCK_CELLS = 1024;
+
+    // Создаёт пустой (из нулей) файл filename на size ячеек, удаляет его при закрытии.
+    // Размер блока - половина buffer_bytes (вторая половина - под сжатый блок),
+    // но не меньше MIN_BLOCK_CELLS ячеек, и дальше не меняется: лимит памяти
+    // только сбрасывает буфер. Счётчики при закрытии дописываются в temporaries.
+    // Временные ленты от этой создаются в каталоге pool (nullptr => в tmp/)
+    CompressedTape(const std::string& filename,
+                   std::size_t size,
+                   const Delays& delays,
+                   std::size_t buffer_bytes,
+                   std::shared_ptr<MetricsSink> temporaries,
+                   std::shared_ptr<TempTapePool> pool = nullptr);
+    ~CompressedTape() override;
+
+    int32_t Read() override;
+    void Write(int32_t value) override;
+    std::size_t ReadBlock(int32_t* out, std::size_t n) override;
+    std::size_t ReadBlockBackward(int32_t* out, std::size_t n) override;
+    std::size_t WriteBlock(const int32_t* in, std::size_t n) override;
+
+    bool Next() override;
+    bool Prev() override;
+    bool Rewind(std::ptrdiff_t offset) override;
+
+    std::size_t Size() const override;
+    std::size_t Position() const override;
+
+    // Размер блока задан при создании; лимит только решает, держать ли буфер
+    void SetMemoryLimit(std::size_t bytes) override;
+    std::unique_ptr<Tape> CreateTemporary(std::size_t size,
+                                          std::size_t buffer_bytes) const override;
+
+    TapeMetrics Metrics() override;
+    TapeMetrics TemporaryMetrics() const override;
+
+    // Сколько байт сейчас занимает файл ленты
+    std::size_t StoredBytes() const;
+
+private:
+    // Место блока в файле. bytes == 0 => блок ещё не писали (нули)
+    struct Slot {
+        uint64_t offset = 0;
+        uint32_t bytes = 0;
+        uint32_t capacity = 0;
+    };
+
+    // Делает текущим блок с ячейкой cell. from_start => его будут писать
+    // с первой ячейки, и старое содержимое можно не читать
+    void loadBlock(std::size_t cell, bool from_start);
+    // Дочитывает с носителя ячейки текущего блока начиная с valid_
+    void completeBlock();
+    void flushBlock();
+    void readSlot(std::size_t block, std::vector<int32_t>& cells);
+    void storeSlot(std::size_t block);
+    std::size_t blockCells(std::size_t block) const; // последний блок бывает короче
+
+    void shiftAfterBlock(std::size_t n, std::size_t op_delay_ms);
+    void shiftBackAfterBlock(std::size_t n, std::size_t op_delay_ms);
+    void applyDelay(std::size_t ms);
+
+    std::FILE* file_ = nullptr;
+    std::string filename_;
+    std::size_t size_ = 0;
+    std::size_t position_ = 0;
+
+    Delays delays_;
+    std::size_t busy_until_ = 0; // виртуальное время, до которого лента занята
+
+    std::size_t block_cells_ = 1;
+    std::vector<Slot> slots_;
+    uint64_t file_end_ = 0;
+
+    static constexpr std::size_t NO_BLOCK = static_cast<std::size_t>(-1);
+    std::vector<int32_t> buffer_;    // раскодированный блок buffer_block_
+    std::size_t buffer_block_ = NO_BLOCK;
+    std::size_t valid_ = 0;          // ячейки буфера [0, valid_) актуальны, дальше - на носителе
+    bool buffer_dirty_ = false;
+    std::vector<uint8_t> encoded_;   // сжатый блок при чтении и записи
+
+    TapeMetrics metrics_;
+    std::shared_ptr<MetricsSink> temporaries_;
+    std::shared_ptr<TempTapePool> pool_;
+
+    static std::atomic<std::size_t> tmp_counter_; // для имён временных лент
+};
@@ -7,6 +7,27 @@
 
 #include <optional>
 #include <string>
+#include <vector>
+
+// Способ слияния серий, если value_range не задан
+enum class MergeMode {
+    Binary,      // ChunkMergeSort: попарное слияние через чётные/нечётные ленты
+    KWay,        // KWayMergeSort: сбалансированное k-путевое слияние
+    Polyphase,   // KWayMergeSort: многофазное слияние с распределением Фибоначчи
+    Alternating, // AlternatingMergeSort: попарное слияние без перемоток между проходами
+    Distribution // DistributionSort: раскладка по корзинам вместо слияния
+};
+
+// Формат ячейки входного файла. Кроме int32, все сортируются RecordMergeSort
+// (record_sort.hpp) по ключу записи
+enum class RecordFormat {
+    Int32,     // int32: все алгоритмы
+    Int64,
+    UInt64,
+    Float,     // ключ - биты в полном порядке IEEE 754 (NaN - по краям)
+    Double,
+    KeyValue64 // 8 байт ключа uint64 и 8 байт нагрузки
+};
 
 /// Настройки для FileTape и алгоритмов сортировки, загружаемые из YAML-конфига
 struct Config {
@@ -14,10 +35,75 @@ struct Config {
 
     std::size_t memory_limit_bytes;
 
+    // true => FileTape делит буфер на два и читает/пишет окна в фоновом потоке
+    bool async_io;
+
+    // true => ленты отображаются в память (MmapTape) вместо FileTape
+    bool mmap_tapes;
+
+    // true => временные ленты FileTape хранят серии сжатыми (CompressedTape)
+    bool compress_temporaries;
+
+    // Каталог файлов временных лент FileTape (пул temp_pool.hpp: файлы переиспользуются
+    // между проходами) и сколько файлов размером со вход разместить в нём заранее
+    std::string temp_dir;
+    std::size_t temp_preallocate;
+
     // false => std::sort для сортировки чанков, глубина стека - O(log n)
     // true  => heap_sort для сортировки чанков, глубина стека - O(1)
     bool strict_stack_limit;
 
+    // true => LSD radix sort для сортировки чанков (быстрее на больших чанках,
+    //         но чанк вдвое меньше: половина буфера - рабочая)
+    bool radix_sort;
+
+    // true => начальные серии формируются выбором с замещением (без сортировки чанков),
+    //         серии в среднем вдвое длиннее буфера
+    bool replacement_selection;
+
+    // true => естественные серии: упорядоченный вход копируется в выход без слияния,
+    //         упорядоченные чанки не сортируются и продолжают текущую серию
+    bool natural_runs;
+
+    // Сколько потоков сортируют чанки при формировании серий
+    std::size_t threads;
+
+    // Способ слияния и максимальное число одновременно открытых временных лент
+    MergeMode merge_mode;
+    std::size_t max_tapes;
+
+    // true => алгоритм, способ формирования серий и k выбираются по оценке
+    //         задержек лент (planner.hpp), остальные опции выбора игнорируются
+    bool auto_plan;
+
+    // Формат записи входного файла
+    RecordFormat record_format;
+
+    // true => записи с равными ключами сохраняют исходный порядок (для форматов записей)
+    bool stable;
+
+    // Для int32: > 0 => в выход пишутся только top_k наименьших значений по возрастанию
+    // (top_k_largest => наибольших по убыванию), PartialSort
+    std::size_t top_k;
+    bool top_k_largest;
+
+    // Для int32: непусто => вместо сортировки в выход пишутся квантили входа
+    // (Quantiles, значения из [0, 1]) в том же порядке
+    std::vector<double> quantiles;
+
+    // Для int32: куда записать исходные позиции отсортированных значений (uint64 на
+    // значение, ArgSort). Пусто => только сортировка
+    std::string index_file;
+
+    // Для int32: true => в выход пишутся только различные значения по возрастанию.
+    // counts_file непуст => и столько раз, сколько каждое встретилось (uint64 на
+    // значение, как sort | uniq -c), distinct тогда подразумевается
+    bool distinct;
+    std::string counts_file;
+
+    // Куда записать счётчики лент и длительности этапов в JSON (пусто => не записывать)
+    std::string metrics_file;
+
     // Диапазон значений для Counting Sort (опционально)
     std::optional<int32_t> value_min;
     std::optional<int32_t> value_max;
@@ -8,4 +8,7 @@ struct Delays {
     std::size_t write_ms;
     std::size_t shift_ms;        // сдвиг на одну ячейку
     std::size_t rewind_ms;       // перемотка на произвольное число ячеек
+
+    // true => задержки не выдерживаются, а только учитываются в VirtualClock
+    bool virtual_time = false;
 };
@@ -5,16 +5,88 @@
 #include <cstddef>
 #include <cstdint>
 
+#include <vector>
+
 namespace ext_sort {
 
+// Способ формирования начальных отсортированных серий
+enum class RunFormation {
+    Sort,                 // std::sort чанка, глубина стека - O(log n)
+    HeapSort,             // heap sort чанка, глубина стека - O(1)
+    RadixSort,            // LSD radix sort чанка по байтам, глубина стека - O(1);
+                          // нужен рабочий буфер размером с чанк, поэтому чанк вдвое меньше
+    ReplacementSelection, // выбор с замещением: серии разной длины, в среднем
+                          // вдвое длиннее буфера, на упорядоченных данных - одна
+    NaturalRuns           // естественные серии: уже упорядоченный чанк не сортируется,
+                          // упорядоченный по убыванию - разворачивается, и чанк продолжает
+                          // текущую серию, если не меньше её конца. Сортировки перед этим
+                          // проверяют, не упорядочен ли вход целиком (CopyIfPresorted)
+};
+
+// Статистика слияния: по ней видно, сколько раз данные прошли через временные ленты
+struct MergeStats {
+    std::size_t runs = 0;            // число начальных серий
+    std::size_t fan_in = 0;          // сколько серий сливается за раз
+    std::size_t passes = 0;          // число проходов (фаз) слияния
+    std::size_t merged_elements = 0; // сколько элементов записано при слиянии
+    std::size_t output_elements = 0; // сколько записей в выходе (RecordMergeSort: меньше входа,
+                                     // если равные объединялись)
+};
+
+// Во все сортировки можно передать profile: туда по порядку записываются
+// длительности этапов (формирование серий, проходы слияния и подсчёта)
+
 // Cортировка подсчётом без заранее известного диапазона
-void CountingSort(Tape& input, Tape& output, std::size_t memory_limit_bytes);
+void CountingSort(Tape& input, Tape& output, std::size_t memory_limit_bytes,
+                  SortProfile* profile = nullptr);
 
 // Сортировка подсчётом с заранее известным диапазоном [value_min, value_max]
 void CountingSort(Tape& input, Tape& output,
                   std::size_t memory_limit_bytes,
                   int32_t value_min,
-                  int32_t value_max);
+                  int32_t value_max,
+                  SortProfile* profile = nullptr);
+
+// Группировка подсчётом (sort | uniq -c): в output - различные значения входа
+// по возрастанию, в counts (nullptr => не пишутся) - сколько раз каждое встретилось,
+// counts[i] - для output[i]. Счётчики пишутся как есть, без развёртывания в повторы;
+// без counts ленты-разделы получают посчитанное значение один раз.
+// Возвращает число различных значений
+std::size_t CountingGroup(Tape& input, Tape& output, BasicTape<uint64_t>* counts,
+                          std::size_t memory_limit_bytes,
+                          SortProfile* profile = nullptr);
+
+// То же с заранее известным диапазоном [value_min, value_max]
+std::size_t CountingGroup(Tape& input, Tape& output, BasicTape<uint64_t>* counts,
+                          std::size_t memory_limit_bytes,
+                          int32_t value_min,
+                          int32_t value_max,
+                          SortProfile* profile = nullptr);
+
+// Пределы CountingSort при таком лимите памяти (для оценки числа проходов)
+struct CountingLimits {
+    std::size_t dense_values;    // диапазон такой ширины считается плотными счётчиками
+    std::size_t distinct_values; // столько различных значений помещается в разреженную гистограмму
+    std::size_t partitions;      // на сколько разделов (не больше) делится вход, если не поместилось
+};
+
+CountingLimits CountingSortLimits(std::size_t memory_limit_bytes);
+
+// Элементы входа с рангами ranks (0 - наименьший) без сортировки, в порядке ranks.
+// Каждый проход по входу сужает отрезок значений каждого ранга до одной корзины
+// гистограммы; отрезок, элементы которого помещаются в память, собирается
+// целиком. Все ранги ищутся в одних и тех же проходах, обычно их два-три.
+// Ранг за пределами входа - std::runtime_error
+std::vector<int32_t> Select(Tape& input,
+                            const std::vector<std::size_t>& ranks,
+                            std::size_t memory_limit_bytes,
+                            SortProfile* profile = nullptr);
+
+// Квантили q из [0, 1] через Select: элемент с рангом floor(q * (N - 1))
+std::vector<int32_t> Quantiles(Tape& input,
+                               const std::vector<double>& quantiles,
+                               std::size_t memory_limit_bytes,
+                               SortProfile* profile = nullptr);
 
 // Сначала сортируем чанки с помощью heap/std sort
 // После сливаем их, как в MergeSort
@@ -22,4 +94,76 @@ void ChunkMergeSort(Tape& input, Tape& output,
                     std::size_t memory_limit_bytes,
                     bool use_heap_sort);
 
+// То же с явным выбором способа формирования серий.
+// threads > 1 => чанки сортируются параллельно в пределах того же лимита памяти,
+// а проходы слияния делятся между потоками, если ленты поддерживают OpenSection
+void ChunkMergeSort(Tape& input, Tape& output,
+                    std::size_t memory_limit_bytes,
+                    RunFormation formation,
+                    std::size_t threads = 1,
+                    SortProfile* profile = nullptr);
+
+// ChunkMergeSort без перемоток между проходами: каждый проход читает серии
+// с конца лент назад (Prev) и пишет результат вперёд, так что направление
+// упорядоченности серий чередуется. Перематываются только входная и выходная ленты
+// и, при чётном числе проходов, последняя временная. Слияние - в одном потоке
+void AlternatingMergeSort(Tape& input, Tape& output,
+                          std::size_t memory_limit_bytes,
+                          RunFormation formation,
+                          std::size_t threads = 1,
+                          SortProfile* profile = nullptr);
+
+// То же, но серии сливаются k-путевым слиянием через дерево проигравших.
+// k выбирается по memory_limit_bytes и max_tapes (число временных лент).
+// polyphase => серии распределяются по числам Фибоначчи и сливаются
+// многофазно на k+1 лентах, иначе сбалансированно на 2k лентах
+MergeStats KWayMergeSort(Tape& input, Tape& output,
+                         std::size_t memory_limit_bytes,
+                         RunFormation formation,
+                         std::size_t max_tapes,
+                         bool polyphase,
+                         std::size_t threads = 1,
+                         SortProfile* profile = nullptr);
+
+// K наименьших (largest => наибольших) элементов входа, без сортировки остальных:
+// первые min(K, N) ячеек output, наименьшие - по возрастанию, наибольшие - по убыванию.
+// Если K элементов помещаются в половину памяти - один проход по входу с кучей из K
+// элементов. Иначе серии сливаются как в KWayMergeSort (сбалансированно, k по памяти
+// и max_tapes), но каждая слитая серия обрезается до K элементов, а последнее
+// слияние останавливается после K-го
+MergeStats PartialSort(Tape& input, Tape& output,
+                       std::size_t k,
+                       std::size_t memory_limit_bytes,
+                       bool largest = false,
+                       std::size_t max_tapes = 16,
+                       SortProfile* profile = nullptr);
+
+// Статистика DistributionSort
+struct DistributionStats {
+    std::size_t buckets = 0;              // корзин, отсортированных в памяти или из равных значений
+    std::size_t passes = 0;               // наибольшая глубина раскладки по корзинам
+    std::size_t distributed_elements = 0; // сколько элементов прошло через раскладку
+};
+
+// Распределяющая сортировка (sample sort): по выборке со входа выбираются
+// разделители, и вход за один проход раскладывается по лентам-корзинам
+// (CreateTemporary). Корзины, помещающиеся в память, сортируются в ней сразу
+// в output, остальные раскладываются так же рекурсивно. Значения, равные
+// разделителю, только считаются и на ленты не пишутся. На равномерных данных -
+// раскладка и чтение корзин, то есть два прохода. threads > 1 => соседние
+// корзины сортируются параллельно в пределах того же лимита памяти.
+// formation: выбор с замещением и естественные серии заменяются сортировкой
+DistributionStats DistributionSort(Tape& input, Tape& output,
+                                   std::size_t memory_limit_bytes,
+                                   RunFormation formation,
+                                   std::size_t threads = 1,
+                                   SortProfile* profile = nullptr);
+
+// Сколько серий за раз сливает KWayMergeSort при таких параметрах
+// и ожидаемом числе начальных серий
+std::size_t MergeFanIn(std::size_t memory_limit_bytes,
+                       std::size_t max_tapes,
+                       bool polyphase,
+                       std::size_t estimated_runs);
+
 } // namespace ext_sort
\ No newline at end of file
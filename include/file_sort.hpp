@@ -3,14 +3,27 @@
 #include "config.hpp"
 #include "external_sort.hpp"
 #include "file_tape.hpp"
+#include "mmap_tape.hpp"
+#include "planner.hpp"
+#include "record.hpp"
+#include "record_sort.hpp"
+#include "record_tape.hpp"
+#include "stream_sort.hpp"
+#include "stream_tape.hpp"
+#include "temp_pool.hpp"
+#include "virtual_clock.hpp"
 
 #include <cstdio>
 
+#include <algorithm>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <memory>
 #include <string>
 
 static const size_t kPrefixSize = 20; 
+static const size_t kPlanSampleSize = 4096; // сколько элементов входа (по всей ленте) смотрит планировщик
 
 void PrintTape(Tape& tape, size_t limit = kPrefixSize) {
     auto old_pos = tape.Position();
@@ -32,7 +45,270 @@ void PrintTape(Tape& tape, size_t limit = kPrefixSize) {
 }
 
 namespace ext_sort {
-// Файл в формате FileTape - последовательно записанные int32
+
+RunFormation ChooseRunFormation(const Config& cfg) {
+    if (cfg.replacement_selection) {
+        return RunFormation::ReplacementSelection;
+    }
+    if (cfg.natural_runs) {
+        return RunFormation::NaturalRuns;
+    }
+    if (cfg.radix_sort) {
+        return RunFormation::RadixSort;
+    }
+    return cfg.strict_stack_limit ? RunFormation::HeapSort : RunFormation::Sort;
+}
+
+// Лента поверх файла: через mmap или через буферизованный stdio.
+// Временные ленты берут файлы из pool (nullptr => создают свои в tmp/)
+std::unique_ptr<Tape> OpenTape(const std::string& path, const Config& cfg,
+                               std::shared_ptr<TempTapePool> pool = nullptr) {
+    if (cfg.mmap_tapes) {
+        auto tape = std::make_unique<MmapTape>(path, cfg.delays);
+        tape->SetTemporaryPool(std::move(pool));
+        return tape;
+    }
+    auto tape = std::make_unique<FileTape>(path, cfg.delays, 0, cfg.async_io, cfg.compress_temporaries);
+    tape->SetTemporaryPool(std::move(pool));
+    return tape;
+}
+
+void PrintMergeStats(const MergeStats& stats) {
+    std::cerr << "Initial runs: " << stats.runs
+              << ", fan-in: " << stats.fan_in
+              << ", merge passes: " << stats.passes
+              << ", merged elements: " << stats.merged_elements << "\n\n";
+}
+
+// Оценивает варианты сортировки, печатает их и выполняет самый дешёвый
+void SortByPlan(Tape& input_tape, Tape& output_tape, const Config& cfg, SortProfile& profile) {
+    PlanInput plan_input{
+        cfg.delays,
+        cfg.memory_limit_bytes,
+        input_tape.Size(),
+        cfg.max_tapes,
+        cfg.threads,
+        ChooseRunFormation(cfg),
+        cfg.value_min,
+        cfg.value_max,
+        SampleTape(input_tape, kPlanSampleSize)
+    };
+    std::vector<SortPlan> plans = EstimatePlans(plan_input);
+
+    std::cerr << "Sort plans, cheapest first:\n";
+    for (const SortPlan& plan : plans) {
+        std::cerr << "  " << DescribePlan(plan) << "\n";
+    }
+    const SortPlan& plan = plans.front();
+    std::cerr << "\nSelected plan: " << DescribePlan(plan) << "\n\n";
+    std::cerr << "Starting sorting...\n\n";
+
+    switch (plan.strategy) {
+    case Strategy::Counting:
+        if (cfg.value_min.has_value() && cfg.value_max.has_value()) {
+            CountingSort(input_tape, output_tape, cfg.memory_limit_bytes,
+                         *cfg.value_min, *cfg.value_max, &profile);
+        } else {
+            CountingSort(input_tape, output_tape, cfg.memory_limit_bytes, &profile);
+        }
+        break;
+    case Strategy::ChunkMerge:
+        ChunkMergeSort(input_tape, output_tape, cfg.memory_limit_bytes,
+                       plan.formation, cfg.threads, &profile);
+        break;
+    case Strategy::AlternatingMerge:
+        AlternatingMergeSort(input_tape, output_tape, cfg.memory_limit_bytes,
+                             plan.formation, cfg.threads, &profile);
+        break;
+    case Strategy::KWayMerge:
+        // k задаём через число лент сбалансированного слияния
+        PrintMergeStats(KWayMergeSort(input_tape, output_tape, cfg.memory_limit_bytes,
+                                      plan.formation, std::max<std::size_t>(2 * plan.fan_in, 4),
+                                      false, cfg.threads, &profile));
+        break;
+    }
+}
+
+// Выходной файл размером bytes
+void CreateOutputFile(const std::string& output_file, std::size_t bytes) {
+    std::FILE* out_f = std::fopen(output_file.c_str(), "wb");
+    if (!out_f) {
+        throw std::runtime_error("Failed to create output file: " + output_file);
+    }
+    if (bytes > 0) {
+        if (std::fseek(out_f, static_cast<long>(bytes - 1), SEEK_SET) != 0 ||
+            std::fputc(0, out_f) == EOF) {
+            std::fclose(out_f);
+            throw std::runtime_error("Failed to allocate space for output file");
+        }
+    }
+    std::fclose(out_f);
+}
+
+// Время лент и, если задан metrics_file, отчёт. Временные ленты к этому моменту закрыты и отчитались
+// extra_temporary - счётчики временных лент, созданных не через input/output
+template <typename Cell>
+void ReportMetrics(const Config& cfg, const SortProfile& profile,
+                   BasicTape<Cell>& input_tape, BasicTape<Cell>& output_tape,
+                   const TapeMetrics& extra_temporary = {}) {
+    std::cerr << "Virtual tape time: " << VirtualClock::Now() << " ms"
+              << (cfg.delays.virtual_time ? " (delays simulated)" : "") << "\n";
+
+    if (!cfg.metrics_file.empty()) {
+        TapeMetrics temporary = input_tape.TemporaryMetrics();
+        temporary += output_tape.TemporaryMetrics();
+        temporary += extra_temporary;
+        std::ofstream metrics(cfg.metrics_file);
+        if (!metrics) {
+            throw std::runtime_error("Failed to create metrics file: " + cfg.metrics_file);
+        }
+        metrics << MetricsJson(profile, {
+            {"input", input_tape.Metrics()},
+            {"output", output_tape.Metrics()},
+            {"temporary", temporary}
+        }, VirtualClock::Now());
+        std::cerr << "Metrics: " << cfg.metrics_file << "\n";
+    }
+}
+
+// Файл из записей Record: сортировка по ключу KeyOf через RecordMergeSort
+template <typename Record, typename KeyOf>
+void RecordFileSort(const std::string& input_file, const std::string& output_file, const Config& cfg,
+                    std::shared_ptr<TempTapePool> pool) {
+    RecordFileTape<Record> input_tape(input_file, cfg.delays);
+    input_tape.SetTemporaryPool(std::move(pool));
+    std::cerr << "Input tape is loaded: " << input_tape.Size() << " records of "
+              << sizeof(Record) << " bytes\n\n";
+
+    CreateOutputFile(output_file, input_tape.Size() * sizeof(Record));
+    RecordFileTape<Record> output_tape(output_file, cfg.delays);
+
+    std::cerr << "Selected sorting algorithm: Record K-way Merge Sort\n\n";
+    std::cerr << "Starting sorting...\n\n";
+
+    SortProfile profile;
+    VirtualClock::Set(0);
+    PrintMergeStats(RecordMergeSort<Record, KeyOf>(input_tape, output_tape, cfg.memory_limit_bytes,
+                                                   cfg.max_tapes, cfg.stable, &profile));
+    ReportMetrics(cfg, profile, input_tape, output_tape);
+
+    std::cerr << "Result: " << output_file << "\n";
+}
+
+// Сортировка int32 с записью исходных позиций в cfg.index_file (ArgSort)
+void ArgSortFile(Tape& input_tape, Tape& output_tape, const Config& cfg,
+                 const std::shared_ptr<TempTapePool>& pool, SortProfile& profile) {
+    CreateOutputFile(cfg.index_file, input_tape.Size() * sizeof(uint64_t));
+    RecordFileTape<uint64_t> positions(cfg.index_file, cfg.delays);
+
+    std::cerr << "Selected sorting algorithm: Stable ArgSort (K-way Merge Sort)\n\n";
+    std::cerr << "Starting sorting...\n\n";
+
+    auto sink = std::make_shared<MetricsSink>();
+    TemporaryFactory<IndexedValue> make_temporary = [&cfg, sink, pool](std::size_t size,
+                                                                       std::size_t buffer_bytes) {
+        return RecordFileTape<IndexedValue>::CreateTemporaryFile("argsort", size, buffer_bytes,
+                                                                 cfg.delays, sink, pool);
+    };
+    PrintMergeStats(ArgSort(input_tape, output_tape, positions, cfg.memory_limit_bytes,
+                            cfg.max_tapes, make_temporary, &profile));
+
+    ReportMetrics(cfg, profile, input_tape, output_tape, sink->Total());
+}
+
+// Группировка int32: различные значения - в output_tape, сколько раз каждое
+// встретилось - в cfg.counts_file (если задан). При value_range - подсчётом
+// (CountingGroup), иначе слиянием с объединением повторов (GroupSort).
+// Файл счётчиков обрезается здесь, выходной - вызывающим, когда лента закрыта.
+// Возвращает число различных значений
+std::size_t GroupFile(Tape& input_tape, Tape& output_tape, const Config& cfg,
+                      const std::shared_ptr<TempTapePool>& pool, SortProfile& profile) {
+    std::unique_ptr<RecordFileTape<uint64_t>> counts;
+    if (!cfg.counts_file.empty()) {
+        CreateOutputFile(cfg.counts_file, input_tape.Size() * sizeof(uint64_t));
+        counts = std::make_unique<RecordFileTape<uint64_t>>(cfg.counts_file, cfg.delays);
+    }
+    const char* mode = counts ? "value counts" : "distinct values";
+
+    std::size_t groups = 0;
+    auto sink = std::make_shared<MetricsSink>();
+    if (cfg.value_min.has_value() && cfg.value_max.has_value()) {
+        std::cerr << "Selected algorithm: Counting Group (" << mode << ")\n\n";
+        std::cerr << "Starting grouping...\n\n";
+        groups = CountingGroup(input_tape, output_tape, counts.get(), cfg.memory_limit_bytes,
+                               *cfg.value_min, *cfg.value_max, &profile);
+    } else {
+        std::cerr << "Selected algorithm: Group Sort (" << mode << ", K-way Merge Sort)\n\n";
+        std::cerr << "Starting grouping...\n\n";
+        TemporaryFactory<ValueCount> make_temporary = [&cfg, sink, pool](std::size_t size,
+                                                                         std::size_t buffer_bytes) {
+            return RecordFileTape<ValueCount>::CreateTemporaryFile("group", size, buffer_bytes,
+                                                                   cfg.delays, sink, pool);
+        };
+        MergeStats stats = GroupSort(input_tape, output_tape, counts.get(), cfg.memory_limit_bytes,
+                                     cfg.max_tapes, make_temporary, &profile);
+        PrintMergeStats(stats);
+        groups = stats.output_elements;
+    }
+
+    ReportMetrics(cfg, profile, input_tape, output_tape, sink->Total());
+    if (counts) {
+        counts.reset();
+        std::filesystem::resize_file(cfg.counts_file, groups * sizeof(uint64_t));
+    }
+    return groups;
+}
+
+// Поток stdio для пути path: "-" - stdin/stdout (не закрывается), иначе файл
+using StreamHandle = std::unique_ptr<std::FILE, int (*)(std::FILE*)>;
+
+StreamHandle OpenStream(const std::string& path, bool write) {
+    if (path == "-") {
+        return StreamHandle(write ? stdout : stdin, [](std::FILE*) { return 0; });
+    }
+    std::FILE* file = std::fopen(path.c_str(), write ? "wb" : "rb");
+    if (!file) {
+        throw std::runtime_error("Failed to open " + std::string(write ? "output" : "input") + " file: " + path);
+    }
+    return StreamHandle(file, &std::fclose);
+}
+
+// Вход или выход - поток ("-"): длина входа заранее неизвестна, поэтому
+// сортировка всегда идёт через StreamMergeSort, а выход пишется только вперёд.
+// В stdout попадают только отсортированные данные, всё остальное - в stderr
+void StreamFileSort(const std::string& input_file, const std::string& output_file, const Config& cfg) {
+    if (cfg.record_format != RecordFormat::Int32) {
+        throw std::runtime_error("Stream input/output supports only int32 cells");
+    }
+    if (!cfg.index_file.empty() || cfg.top_k > 0 || !cfg.quantiles.empty() ||
+        cfg.distinct || !cfg.counts_file.empty()) {
+        throw std::runtime_error("Stream input/output does not support index_file, top_k, quantiles, "
+                                 "distinct and counts_file");
+    }
+
+    auto pool = std::make_shared<TempTapePool>(cfg.temp_dir);
+    StreamHandle input_stream = OpenStream(input_file, false);
+    StreamHandle output_stream = OpenStream(output_file, true);
+    StreamInputTape input_tape(input_stream.get());
+    StreamOutputTape output_tape(output_stream.get());
+
+    std::cerr << "Selected sorting algorithm: Stream K-way Merge Sort\n\n";
+    std::cerr << "Starting sorting...\n\n";
+
+    SortProfile profile;
+    VirtualClock::Set(0);
+    PrintMergeStats(StreamMergeSort(input_tape, output_tape, cfg.memory_limit_bytes,
+                                    ChooseRunFormation(cfg), cfg.max_tapes, pool,
+                                    cfg.delays, &profile));
+    output_tape.Flush();
+
+    ReportMetrics(cfg, profile, input_tape, output_tape);
+    std::cerr << "Sorted " << input_tape.Size() << " elements\n";
+    std::cerr << "Result: " << (output_file == "-" ? "stdout" : output_file) << "\n";
+}
+
+// Файл в формате FileTape - последовательно записанные int32,
+// либо записи формата record_format. "-" вместо пути - stdin/stdout
 void FileSort(const std::string& input_file,
               const std::string& output_file,
               const std::string& config_file) {
@@ -43,33 +319,122 @@ void FileSort(const std::string& input_file,
     }
 
     Config cfg = Config::Load(config_file);
+    if (cfg.top_k > 0 && (cfg.record_format != RecordFormat::Int32 || !cfg.index_file.empty())) {
+        throw std::runtime_error("top_k supports only int32 cells without index_file");
+    }
+    if (!cfg.quantiles.empty() && (cfg.record_format != RecordFormat::Int32 || !cfg.index_file.empty() ||
+                                   cfg.top_k > 0)) {
+        throw std::runtime_error("quantiles support only int32 cells without index_file and top_k");
+    }
+    bool grouped = cfg.distinct || !cfg.counts_file.empty();
+    if (grouped && (cfg.record_format != RecordFormat::Int32 || !cfg.index_file.empty() ||
+                    cfg.top_k > 0 || !cfg.quantiles.empty())) {
+        throw std::runtime_error("distinct and counts_file support only int32 cells "
+                                 "without index_file, top_k and quantiles");
+    }
+
+    if (input_file == "-" || output_file == "-") {
+        return StreamFileSort(input_file, output_file, cfg);
+    }
+
+    // Пул временных файлов переживает ленты: файлы удаляются после их закрытия.
+    // Временные ленты слияния - не длиннее входа
+    std::size_t input_bytes = cfg.temp_preallocate > 0 ? std::filesystem::file_size(input_file) : 0;
+    auto pool = std::make_shared<TempTapePool>(cfg.temp_dir, cfg.temp_preallocate, input_bytes);
 
-    FileTape input_tape(input_file, cfg.delays);
+    switch (cfg.record_format) {
+    case RecordFormat::Int32:
+        break;
+    case RecordFormat::Int64:
+        return RecordFileSort<int64_t, ScalarKey<int64_t>>(input_file, output_file, cfg, pool);
+    case RecordFormat::UInt64:
+        return RecordFileSort<uint64_t, ScalarKey<uint64_t>>(input_file, output_file, cfg, pool);
+    case RecordFormat::Float:
+        return RecordFileSort<float, ScalarKey<float>>(input_file, output_file, cfg, pool);
+    case RecordFormat::Double:
+        return RecordFileSort<double, ScalarKey<double>>(input_file, output_file, cfg, pool);
+    case RecordFormat::KeyValue64:
+        return RecordFileSort<KeyValue64, KeyValue64Key>(input_file, output_file, cfg, pool);
+    }
+
+    std::unique_ptr<Tape> input_holder = OpenTape(input_file, cfg, pool);
+    Tape& input_tape = *input_holder;
     std::cerr << "Input tape is loaded:\n";
     PrintTape(input_tape);
     std::cerr << "\n";
 
+    // При top_k в выходе только первые top_k значений, при quantiles - сами квантили.
+    // При группировке различных значений не больше, чем элементов: лишнее потом отрезается
+    std::size_t output_size = cfg.top_k > 0 ? std::min(cfg.top_k, input_tape.Size()) : input_tape.Size();
+    if (!cfg.quantiles.empty()) {
+        output_size = cfg.quantiles.size();
+    }
+    CreateOutputFile(output_file, output_size * sizeof(int32_t));
 
-    std::size_t n = input_tape.Size();
-    std::FILE* out_f = std::fopen(output_file.c_str(), "wb");
-    if (!out_f) {
-        throw std::runtime_error("Failed to create output file: " + output_file);
+    std::unique_ptr<Tape> output_holder = OpenTape(output_file, cfg, pool);
+    Tape& output_tape = *output_holder;
+
+    SortProfile profile;
+    VirtualClock::Set(0);
+
+    if (!cfg.index_file.empty()) {
+        ArgSortFile(input_tape, output_tape, cfg, pool, profile);
+        std::cerr << "Result: " << output_file << ", positions: " << cfg.index_file << "\n";
+        PrintTape(output_tape);
+        return;
     }
-    if (n > 0) {
-        if (std::fseek(out_f, static_cast<long>(n * sizeof(int32_t) - 1), SEEK_SET) != 0 ||
-            std::fputc(0, out_f) == EOF) {
-            std::fclose(out_f);
-            throw std::runtime_error("Failed to allocate space for output file");
+
+    if (grouped) {
+        std::size_t groups = GroupFile(input_tape, output_tape, cfg, pool, profile);
+        output_holder.reset();
+        std::filesystem::resize_file(output_file, groups * sizeof(int32_t));
+        std::cerr << "Distinct values: " << groups << "\n";
+        std::cerr << "Result: " << output_file;
+        if (!cfg.counts_file.empty()) {
+            std::cerr << ", counts: " << cfg.counts_file;
         }
+        std::cerr << "\n";
+        return;
     }
-    std::fclose(out_f);
-
-    
-    FileTape output_tape(output_file, cfg.delays);
 
     // Выбор алгоритма сортировки
-    std::cerr << "Selected sorting algorithm: ";
-    if (cfg.value_min.has_value() && cfg.value_max.has_value()) {
+    if (!cfg.quantiles.empty()) {
+        std::cerr << "Selected algorithm: Quantile Selection (no sort)\n\n";
+        std::cerr << "Starting selection...\n\n";
+
+        std::vector<int32_t> values = ext_sort::Quantiles(
+            input_tape,
+            cfg.quantiles,
+            cfg.memory_limit_bytes,
+            &profile
+        );
+        output_tape.Reset();
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            std::cerr << "Quantile " << cfg.quantiles[i] << ": " << values[i] << "\n";
+            output_tape.Write(values[i]);
+            output_tape.Next();
+        }
+        output_tape.Reset();
+        std::cerr << "\n";
+    } else if (cfg.top_k > 0) {
+        std::cerr << "Selected sorting algorithm: ";
+        std::cerr << "Partial Sort (" << cfg.top_k << (cfg.top_k_largest ? " largest" : " smallest") << ")\n\n";
+        std::cerr << "Starting sorting...\n\n";
+
+        MergeStats stats = ext_sort::PartialSort(
+            input_tape,
+            output_tape,
+            cfg.top_k,
+            cfg.memory_limit_bytes,
+            cfg.top_k_largest,
+            cfg.max_tapes,
+            &profile
+        );
+        PrintMergeStats(stats);
+    } else if (cfg.auto_plan) {
+        SortByPlan(input_tape, output_tape, cfg, profile);
+    } else if (cfg.value_min.has_value() && cfg.value_max.has_value()) {
+        std::cerr << "Selected sorting algorithm: ";
         std::cerr << "Counting Sort\n\n";
         std::cerr << "Starting sorting...\n\n";
 
@@ -78,9 +443,57 @@ void FileSort(const std::string& input_file,
             output_tape,
             cfg.memory_limit_bytes,
             *cfg.value_min,
-            *cfg.value_max
+            *cfg.value_max,
+            &profile
+        );
+    } else if (cfg.merge_mode == MergeMode::Distribution) {
+        std::cerr << "Selected sorting algorithm: ";
+        std::cerr << "Distribution Sort\n\n";
+        std::cerr << "Starting sorting...\n\n";
+
+        DistributionStats stats = ext_sort::DistributionSort(
+            input_tape,
+            output_tape,
+            cfg.memory_limit_bytes,
+            ChooseRunFormation(cfg),
+            cfg.threads,
+            &profile
+        );
+        std::cerr << "Buckets: " << stats.buckets
+                  << ", distribution passes: " << stats.passes
+                  << ", distributed elements: " << stats.distributed_elements << "\n\n";
+    } else if (cfg.merge_mode == MergeMode::Alternating) {
+        std::cerr << "Selected sorting algorithm: ";
+        std::cerr << "Alternating Merge Sort\n\n";
+        std::cerr << "Starting sorting...\n\n";
+
+        ext_sort::AlternatingMergeSort(
+            input_tape,
+            output_tape,
+            cfg.memory_limit_bytes,
+            ChooseRunFormation(cfg),
+            cfg.threads,
+            &profile
         );
+    } else if (cfg.merge_mode != MergeMode::Binary) {
+        bool polyphase = cfg.merge_mode == MergeMode::Polyphase;
+        std::cerr << "Selected sorting algorithm: ";
+        std::cerr << (polyphase ? "Polyphase" : "K-way") << " Merge Sort\n\n";
+        std::cerr << "Starting sorting...\n\n";
+
+        MergeStats stats = ext_sort::KWayMergeSort(
+            input_tape,
+            output_tape,
+            cfg.memory_limit_bytes,
+            ChooseRunFormation(cfg),
+            cfg.max_tapes,
+            polyphase,
+            cfg.threads,
+            &profile
+        );
+        PrintMergeStats(stats);
     } else {
+        std::cerr << "Selected sorting algorithm: ";
         std::cerr << "Chunk Merge Sort\n\n";
         std::cerr << "Starting sorting...\n\n";
 
@@ -88,10 +501,16 @@ void FileSort(const std::string& input_file,
             input_tape,
             output_tape,
             cfg.memory_limit_bytes,
-            cfg.strict_stack_limit
+            ChooseRunFormation(cfg),
+            cfg.threads,
+            &profile
         );
     }
 
+    ReportMetrics(cfg, profile, input_tape, output_tape);
+    std::cerr << "Temporary files: " << pool->Files() << " in " << pool->Directory() << ", "
+              << pool->DiskBytes() << " bytes, reused " << pool->Reused() << " times\n";
+
     std::cerr << "Result: " << output_file << "\n";
     PrintTape(output_tape);
 }
@@ -2,25 +2,42 @@
 
 #include "delays.hpp"
 #include "tape.hpp"
+#include "temp_pool.hpp"
 
 #include <cstdint>
 #include <cstdio>
 
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 
 // Эмуляция Tape через файл с контролируемым буфером и лимитом памяти
+// async_io => лимит памяти делится на два буфера: пока алгоритм работает
+//             с одним окном, фоновый поток ленты (один на всё время её жизни)
+//             дописывает предыдущее и предзагружает следующее по направлению
+//             движения головки
+// compress_temporaries => CreateTemporary создаёт сжатые ленты (CompressedTape)
 class FileTape : public Tape {
 public:
     explicit FileTape(const std::string& filename,
                       const Delays& delays,
-                      std::size_t memory_limit_bytes = 0);
+                      std::size_t memory_limit_bytes = 0,
+                      bool async_io = false,
+                      bool compress_temporaries = false);
     ~FileTape() override;
 
     int32_t Read() override;
     void Write(int32_t value) override;
+    std::size_t ReadBlock(int32_t* out, std::size_t n) override;
+    std::size_t ReadBlockBackward(int32_t* out, std::size_t n) override;
+    std::size_t WriteBlock(const int32_t* in, std::size_t n) override;
 
     bool Next() override;
     bool Prev() override;
@@ -32,30 +49,85 @@ public:
     void SetMemoryLimit(std::size_t bytes) override;
     std::unique_ptr<Tape> CreateTemporary(std::size_t size,
                                           std::size_t buffer_bytes) const override;
+    std::unique_ptr<Tape> OpenSection(std::size_t first,
+                                      std::size_t length,
+                                      std::size_t buffer_bytes) override;
+    bool SupportsSections() const override;
+
+    // Временные ленты (этой ленты, её участков и временных) берут файлы из pool
+    // и возвращают их туда при закрытии. nullptr => каждая создаёт свой файл в tmp/
+    // и удаляет его
+    void SetTemporaryPool(std::shared_ptr<TempTapePool> pool);
+
+    // Дожидается фоновых операций async_io, чтобы счётчики были полными
+    TapeMetrics Metrics() override;
+    TapeMetrics TemporaryMetrics() const override;
 
   private:
     std::string makeTmpFilename() const;  // Уникальное имя для временной ленты
     int32_t& getValue(std::size_t index); // Получить значение по индексу 
     bool shift(std::ptrdiff_t offset);    // Сдвинуть position_
-    void applyDelay(std::size_t ms) const;
+    // Сдвиг после блока из n ячеек: не дальше последней ячейки, с задержкой
+    void shiftAfterBlock(std::size_t n, std::size_t op_delay_ms);
+    // То же при чтении к началу ленты: не дальше первой ячейки
+    void shiftBackAfterBlock(std::size_t n, std::size_t op_delay_ms);
+    void applyDelay(std::size_t ms);
     void flushAndClearBuffer();
     // Обновляет буффер, если target_cell в него не попадает
     void loadBuffer(std::size_t target_cell);
+    void loadBufferAsync(std::size_t target_cell);
+    // Запускает фоновую запись back_buffer_ (если грязный) и чтение следующего окна
+    void schedulePrefetch(bool forward);
+    std::size_t windowCells() const;
+    void submitIo(std::function<void()> job); // отдать операцию фоновому потоку
+    void waitIo(); // дождаться фоновой записи/предзагрузки
+    void stopIo(); // завершить фоновый поток
+    void ioLoop();
+    void writeCells(const std::vector<int32_t>& cells, std::size_t start);
+    void readCells(std::vector<int32_t>& cells, std::size_t start);
 
     std::FILE* file_ = nullptr;
     std::string filename_;
     std::size_t size_ = 0; // размер файла (и ленты, соответственно)
+    std::size_t base_ = 0; // для участка - номер его первой ячейки в файле
     std::ptrdiff_t position_ = 0;
 
     Delays delays_;
+    std::size_t busy_until_ = 0; // виртуальное время, до которого лента занята
     std::size_t memory_limit_bytes_ = 0;
 
     std::vector<int32_t> buffer_;
     std::size_t buffer_start_ = 0; // индекс первой буфферизированной ячейки
     bool buffer_dirty_ = false;    // нужно ли будет flush-ить
 
-    bool is_temporary_ = false;    // нужно ли удалить файл
+    // Второй буфер async_io: предзагруженное окно или окно, ждущее записи.
+    // Пока io_busy_, трогает его только фоновый поток
+    bool async_io_ = false;
+    std::thread io_thread_;        // запускается при первой фоновой операции
+    std::mutex io_mutex_;
+    std::condition_variable io_cv_;
+    std::function<void()> io_job_; // операция, ещё не взятая фоновым потоком
+    bool io_busy_ = false;         // операция отдана и не завершена
+    bool io_stop_ = false;
+    std::exception_ptr io_error_;
+    std::vector<int32_t> back_buffer_;
+    std::size_t back_start_ = 0;
+    bool back_dirty_ = false;
+    bool back_ready_ = false;      // back_buffer_ содержит актуальное окно
+
+    bool is_temporary_ = false;    // нужно ли удалить файл (или вернуть его в pool_)
+    std::shared_ptr<TempTapePool> pool_;
+    bool compress_temporaries_ = false;
+
+    // Счётчики ввода-вывода (io_calls, bytes_*) меняет и фоновый поток async_io,
+    // остальные - только поток, работающий с лентой
+    TapeMetrics metrics_;
+    // Общая сумма для всех временных лент и участков, созданных от исходной ленты
+    std::shared_ptr<MetricsSink> temporaries_ = std::make_shared<MetricsSink>();
+    bool report_metrics_ = false;  // дописать свои счётчики в temporaries_ при закрытии
+    // Счётчики закрытых участков самой ленты (не временной): входят в её Metrics()
+    std::shared_ptr<MetricsSink> sections_ = std::make_shared<MetricsSink>();
 
     static const std::size_t CELL_SIZE; // размер 1 ячейки
-    static std::size_t tmp_counter_;    // для makeTmpFilename 
+    static std::atomic<std::size_t> tmp_counter_; // для makeTmpFilename
 };
\ No newline at end of file
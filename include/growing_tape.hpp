@@ -0,0 +1,57 @@
+#pragma once
+
+#include "tape.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <memory>
+#include <vector>
+
+// Временная лента, место под которую берётся по мере записи.
+// Размер ленты - верхняя граница числа ячеек (например, весь вход), а сами
+// ячейки лежат в сегментах - временных лентах origin: первый сегмент
+// не короче буфера, каждый следующий вдвое длиннее предыдущего. Сегмент
+// создаётся, когда головка пишет в его первую ячейку, поэтому занято не больше
+// вдвое против записанного. Непрочитанные ячейки без сегмента читаются нулями.
+// Буфер (лимит памяти) есть только у сегмента под головкой
+class GrowingTape : public Tape {
+public:
+    GrowingTape(const Tape& origin, std::size_t size, std::size_t buffer_bytes);
+
+    int32_t Read() override;
+    void Write(int32_t value) override;
+    std::size_t ReadBlock(int32_t* out, std::size_t n) override;
+    std::size_t WriteBlock(const int32_t* in, std::size_t n) override;
+
+    bool Next() override;
+    bool Prev() override;
+    bool Rewind(std::ptrdiff_t offset) override;
+
+    std::size_t Size() const override;
+    std::size_t Position() const override;
+
+    void SetMemoryLimit(std::size_t bytes) override;
+    std::unique_ptr<Tape> CreateTemporary(std::size_t size,
+                                          std::size_t buffer_bytes) const override;
+
+    // Сколько ячеек занимают созданные сегменты
+    std::size_t AllocatedCells() const;
+
+private:
+    // Номер сегмента, в который попадает ячейка
+    std::size_t segmentOf(std::size_t cell) const;
+    std::size_t segmentStart(std::size_t index) const;
+    std::size_t segmentLength(std::size_t index) const;
+    // Сегмент index с головкой на ячейке cell; create => создать его
+    // (и предыдущие), если ещё нет. nullptr => сегмента нет
+    Tape* seek(std::size_t cell, bool create);
+
+    const Tape& origin_;
+    std::size_t size_;
+    std::size_t first_cells_;      // длина первого сегмента
+    std::size_t position_ = 0;
+    std::size_t memory_limit_bytes_;
+    std::vector<std::unique_ptr<Tape>> segments_;
+    std::size_t active_ = 0;       // сегмент, которому отдан буфер
+};
@@ -0,0 +1,187 @@
+#pragma once
+
+#include "external_sort.hpp"
+#include "loser_tree.hpp"
+#include "metrics.hpp"
+#include "tape.hpp"
+#include "tape_stream.hpp"
+
+#include <cstddef>
+
+#include <algorithm>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// k-путевое слияние серий на временных лентах через дерево проигравших.
+// Общее для KWayMergeSort, PartialSort (int32) и RecordMergeSort (записи):
+// ячейки Cell сравниваются по ключам KeyOf (record.hpp), записи переносятся целиком
+
+namespace ext_sort {
+
+// Что делать с записями с равными ключами при слиянии (Combine):
+// combine(into, from) == true => from учтена в into и дальше не пишется.
+// KeepRecords - остаются все записи
+struct KeepRecords {
+    template <typename Cell>
+    bool operator()(Cell&, const Cell&) const { return false; }
+};
+
+// Остаётся одна запись из равных - первая
+struct KeepFirst {
+    template <typename Cell>
+    bool operator()(Cell&, const Cell&) const { return true; }
+};
+
+namespace detail {
+
+// Временная лента и длины записанных на неё серий по порядку.
+// Серия длины 0 - фиктивная, места на ленте не занимает
+template <typename Cell>
+struct RunTape {
+    std::unique_ptr<BasicTape<Cell>> tape;
+    std::deque<std::size_t> runs;
+};
+
+// Сливает первые серии всех лент sources в dest и снимает их со списков.
+// При равных ключах побеждает лента, стоящая в sources раньше; записи с равными
+// ключами объединяет Combine. Ленты читаются и пишутся блоками по block_elements.
+// Серия обрезается до limit записей, тогда головки источников перематываются
+// на их следующие серии. Возвращает длину получившейся серии
+template <typename Cell, typename KeyOf, typename Combine = KeepRecords>
+std::size_t mergeRuns(const std::vector<RunTape<Cell>*>& sources, BasicTape<Cell>& dest,
+                      std::size_t block_elements,
+                      std::size_t limit = std::numeric_limits<std::size_t>::max()) {
+    KeyOf key_of;
+    std::vector<BasicTapeReader<Cell>> readers;
+    readers.reserve(sources.size());
+    BasicLoserTree<typename KeyOf::Key> tree(sources.size());
+    for (std::size_t i = 0; i < sources.size(); ++i) {
+        readers.emplace_back(*sources[i]->tape, block_elements);
+        readers[i].Start(sources[i]->runs.front());
+        sources[i]->runs.pop_front();
+        if (!readers[i].Empty()) {
+            tree.Set(i, key_of(readers[i].Peek()));
+        }
+    }
+    tree.Build();
+
+    BasicTapeWriter<Cell> writer(dest, block_elements);
+    std::size_t written = 0;
+    Combine combine;
+    Cell last{};
+    bool has_last = false;
+    while (!tree.Empty() && written < limit) {
+        BasicTapeReader<Cell>& src = readers[tree.Winner()];
+        if constexpr (std::is_same_v<Combine, KeepRecords>) {
+            writer.Push(src.Peek());
+            ++written;
+        } else if (!has_last || key_of(last) < key_of(src.Peek()) || !combine(last, src.Peek())) {
+            // Запись не объединилась с предыдущей: предыдущая готова
+            if (has_last) {
+                writer.Push(last);
+                ++written;
+            }
+            last = src.Peek();
+            has_last = written < limit;
+        }
+
+        src.Pop();
+        if (!src.Empty()) {
+            tree.Replace(key_of(src.Peek()));
+        } else {
+            tree.Pop();
+        }
+    }
+    if (has_last) {
+        writer.Push(last);
+        ++written;
+    }
+
+    for (std::size_t i = 0; i < sources.size(); ++i) {
+        if (readers[i].Unread() > 0) {
+            sources[i]->tape->Rewind(static_cast<std::ptrdiff_t>(readers[i].Unread()));
+        }
+    }
+
+    return written;
+}
+
+// Непустые ленты из tapes[first, last)
+template <typename Cell>
+std::vector<RunTape<Cell>*> nonEmpty(std::vector<RunTape<Cell>>& tapes, std::size_t first, std::size_t last) {
+    std::vector<RunTape<Cell>*> result;
+    for (std::size_t i = first; i < last; ++i) {
+        if (!tapes[i].runs.empty()) {
+            result.push_back(&tapes[i]);
+        }
+    }
+    return result;
+}
+
+// На каждой ленте осталось не больше одной серии - слияние будет последним
+template <typename Cell>
+bool isLastMerge(const std::vector<RunTape<Cell>*>& inputs) {
+    return std::all_of(inputs.begin(), inputs.end(),
+                       [](const RunTape<Cell>* t) { return t->runs.size() <= 1; });
+}
+
+template <typename Cell, typename KeyOf, typename Combine = KeepRecords>
+void finalMerge(const std::vector<RunTape<Cell>*>& inputs, BasicTape<Cell>& output,
+                std::size_t block_elements, MergeStats& stats, SortProfile* profile,
+                std::size_t limit = std::numeric_limits<std::size_t>::max()) {
+    ScopedPhase phase(profile, "final_merge");
+    output.Reset();
+    stats.output_elements = mergeRuns<Cell, KeyOf, Combine>(inputs, output, block_elements, limit);
+    stats.merged_elements += stats.output_elements;
+    ++stats.passes;
+}
+
+// Сбалансированное слияние: tapes[0, k) - входная группа, tapes[k, 2k) - выходная.
+// Головки лент - в начале. Серии результата раскладываются по выходной группе
+// по кругу, поэтому серии, которые сливаются вместе, идут в sources по порядку
+// и слияние устойчиво. Слитые серии обрезаются до limit записей
+template <typename Cell, typename KeyOf, typename Combine = KeepRecords>
+void balancedMerge(std::vector<RunTape<Cell>>& tapes, std::size_t k, BasicTape<Cell>& output,
+                   std::size_t block_elements, MergeStats& stats, SortProfile* profile,
+                   std::size_t limit = std::numeric_limits<std::size_t>::max()) {
+    std::size_t in_first = 0;
+    std::size_t out_first = k;
+
+    for (;;) {
+        std::vector<RunTape<Cell>*> inputs = nonEmpty(tapes, in_first, in_first + k);
+        if (isLastMerge(inputs)) {
+            finalMerge<Cell, KeyOf, Combine>(inputs, output, block_elements, stats, profile, limit);
+            return;
+        }
+        ScopedPhase phase(profile, "merge_pass");
+
+        for (std::size_t i = out_first; i < out_first + k; ++i) {
+            tapes[i].tape->Reset();
+        }
+
+        std::size_t target = out_first;
+        while (!inputs.empty()) {
+            std::size_t length = mergeRuns<Cell, KeyOf, Combine>(inputs, *tapes[target].tape,
+                                                                 block_elements, limit);
+            tapes[target].runs.push_back(length);
+            stats.merged_elements += length;
+
+            target = target + 1 < out_first + k ? target + 1 : out_first;
+            inputs = nonEmpty(tapes, in_first, in_first + k);
+        }
+        ++stats.passes;
+
+        std::swap(in_first, out_first);
+        for (std::size_t i = in_first; i < in_first + k; ++i) {
+            tapes[i].tape->Reset();
+        }
+    }
+}
+
+} // namespace detail
+
+} // namespace ext_sort
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <utility>
+#include <vector>
+
+// Дерево проигравших для k-путевого слияния
+// Источники нумеруются 0..k-1, у каждого есть текущий ключ или он исчерпан.
+// При равных ключах побеждает источник с меньшим номером.
+// Key - любой тип с operator< (для записей - ключ из record.hpp)
+template <typename Key>
+class BasicLoserTree {
+public:
+    explicit BasicLoserTree(std::size_t ways)
+        : ways_(ways)
+        , keys_(ways, Key{})
+        , alive_(ways, false)
+        , tree_(ways, 0) {}
+
+    // Задать начальный ключ источника (до Build)
+    void Set(std::size_t source, const Key& key) {
+        keys_[source] = key;
+        alive_[source] = true;
+    }
+
+    // Построить дерево по заданным ключам, O(k)
+    void Build() {
+        if (ways_ == 0) {
+            return;
+        }
+        // winners[n] - победитель поддерева с корнем n, листья - узлы ways_..2*ways_-1
+        std::vector<std::size_t> winners(2 * ways_);
+        for (std::size_t i = 0; i < ways_; ++i) {
+            winners[ways_ + i] = i;
+        }
+        for (std::size_t node = ways_ - 1; node >= 1; --node) {
+            std::size_t left = winners[2 * node];
+            std::size_t right = winners[2 * node + 1];
+            if (less(left, right)) {
+                winners[node] = left;
+                tree_[node] = right;
+            } else {
+                winners[node] = right;
+                tree_[node] = left;
+            }
+        }
+        tree_[0] = ways_ > 1 ? winners[1] : 0;
+    }
+
+    // Все источники исчерпаны
+    bool Empty() const {
+        return ways_ == 0 || !alive_[tree_[0]];
+    }
+
+    std::size_t Winner() const { return tree_[0]; }
+    const Key& Top() const { return keys_[tree_[0]]; }
+
+    // У победителя появился следующий ключ
+    void Replace(const Key& key) {
+        keys_[tree_[0]] = key;
+        replay();
+    }
+
+    // Победитель исчерпан
+    void Pop() {
+        alive_[tree_[0]] = false;
+        replay();
+    }
+
+private:
+    bool less(std::size_t a, std::size_t b) const {
+        if (!alive_[a]) {
+            return false;
+        }
+        if (!alive_[b]) {
+            return true;
+        }
+        if (keys_[a] < keys_[b]) {
+            return true;
+        }
+        return !(keys_[b] < keys_[a]) && a < b;
+    }
+
+    // Проводим победителя от листа к корню
+    void replay() {
+        std::size_t winner = tree_[0];
+        for (std::size_t node = (winner + ways_) / 2; node >= 1; node /= 2) {
+            if (less(tree_[node], winner)) {
+                std::swap(tree_[node], winner);
+            }
+        }
+        tree_[0] = winner;
+    }
+
+    std::size_t ways_;
+    std::vector<Key> keys_;
+    std::vector<bool> alive_;
+    std::vector<std::size_t> tree_; // tree_[0] - победитель, tree_[1..k-1] - проигравшие
+};
+
+using LoserTree = BasicLoserTree<int32_t>;
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Счётчики операций одной ленты: по ним подбираются буферы и алгоритм
+struct TapeMetrics {
+    std::size_t reads = 0;         // прочитано ячеек (Read и ReadBlock)
+    std::size_t writes = 0;        // записано ячеек (Write и WriteBlock)
+    std::size_t shifts = 0;        // сдвигов головки на одну ячейку, в том числе в блочных операциях
+    std::size_t rewinds = 0;       // перемоток (Rewind и Reset)
+    std::size_t buffer_misses = 0; // обращений мимо буфера (окна): каждое - загрузка нового окна
+    std::size_t io_calls = 0;      // обращений к носителю: fread/fwrite у FileTape, mmap у MmapTape
+    std::size_t bytes_read = 0;    // байт прочитано с носителя
+    std::size_t bytes_written = 0; // байт записано на носитель
+    std::size_t delay_ms = 0;      // суммарная эмулируемая задержка
+
+    TapeMetrics& operator+=(const TapeMetrics& other);
+};
+
+// Сумма счётчиков закрытых лент. Временные ленты и участки дописывают сюда
+// свои счётчики в деструкторе, возможно из разных потоков
+class MetricsSink {
+public:
+    void Add(const TapeMetrics& metrics);
+    TapeMetrics Total() const;
+
+private:
+    mutable std::mutex mutex_;
+    TapeMetrics total_;
+};
+
+namespace ext_sort {
+
+// Длительность одного этапа сортировки: реальная и по виртуальному времени лент
+struct PhaseTiming {
+    std::string name;
+    double ms;
+    std::size_t virtual_ms;
+};
+
+// Этапы сортировки по порядку: формирование серий, каждый проход слияния,
+// каждый проход подсчёта. Заполняется из потока, вызвавшего сортировку
+class SortProfile {
+public:
+    void Add(std::string name, double ms, std::size_t virtual_ms = 0);
+    const std::vector<PhaseTiming>& Phases() const;
+
+private:
+    std::vector<PhaseTiming> phases_;
+};
+
+// Замер этапа: от создания до разрушения. profile == nullptr => ничего не замеряет
+class ScopedPhase {
+public:
+    ScopedPhase(SortProfile* profile, const char* name);
+    ~ScopedPhase();
+
+    ScopedPhase(const ScopedPhase&) = delete;
+    ScopedPhase& operator=(const ScopedPhase&) = delete;
+
+private:
+    SortProfile* profile_;
+    const char* name_;
+    std::chrono::steady_clock::time_point start_;
+    std::size_t virtual_start_;
+};
+
+// Отчёт в JSON: {"virtual_ms": ..., "phases": [{"name": ..., "ms": ..., "virtual_ms": ...}, ...],
+//                "tapes": {имя: {счётчики}, ...}}
+// virtual_ms - виртуальное время всей сортировки (с учётом одновременной работы лент)
+std::string MetricsJson(const SortProfile& profile,
+                        const std::vector<std::pair<std::string, TapeMetrics>>& tapes,
+                        std::size_t virtual_ms);
+
+} // namespace ext_sort
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "delays.hpp"
+#include "tape.hpp"
+#include "temp_pool.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <atomic>
+#include <memory>
+#include <string>
+
+// Эмуляция Tape через отображение файла в память (mmap).
+// Отображается окно файла не больше лимита памяти (но не меньше страницы),
+// ячейки читаются и пишутся прямо в отображение, без промежуточного буфера
+class MmapTape : public Tape {
+public:
+    explicit MmapTape(const std::string& filename,
+                      const Delays& delays,
+                      std::size_t memory_limit_bytes = 0);
+    ~MmapTape() override;
+
+    int32_t Read() override;
+    void Write(int32_t value) override;
+    std::size_t ReadBlock(int32_t* out, std::size_t n) override;
+    std::size_t ReadBlockBackward(int32_t* out, std::size_t n) override;
+    std::size_t WriteBlock(const int32_t* in, std::size_t n) override;
+
+    bool Next() override;
+    bool Prev() override;
+    bool Rewind(std::ptrdiff_t offset) override;
+
+    std::size_t Size() const override;
+    std::size_t Position() const override;
+
+    void SetMemoryLimit(std::size_t bytes) override;
+    std::unique_ptr<Tape> CreateTemporary(std::size_t size,
+                                          std::size_t buffer_bytes) const override;
+    std::unique_ptr<Tape> OpenSection(std::size_t first,
+                                      std::size_t length,
+                                      std::size_t buffer_bytes) override;
+    bool SupportsSections() const override;
+
+    // Временные ленты (этой ленты, её участков и временных) берут файлы из pool
+    // и возвращают их туда при закрытии. nullptr => каждая создаёт свой файл в tmp/
+    // и удаляет его
+    void SetTemporaryPool(std::shared_ptr<TempTapePool> pool);
+
+    // bytes_read - объём отображённых окон, bytes_written - объём окон,
+    // в которые писали (страницы сбрасывает ядро, точнее не узнать)
+    TapeMetrics Metrics() override;
+    TapeMetrics TemporaryMetrics() const override;
+
+  private:
+    std::string makeTmpFilename() const;  // Уникальное имя для временной ленты
+    int32_t& getValue(std::size_t index); // Получить значение по индексу
+    bool shift(std::ptrdiff_t offset);    // Сдвинуть position_
+    // Сдвиг после блока из n ячеек: не дальше последней ячейки, с задержкой
+    void shiftAfterBlock(std::size_t n, std::size_t op_delay_ms);
+    // То же при чтении к началу ленты: не дальше первой ячейки
+    void shiftBackAfterBlock(std::size_t n, std::size_t op_delay_ms);
+    void applyDelay(std::size_t ms);
+    // Отображает окно с ячейкой файла file_cell
+    void mapWindow(std::size_t file_cell);
+    void unmapWindow();
+    std::size_t windowBytes() const;
+
+    int fd_ = -1;
+    std::string filename_;
+    std::size_t size_ = 0; // размер файла в ячейках
+    std::size_t base_ = 0; // для участка - номер его первой ячейки в файле
+    std::ptrdiff_t position_ = 0;
+
+    Delays delays_;
+    std::size_t busy_until_ = 0; // виртуальное время, до которого лента занята
+    std::size_t memory_limit_bytes_ = 0;
+
+    void* map_ = nullptr;
+    std::size_t map_length_ = 0;   // в байтах
+    int32_t* window_ = nullptr;    // первая отображённая ячейка
+    std::size_t window_start_ = 0; // её номер в файле
+    std::size_t window_cells_ = 0;
+    bool window_dirty_ = false;    // в окно писали
+
+    bool is_temporary_ = false;    // нужно ли удалить файл (или вернуть его в pool_)
+    std::shared_ptr<TempTapePool> pool_;
+
+    TapeMetrics metrics_;
+    // Общая сумма для всех временных лент и участков, созданных от исходной ленты
+    std::shared_ptr<MetricsSink> temporaries_ = std::make_shared<MetricsSink>();
+    bool report_metrics_ = false;  // дописать свои счётчики в temporaries_ при закрытии
+    // Счётчики закрытых участков самой ленты (не временной): входят в её Metrics()
+    std::shared_ptr<MetricsSink> sections_ = std::make_shared<MetricsSink>();
+
+    static const std::size_t CELL_SIZE; // размер 1 ячейки
+    static std::atomic<std::size_t> tmp_counter_; // для makeTmpFilename
+};
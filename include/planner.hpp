@@ -0,0 +1,65 @@
+#pragma once
+
+#include "delays.hpp"
+#include "external_sort.hpp"
+#include "tape.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace ext_sort {
+
+// Алгоритм сортировки в плане
+enum class Strategy {
+    Counting,         // CountingSort (с диапазоном, если он задан)
+    ChunkMerge,       // ChunkMergeSort: попарное слияние
+    AlternatingMerge, // AlternatingMergeSort: попарное слияние без перемоток между проходами
+    KWayMerge         // KWayMergeSort: сбалансированное k-путевое слияние
+};
+
+// Что известно о сортировке до её начала
+struct PlanInput {
+    Delays delays;
+    std::size_t memory_limit_bytes;
+    std::size_t elements;         // размер входной ленты
+    std::size_t max_tapes;        // ограничение на число временных лент для k-путевого слияния
+    std::size_t threads;          // сколько потоков сортируют чанки (от этого зависит размер чанка)
+    RunFormation formation;       // способ сортировки чанков из конфига
+    std::optional<int32_t> value_min;
+    std::optional<int32_t> value_max;
+    std::vector<int32_t> sample;  // выборка значений со входа; пусто => распределение неизвестно
+};
+
+// Один вариант сортировки с оценкой стоимости.
+// Оценка - по задержкам лент для одного потока: каждый элемент, прочитанный
+// или записанный блоком, стоит задержку операции и сдвига, каждая перемотка
+// в начало ленты - min(rewind_ms, shift_ms * длина)
+struct SortPlan {
+    Strategy strategy;
+    RunFormation formation; // для слияний
+    std::size_t fan_in;     // для KWayMerge: сколько серий сливается за раз
+    std::size_t runs;       // ожидаемое число начальных серий (для подсчёта - 0)
+    std::size_t passes;     // сколько раз данные целиком читаются с лент
+    double tape_ms;         // оценка суммарных задержек лент
+    double moved;           // элементов прочитано и записано: при равных задержках решает он
+};
+
+// Все варианты, от дешёвого к дорогому
+std::vector<SortPlan> EstimatePlans(const PlanInput& input);
+
+// Самый дешёвый вариант
+SortPlan ChoosePlan(const PlanInput& input);
+
+// Одна строка: алгоритм, параметры, оценка
+std::string DescribePlan(const SortPlan& plan);
+
+// До count элементов по всей ленте, в порядке их позиций: лента делится на count
+// равных промежутков, из каждого берётся элемент со случайным сдвигом внутри
+// промежутка. Головка идёт только вперёд и возвращается в начало
+std::vector<int32_t> SampleTape(Tape& tape, std::size_t count);
+
+} // namespace ext_sort
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <array>
+#include <type_traits>
+
+// Записи фиксированной ширины и извлечение ключей из них.
+// На ленте запись лежит так же, как в памяти (порядок байт машины).
+// Ключ - любой тип с operator<: сортировки сравнивают только ключи,
+// а переносят записи целиком
+
+namespace ext_sort {
+
+// Ключ-число. Целые сравниваются как есть, у float/double берутся биты
+// в полном порядке (IEEE 754 totalOrder): -NaN < -inf < ... < -0 < +0 < ... < +inf < +NaN
+template <typename T>
+struct ScalarKey {
+    static_assert(std::is_arithmetic_v<T>, "ScalarKey needs an arithmetic type");
+
+    using Bits = std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>;
+    using Key = std::conditional_t<std::is_floating_point_v<T>, Bits, T>;
+
+    Key operator()(T value) const {
+        if constexpr (std::is_floating_point_v<T>) {
+            Bits bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            constexpr Bits sign = Bits{1} << (sizeof(Bits) * 8 - 1);
+            // У отрицательных больший модуль => меньше: инвертируем все биты,
+            // у положительных поднимаем знаковый, чтобы они шли после отрицательных
+            return (bits & sign) ? ~bits : bits | sign;
+        } else {
+            return value;
+        }
+    }
+};
+
+// 8 байт ключа и 8 байт полезной нагрузки
+struct KeyValue64 {
+    uint64_t key;
+    uint64_t value;
+};
+
+struct KeyValue64Key {
+    using Key = uint64_t;
+
+    Key operator()(const KeyValue64& record) const {
+        return record.key;
+    }
+};
+
+// Значение int32 и его позиция на исходной ленте (для ArgSort)
+struct IndexedValue {
+    int32_t value;
+    uint64_t position;
+};
+
+struct IndexedValueKey {
+    using Key = int32_t;
+
+    Key operator()(const IndexedValue& record) const {
+        return record.value;
+    }
+};
+
+// Значение int32 и сколько раз оно встретилось (для GroupSort)
+struct ValueCount {
+    int32_t value;
+    uint32_t count;
+};
+
+struct ValueCountKey {
+    using Key = int32_t;
+
+    Key operator()(const ValueCount& record) const {
+        return record.value;
+    }
+};
+
+// Запись из KeyBytes байт ключа и PayloadBytes байт нагрузки.
+// Ключи сравниваются побайтно как беззнаковые (как memcmp)
+template <std::size_t KeyBytes, std::size_t PayloadBytes>
+struct BytesRecord {
+    static_assert(KeyBytes > 0, "BytesRecord needs a non-empty key");
+
+    std::array<uint8_t, KeyBytes + PayloadBytes> bytes;
+};
+
+template <std::size_t KeyBytes>
+struct BytesKey {
+    using Key = std::array<uint8_t, KeyBytes>;
+
+    template <std::size_t PayloadBytes>
+    Key operator()(const BytesRecord<KeyBytes, PayloadBytes>& record) const {
+        Key key;
+        std::memcpy(key.data(), record.bytes.data(), KeyBytes);
+        return key;
+    }
+};
+
+} // namespace ext_sort
@@ -0,0 +1,416 @@
+#pragma once
+
+#include "external_sort.hpp"
+#include "kway_merge.hpp"
+#include "metrics.hpp"
+#include "record.hpp"
+#include "tape.hpp"
+#include "tape_stream.hpp"
+
+#include <cstddef>
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace ext_sort {
+
+// Создаёт временную ленту записей: size ячеек, буфер buffer_bytes
+template <typename Record>
+using TemporaryFactory = std::function<std::unique_ptr<BasicTape<Record>>(std::size_t size,
+                                                                          std::size_t buffer_bytes)>;
+
+// Счётчики равных значений складываются
+struct SumCounts {
+    bool operator()(ValueCount& into, const ValueCount& from) const {
+        into.count += from.count;
+        return true;
+    }
+};
+
+namespace detail {
+
+// Объединяет соседние записи отсортированного чанка с равными ключами
+template <typename Record, typename KeyOf, typename Combine>
+void combineEqual(std::vector<Record>& chunk) {
+    if constexpr (!std::is_same_v<Combine, KeepRecords>) {
+        KeyOf key_of;
+        Combine combine;
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < chunk.size(); ++i) {
+            if (kept > 0 && !(key_of(chunk[kept - 1]) < key_of(chunk[i])) && combine(chunk[kept - 1], chunk[i])) {
+                continue;
+            }
+            chunk[kept++] = chunk[i];
+        }
+        chunk.resize(kept);
+    }
+}
+
+// Вход ArgSort: значения ленты values вместе с их позициями. Только для чтения,
+// временные ленты создаёт make_temporary
+class PositionedInput : public BasicTape<IndexedValue> {
+public:
+    PositionedInput(Tape& values, TemporaryFactory<IndexedValue> make_temporary)
+        : values_(values)
+        , make_temporary_(std::move(make_temporary)) {}
+
+    IndexedValue Read() override {
+        std::size_t position = values_.Position();
+        return {values_.Read(), position};
+    }
+
+    void Write(IndexedValue) override {
+        throw std::runtime_error("ArgSort input is read-only");
+    }
+
+    // Значения читаем кусками через небольшой буфер и дописываем к ним позиции.
+    // Головка у последней ячейки не сдвигается, поэтому n ограничиваем заранее
+    std::size_t ReadBlock(IndexedValue* out, std::size_t n) override {
+        std::size_t first = values_.Position();
+        n = std::min(n, values_.Size() - std::min(first, values_.Size()));
+        std::size_t done = 0;
+        while (done < n) {
+            std::size_t got = values_.ReadBlock(piece_.data(), std::min(n - done, piece_.size()));
+            if (got == 0) {
+                break;
+            }
+            for (std::size_t i = 0; i < got; ++i) {
+                out[done + i] = {piece_[i], first + done + i};
+            }
+            done += got;
+        }
+        return done;
+    }
+
+    bool Next() override { return values_.Next(); }
+    bool Prev() override { return values_.Prev(); }
+    bool Rewind(std::ptrdiff_t offset) override { return values_.Rewind(offset); }
+    std::size_t Size() const override { return values_.Size(); }
+    std::size_t Position() const override { return values_.Position(); }
+    void SetMemoryLimit(std::size_t bytes) override { values_.SetMemoryLimit(bytes); }
+
+    std::unique_ptr<BasicTape<IndexedValue>> CreateTemporary(std::size_t size,
+                                                             std::size_t buffer_bytes) const override {
+        return make_temporary_(size, buffer_bytes);
+    }
+
+private:
+    Tape& values_;
+    TemporaryFactory<IndexedValue> make_temporary_;
+    std::vector<int32_t> piece_ = std::vector<int32_t>(MAX_STREAM_BLOCK_ELEMENTS / 4);
+};
+
+// Выход ArgSort: значения пишутся на values, позиции - на positions. Только для записи
+class SplitOutput : public BasicTape<IndexedValue> {
+public:
+    SplitOutput(Tape& values, BasicTape<uint64_t>& positions)
+        : values_(values)
+        , positions_(positions) {}
+
+    IndexedValue Read() override {
+        throw std::runtime_error("ArgSort output is write-only");
+    }
+
+    void Write(IndexedValue record) override {
+        values_.Write(record.value);
+        positions_.Write(record.position);
+    }
+
+    std::size_t WriteBlock(const IndexedValue* in, std::size_t n) override {
+        values_piece_.resize(n);
+        positions_piece_.resize(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            values_piece_[i] = in[i].value;
+            positions_piece_[i] = in[i].position;
+        }
+        std::size_t done = values_.WriteBlock(values_piece_.data(), n);
+        positions_.WriteBlock(positions_piece_.data(), done);
+        return done;
+    }
+
+    bool Next() override { return values_.Next() && positions_.Next(); }
+    bool Prev() override { return values_.Prev() && positions_.Prev(); }
+
+    bool Rewind(std::ptrdiff_t offset) override {
+        return values_.Rewind(offset) && positions_.Rewind(offset);
+    }
+
+    std::size_t Size() const override { return values_.Size(); }
+    std::size_t Position() const override { return values_.Position(); }
+
+    void SetMemoryLimit(std::size_t bytes) override {
+        values_.SetMemoryLimit(bytes / 3);
+        positions_.SetMemoryLimit(bytes - bytes / 3);
+    }
+
+    std::unique_ptr<BasicTape<IndexedValue>> CreateTemporary(std::size_t, std::size_t) const override {
+        throw std::runtime_error("ArgSort output has no temporaries");
+    }
+
+private:
+    Tape& values_;
+    BasicTape<uint64_t>& positions_;
+    std::vector<int32_t> values_piece_;
+    std::vector<uint64_t> positions_piece_;
+};
+
+// Вход GroupSort: значения ленты values, каждое со счётчиком 1. Только для чтения,
+// временные ленты создаёт make_temporary
+class CountedInput : public BasicTape<ValueCount> {
+public:
+    CountedInput(Tape& values, TemporaryFactory<ValueCount> make_temporary)
+        : values_(values)
+        , make_temporary_(std::move(make_temporary)) {}
+
+    ValueCount Read() override {
+        return {values_.Read(), 1};
+    }
+
+    void Write(ValueCount) override {
+        throw std::runtime_error("GroupSort input is read-only");
+    }
+
+    // Как в PositionedInput: n ограничиваем заранее, головка у последней ячейки не сдвигается
+    std::size_t ReadBlock(ValueCount* out, std::size_t n) override {
+        n = std::min(n, values_.Size() - std::min(values_.Position(), values_.Size()));
+        std::size_t done = 0;
+        while (done < n) {
+            std::size_t got = values_.ReadBlock(piece_.data(), std::min(n - done, piece_.size()));
+            if (got == 0) {
+                break;
+            }
+            for (std::size_t i = 0; i < got; ++i) {
+                out[done + i] = {piece_[i], 1};
+            }
+            done += got;
+        }
+        return done;
+    }
+
+    bool Next() override { return values_.Next(); }
+    bool Prev() override { return values_.Prev(); }
+    bool Rewind(std::ptrdiff_t offset) override { return values_.Rewind(offset); }
+    std::size_t Size() const override { return values_.Size(); }
+    std::size_t Position() const override { return values_.Position(); }
+    void SetMemoryLimit(std::size_t bytes) override { values_.SetMemoryLimit(bytes); }
+
+    std::unique_ptr<BasicTape<ValueCount>> CreateTemporary(std::size_t size,
+                                                           std::size_t buffer_bytes) const override {
+        return make_temporary_(size, buffer_bytes);
+    }
+
+private:
+    Tape& values_;
+    TemporaryFactory<ValueCount> make_temporary_;
+    std::vector<int32_t> piece_ = std::vector<int32_t>(MAX_STREAM_BLOCK_ELEMENTS / 4);
+};
+
+// Выход GroupSort: значения пишутся на values, счётчики - на counts. Только для записи
+class CountedOutput : public BasicTape<ValueCount> {
+public:
+    CountedOutput(Tape& values, BasicTape<uint64_t>& counts)
+        : values_(values)
+        , counts_(counts) {}
+
+    ValueCount Read() override {
+        throw std::runtime_error("GroupSort output is write-only");
+    }
+
+    void Write(ValueCount record) override {
+        values_.Write(record.value);
+        counts_.Write(record.count);
+    }
+
+    std::size_t WriteBlock(const ValueCount* in, std::size_t n) override {
+        values_piece_.resize(n);
+        counts_piece_.resize(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            values_piece_[i] = in[i].value;
+            counts_piece_[i] = in[i].count;
+        }
+        std::size_t done = values_.WriteBlock(values_piece_.data(), n);
+        counts_.WriteBlock(counts_piece_.data(), done);
+        return done;
+    }
+
+    bool Next() override { return values_.Next() && counts_.Next(); }
+    bool Prev() override { return values_.Prev() && counts_.Prev(); }
+
+    bool Rewind(std::ptrdiff_t offset) override {
+        return values_.Rewind(offset) && counts_.Rewind(offset);
+    }
+
+    std::size_t Size() const override { return values_.Size(); }
+    std::size_t Position() const override { return values_.Position(); }
+
+    void SetMemoryLimit(std::size_t bytes) override {
+        values_.SetMemoryLimit(bytes / 3);
+        counts_.SetMemoryLimit(bytes - bytes / 3);
+    }
+
+    std::unique_ptr<BasicTape<ValueCount>> CreateTemporary(std::size_t, std::size_t) const override {
+        throw std::runtime_error("GroupSort output has no temporaries");
+    }
+
+private:
+    Tape& values_;
+    BasicTape<uint64_t>& counts_;
+    std::vector<int32_t> values_piece_;
+    std::vector<uint64_t> counts_piece_;
+};
+
+} // namespace detail
+
+// Сортировка записей Record по ключу KeyOf (record.hpp): серии - отсортированные
+// в памяти чанки, дальше то же сбалансированное k-путевое слияние, что и в
+// KWayMergeSort (kway_merge.hpp), на 2k временных лентах, последнее - сразу в output. Сравниваются только
+// ключи, записи переносятся целиком. k - не больше max_tapes / 2 и такое, чтобы
+// у каждой ленты был буфер хотя бы на две записи.
+// stable => записи с равными ключами остаются в исходном порядке: чанки
+// сортируются std::stable_sort, а при слиянии серии идут по порядку
+// и при равенстве побеждает более ранняя.
+// Combine (KeepFirst, SumCounts) объединяет записи с равными ключами сразу после
+// сортировки чанка и при каждом слиянии, так что серии и временные ленты
+// укорачиваются уже на первом проходе. Записей в output - stats.output_elements
+template <typename Record, typename KeyOf, typename Combine = KeepRecords>
+MergeStats RecordMergeSort(BasicTape<Record>& input, BasicTape<Record>& output,
+                           std::size_t memory_limit_bytes, std::size_t max_tapes,
+                           bool stable = false,
+                           SortProfile* profile = nullptr) {
+    constexpr std::size_t record_bytes = sizeof(Record);
+    if (max_tapes < 4) {
+        throw std::runtime_error("max_tapes too small for k-way merge");
+    }
+
+    // Половина памяти - на сортировку чанка, остальное - на ленты
+    std::size_t sort_buffer = memory_limit_bytes / 2;
+    std::size_t max_elements = sort_buffer / record_bytes;
+    if (max_elements == 0) {
+        throw std::runtime_error("Sort buffer too small for even one record");
+    }
+
+    KeyOf key_of;
+    auto by_key = [&key_of](const Record& a, const Record& b) { return key_of(a) < key_of(b); };
+    auto sort_chunk = [&by_key, stable](std::vector<Record>& chunk) {
+        if (stable) {
+            std::stable_sort(chunk.begin(), chunk.end(), by_key);
+        } else {
+            std::sort(chunk.begin(), chunk.end(), by_key);
+        }
+    };
+
+    MergeStats stats;
+    std::size_t total = input.Size();
+    std::size_t tape_memory = memory_limit_bytes - sort_buffer;
+    input.Reset();
+    output.Reset();
+
+    // Всё помещается в память
+    if (total <= max_elements) {
+        ScopedPhase phase(profile, "sort_in_memory");
+        input.SetMemoryLimit(tape_memory / 2);
+        output.SetMemoryLimit(tape_memory / 2);
+        std::vector<Record> chunk(total);
+        chunk.resize(input.ReadBlock(chunk.data(), chunk.size()));
+        sort_chunk(chunk);
+        detail::combineEqual<Record, KeyOf, Combine>(chunk);
+        output.WriteBlock(chunk.data(), chunk.size());
+        output.Reset();
+        stats.runs = total > 0 ? 1 : 0;
+        stats.output_elements = chunk.size();
+        return stats;
+    }
+
+    std::size_t ways = std::max<std::size_t>(2, max_tapes / 2);
+    while (ways > 2 && tape_memory / (2 * ways + 1) < 2 * record_bytes) {
+        --ways;
+    }
+    std::size_t per_tape = tape_memory / (2 * ways + 1);
+    std::size_t block_elements = StreamBlockElements(per_tape, record_bytes);
+    std::size_t tape_buffer = TapeBytesAfterBlock(per_tape, record_bytes);
+    stats.fan_in = ways;
+    input.SetMemoryLimit(per_tape);
+    output.SetMemoryLimit(tape_buffer);
+
+    std::vector<detail::RunTape<Record>> tapes(2 * ways);
+    for (auto& tape : tapes) {
+        tape.tape = input.CreateTemporary(total, tape_buffer);
+    }
+
+    // Серии раскладываем по первой группе по кругу
+    {
+        ScopedPhase phase(profile, "sort_chunks");
+        std::vector<Record> chunk(max_elements);
+        for (std::size_t read = 0, target = 0; read < total; target = (target + 1) % ways) {
+            chunk.resize(std::min(max_elements, total - read));
+            chunk.resize(input.ReadBlock(chunk.data(), chunk.size()));
+            read += chunk.size();
+
+            sort_chunk(chunk);
+            detail::combineEqual<Record, KeyOf, Combine>(chunk);
+            tapes[target].tape->WriteBlock(chunk.data(), chunk.size());
+            tapes[target].runs.push_back(chunk.size());
+            ++stats.runs;
+        }
+    }
+    input.SetMemoryLimit(0);
+
+    for (auto& tape : tapes) {
+        tape.tape->Reset();
+    }
+    detail::balancedMerge<Record, KeyOf, Combine>(tapes, ways, output, block_elements, stats, profile);
+
+    output.Reset();
+    return stats;
+}
+
+// Сортировка по возрастанию значений с перестановкой: на output - значения,
+// на positions - их исходные позиции на input (positions[i] - откуда взято output[i]).
+// Устойчивая: при равных значениях позиции идут по возрастанию. Значения
+// с позициями сортирует RecordMergeSort на временных лентах из make_temporary
+inline MergeStats ArgSort(Tape& input, Tape& output, BasicTape<uint64_t>& positions,
+                          std::size_t memory_limit_bytes, std::size_t max_tapes,
+                          const TemporaryFactory<IndexedValue>& make_temporary,
+                          SortProfile* profile = nullptr) {
+    if (output.Size() < input.Size() || positions.Size() < input.Size()) {
+        throw std::runtime_error("ArgSort output tapes are shorter than the input");
+    }
+    detail::PositionedInput source(input, make_temporary);
+    detail::SplitOutput sink(output, positions);
+    return RecordMergeSort<IndexedValue, IndexedValueKey>(source, sink, memory_limit_bytes, max_tapes,
+                                                          true, profile);
+}
+
+// Группировка значений (sort | uniq -c): в output - различные значения input
+// по возрастанию, в counts - сколько раз каждое встретилось (counts[i] - для output[i]).
+// counts == nullptr => только различные значения: сортируются сами значения
+// с KeepFirst. Иначе - записи «значение + счётчик» с SumCounts на временных
+// лентах из make_temporary, тогда вход - не длиннее 2^32 - 1 элементов.
+// Повторы объединяются уже в сериях, поэтому на данных с малым числом
+// различных значений временные ленты короче входа. Различных значений - stats.output_elements
+inline MergeStats GroupSort(Tape& input, Tape& output, BasicTape<uint64_t>* counts,
+                            std::size_t memory_limit_bytes, std::size_t max_tapes,
+                            const TemporaryFactory<ValueCount>& make_temporary,
+                            SortProfile* profile = nullptr) {
+    if (output.Size() < input.Size() || (counts && counts->Size() < input.Size())) {
+        throw std::runtime_error("GroupSort output tapes are shorter than the input");
+    }
+    if (!counts) {
+        return RecordMergeSort<int32_t, ScalarKey<int32_t>, KeepFirst>(input, output, memory_limit_bytes,
+                                                                       max_tapes, false, profile);
+    }
+    if (input.Size() > std::numeric_limits<uint32_t>::max()) {
+        throw std::runtime_error("GroupSort with counts supports at most 2^32 - 1 input elements");
+    }
+    detail::CountedInput source(input, make_temporary);
+    detail::CountedOutput sink(output, *counts);
+    return RecordMergeSort<ValueCount, ValueCountKey, SumCounts>(source, sink, memory_limit_bytes, max_tapes,
+                                                                 false, profile);
+}
+
+} // namespace ext_sort
@@ -0,0 +1,338 @@
+#pragma once
+
+#include "delays.hpp"
+#include "tape.hpp"
+#include "temp_pool.hpp"
+#include "virtual_clock.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Лента записей Record поверх файла: то же, что FileTape, но ячейка -
+// запись фиксированной ширины sizeof(Record). Буфер одного окна в пределах
+// лимита памяти, без async_io и участков. Для int32 используется FileTape
+template <typename Record>
+class RecordFileTape : public BasicTape<Record> {
+    static_assert(std::is_trivially_copyable_v<Record>, "Record is copied to and from the file as bytes");
+
+public:
+    explicit RecordFileTape(const std::string& filename,
+                            const Delays& delays,
+                            std::size_t memory_limit_bytes = 0)
+        : filename_(filename)
+        , delays_(delays)
+        , memory_limit_bytes_(memory_limit_bytes) {
+        std::size_t bytes = openFile();
+        if (bytes % CELL_SIZE != 0) {
+            std::fclose(file_);
+            throw std::runtime_error("Invalid record tape file size: " + filename_);
+        }
+        size_ = bytes / CELL_SIZE;
+    }
+
+    ~RecordFileTape() override {
+        flushAndClearBuffer();
+        std::fclose(file_);
+        if (report_metrics_) {
+            temporaries_->Add(metrics_);
+        }
+        if (is_temporary_) {
+            if (pool_) {
+                pool_->Release(filename_);
+            } else {
+                std::remove(filename_.c_str());
+            }
+        }
+    }
+
+    Record Read() override {
+        ++metrics_.reads;
+        applyDelay(delays_.read_ms);
+        return cell(position_);
+    }
+
+    void Write(Record value) override {
+        cell(position_) = value;
+        buffer_dirty_ = true;
+        ++metrics_.writes;
+        applyDelay(delays_.write_ms);
+    }
+
+    std::size_t ReadBlock(Record* out, std::size_t n) override {
+        n = std::min(n, size_ - position_);
+        for (std::size_t done = 0; done < n;) {
+            loadBuffer(position_ + done);
+            std::size_t offset = position_ + done - buffer_start_;
+            std::size_t chunk = std::min(n - done, buffer_.size() - offset);
+            std::copy_n(buffer_.data() + offset, chunk, out + done);
+            done += chunk;
+        }
+        metrics_.reads += n;
+
+        shiftAfterBlock(n, delays_.read_ms);
+        return n;
+    }
+
+    std::size_t WriteBlock(const Record* in, std::size_t n) override {
+        n = std::min(n, size_ - position_);
+        for (std::size_t done = 0; done < n;) {
+            loadBuffer(position_ + done);
+            std::size_t offset = position_ + done - buffer_start_;
+            std::size_t chunk = std::min(n - done, buffer_.size() - offset);
+            std::copy_n(in + done, chunk, buffer_.data() + offset);
+            buffer_dirty_ = true;
+            done += chunk;
+        }
+        metrics_.writes += n;
+
+        shiftAfterBlock(n, delays_.write_ms);
+        return n;
+    }
+
+    bool Next() override {
+        if (position_ + 1 >= size_) {
+            return false;
+        }
+        ++position_;
+        ++metrics_.shifts;
+        applyDelay(delays_.shift_ms);
+        return true;
+    }
+
+    bool Prev() override {
+        if (position_ == 0) {
+            return false;
+        }
+        --position_;
+        ++metrics_.shifts;
+        applyDelay(delays_.shift_ms);
+        return true;
+    }
+
+    bool Rewind(std::ptrdiff_t offset) override {
+        std::ptrdiff_t target = static_cast<std::ptrdiff_t>(position_) + offset;
+        if (target < 0 || (target >= static_cast<std::ptrdiff_t>(size_) && offset != 0)) {
+            return false;
+        }
+        position_ = static_cast<std::size_t>(target);
+        ++metrics_.rewinds;
+
+        std::size_t delay_if_use_next = delays_.shift_ms * static_cast<std::size_t>(std::abs(offset));
+        applyDelay(std::min(delays_.rewind_ms, delay_if_use_next));
+        return true;
+    }
+
+    std::size_t Size() const override {
+        return size_;
+    }
+
+    std::size_t Position() const override {
+        return position_;
+    }
+
+    void SetMemoryLimit(std::size_t bytes) override {
+        if (bytes < buffer_.size() * CELL_SIZE) {
+            flushAndClearBuffer();
+        }
+        memory_limit_bytes_ = bytes;
+    }
+
+    std::unique_ptr<BasicTape<Record>> CreateTemporary(std::size_t size,
+                                                       std::size_t buffer_bytes) const override {
+        return CreateTemporaryFile(filename_, size, buffer_bytes, delays_, temporaries_, pool_);
+    }
+
+    // Временная лента на файле из pool, возвращается туда при закрытии; без пула -
+    // в tmp/ (имя - от base), удаляется при закрытии. Нужна, когда исходной ленты
+    // записей нет; счётчики при закрытии дописываются в sink
+    static std::unique_ptr<RecordFileTape> CreateTemporaryFile(const std::string& base,
+                                                               std::size_t size,
+                                                               std::size_t buffer_bytes,
+                                                               const Delays& delays,
+                                                               std::shared_ptr<MetricsSink> sink,
+                                                               std::shared_ptr<TempTapePool> pool = nullptr) {
+        if (pool) {
+            std::unique_ptr<RecordFileTape> tmp(
+                new RecordFileTape(pool->Acquire(size * CELL_SIZE), delays, buffer_bytes, size));
+            tmp->is_temporary_ = true;
+            tmp->pool_ = std::move(pool);
+            tmp->temporaries_ = std::move(sink);
+            tmp->report_metrics_ = true;
+            return tmp;
+        }
+
+        std::string tmp_name = "tmp/" + tmpFilename(base);
+        std::FILE* f = std::fopen(tmp_name.c_str(), "wb");
+        if (!f) {
+            throw std::runtime_error("Cannot create tmp file: " + tmp_name);
+        }
+        if (size > 0) {
+            std::fseek(f, static_cast<long>(size * CELL_SIZE - 1), SEEK_SET);
+            std::fputc(0, f);
+        }
+        std::fclose(f);
+
+        auto tmp = std::make_unique<RecordFileTape>(tmp_name, delays, buffer_bytes);
+        tmp->is_temporary_ = true;
+        tmp->temporaries_ = std::move(sink);
+        tmp->report_metrics_ = true;
+        return tmp;
+    }
+
+    // Временные ленты (этой ленты и временных) берут файлы из pool
+    // и возвращают их туда при закрытии. nullptr => каждая создаёт свой файл в tmp/
+    // и удаляет его
+    void SetTemporaryPool(std::shared_ptr<TempTapePool> pool) {
+        pool_ = std::move(pool);
+    }
+
+    TapeMetrics Metrics() override {
+        return metrics_;
+    }
+
+    TapeMetrics TemporaryMetrics() const override {
+        return temporaries_->Total();
+    }
+
+private:
+    static constexpr std::size_t CELL_SIZE = sizeof(Record);
+
+    // Файл из пула бывает длиннее ленты и не кратен записи: лишние байты не видны
+    RecordFileTape(const std::string& filename,
+                   const Delays& delays,
+                   std::size_t memory_limit_bytes,
+                   std::size_t size)
+        : filename_(filename)
+        , delays_(delays)
+        , memory_limit_bytes_(memory_limit_bytes) {
+        if (openFile() < size * CELL_SIZE) {
+            std::fclose(file_);
+            throw std::runtime_error("Tmp file is too short: " + filename_);
+        }
+        size_ = size;
+    }
+
+    // Открывает filename_, возвращает длину файла в байтах
+    std::size_t openFile() {
+        file_ = std::fopen(filename_.c_str(), "rb+");
+        if (!file_) {
+            throw std::runtime_error("Cannot open file: " + filename_);
+        }
+        if (std::fseek(file_, 0, SEEK_END) != 0) {
+            std::fclose(file_);
+            throw std::runtime_error("Failed to seek end: " + filename_);
+        }
+        long end_pos = std::ftell(file_);
+        if (end_pos < 0) {
+            std::fclose(file_);
+            throw std::runtime_error("Failed to tell file size: " + filename_);
+        }
+        return static_cast<std::size_t>(end_pos);
+    }
+
+    static std::string tmpFilename(std::string base) {
+        std::ostringstream oss;
+        oss << std::this_thread::get_id();
+        for (char& c : base) {
+            if (c == '/' || c == '\\' || c == ':' || c == '.') {
+                c = '_';
+            }
+        }
+        return base + "_records_" + oss.str() + "_" + std::to_string(++tmp_counter_) + ".bin";
+    }
+
+    Record& cell(std::size_t index) {
+        loadBuffer(index);
+        return buffer_[index - buffer_start_];
+    }
+
+    // Сдвиг после блока из n ячеек: не дальше последней ячейки, с задержкой
+    void shiftAfterBlock(std::size_t n, std::size_t op_delay_ms) {
+        if (n == 0) {
+            return;
+        }
+        std::size_t moved = std::min(n, size_ - 1 - position_);
+        position_ += moved;
+        metrics_.shifts += moved;
+        applyDelay(op_delay_ms * n + delays_.shift_ms * moved);
+    }
+
+    void applyDelay(std::size_t ms) {
+        metrics_.delay_ms += ms;
+        VirtualClock::Occupy(busy_until_, ms);
+        if (ms > 0 && !delays_.virtual_time) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+        }
+    }
+
+    void flushAndClearBuffer() {
+        if (buffer_dirty_) {
+            std::fseek(file_, static_cast<long>(buffer_start_ * CELL_SIZE), SEEK_SET);
+            std::fwrite(buffer_.data(), CELL_SIZE, buffer_.size(), file_);
+            std::fflush(file_);
+            ++metrics_.io_calls;
+            metrics_.bytes_written += buffer_.size() * CELL_SIZE;
+            buffer_dirty_ = false;
+        }
+        buffer_.clear();
+        buffer_.shrink_to_fit();
+    }
+
+    // Окно ставим так, чтобы головка дальше двигалась внутри него
+    void loadBuffer(std::size_t target_cell) {
+        if (target_cell >= buffer_start_ && target_cell < buffer_start_ + buffer_.size()) {
+            return;
+        }
+        ++metrics_.buffer_misses;
+
+        bool forward = target_cell >= buffer_start_;
+        flushAndClearBuffer();
+
+        std::size_t max_cells = std::max<std::size_t>(memory_limit_bytes_ / CELL_SIZE, 1);
+        if (forward) {
+            buffer_start_ = target_cell;
+        } else {
+            buffer_start_ = target_cell + 1 > max_cells ? target_cell + 1 - max_cells : 0;
+        }
+        buffer_.resize(std::min(max_cells, size_ - buffer_start_));
+
+        std::fseek(file_, static_cast<long>(buffer_start_ * CELL_SIZE), SEEK_SET);
+        std::fread(buffer_.data(), CELL_SIZE, buffer_.size(), file_);
+        ++metrics_.io_calls;
+        metrics_.bytes_read += buffer_.size() * CELL_SIZE;
+    }
+
+    std::FILE* file_ = nullptr;
+    std::string filename_;
+    std::size_t size_ = 0;
+    std::size_t position_ = 0;
+
+    Delays delays_;
+    std::size_t busy_until_ = 0; // виртуальное время, до которого лента занята
+    std::size_t memory_limit_bytes_ = 0;
+
+    std::vector<Record> buffer_;
+    std::size_t buffer_start_ = 0;
+    bool buffer_dirty_ = false;
+
+    bool is_temporary_ = false;    // нужно ли удалить файл (или вернуть его в pool_)
+    std::shared_ptr<TempTapePool> pool_;
+
+    TapeMetrics metrics_;
+    std::shared_ptr<MetricsSink> temporaries_ = std::make_shared<MetricsSink>();
+    bool report_metrics_ = false;
+
+    static inline std::atomic<std::size_t> tmp_counter_{0};
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "external_sort.hpp"
+#include "tape.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <functional>
+#include <vector>
+
+namespace ext_sort {
+
+// Сортировка чанка в памяти: heap sort (глубина стека O(1)) или std::sort
+void SortChunk(std::vector<int32_t>& chunk, bool use_heap_sort);
+
+// Сортировка чанка в памяти способом formation (Sort, HeapSort или RadixSort)
+void SortChunk(std::vector<int32_t>& chunk, RunFormation formation);
+
+// LSD radix sort int32 по 8 бит, знаковый бит инвертируется.
+// scratch - рабочий буфер, растягивается до размера чанка; его можно
+// переиспользовать между вызовами. Проходы по разрядам, в которых
+// все элементы совпадают, пропускаются
+void RadixSortChunk(std::vector<int32_t>& chunk, std::vector<int32_t>& scratch);
+
+// Формирование начальных серий: читает input с текущей позиции, держа в памяти
+// не больше buffer_elements элементов, и записывает каждую отсортированную серию
+// на ленту, которую вернёт next_tape() перед её началом.
+// threads > 1 => чанки сортируются параллельно (кроме выбора с замещением):
+//                вход читает вызывающий поток, сортировка и запись идут в фоне,
+//                next_tape() вызывается из потока записи, по порядку серий.
+// Возвращает длины серий в порядке записи
+std::vector<std::size_t> GenerateRuns(Tape& input,
+                                      std::size_t buffer_elements,
+                                      RunFormation formation,
+                                      const std::function<Tape&()>& next_tape,
+                                      std::size_t threads = 1);
+
+// Быстрый путь для упорядоченного входа: читает input с начала, пока он
+// упорядочен по возрастанию или по убыванию, ничего не записывая.
+// Вход - одна серия => копирует его в output (убывающий - чтением назад,
+// без перемотки) и возвращает true. Иначе останавливается на первом нарушении
+// порядка и возвращает false: output не тронут, головка input - где остановилась.
+// Память делят input и output, из доли input берётся блок
+bool CopyIfPresorted(Tape& input, Tape& output, std::size_t memory_limit_bytes);
+
+// Максимальная длина серии из отсортированного чанка при таких параметрах:
+// при параллельной сортировке буфер делится между чанками в работе,
+// при RadixSort половина буфера уходит под рабочий буфер сортировки
+std::size_t RunChunkElements(std::size_t buffer_elements,
+                             RunFormation formation,
+                             std::size_t threads = 1);
+
+} // namespace ext_sort
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "delays.hpp"
+#include "external_sort.hpp"
+#include "metrics.hpp"
+#include "stream_tape.hpp"
+#include "tape.hpp"
+#include "temp_pool.hpp"
+
+#include <cstddef>
+
+#include <memory>
+
+namespace ext_sort {
+
+// Сортировка потока, длина которого известна только в конце (stdin, pipe).
+// Вход читается чанками по половине памяти; если он весь уместился в первый чанк,
+// чанк сортируется сразу в output, без временных файлов. Иначе отсортированные
+// серии дописываются подряд в файл-накопитель в каталоге pool, который после
+// конца входа открывается как FileTape с задержками delays. Серии сливаются
+// по k (MergeFanIn многофазного слияния: k участков накопителя и одна лента
+// для записи), промежуточные проходы пишут на временные ленты из pool,
+// последний - сразу в output. output пишется только вперёд, с текущей позиции.
+// formation: выбор с замещением и естественные серии заменяются сортировкой чанка
+MergeStats StreamMergeSort(StreamInputTape& input, Tape& output,
+                           std::size_t memory_limit_bytes,
+                           RunFormation formation,
+                           std::size_t max_tapes,
+                           const std::shared_ptr<TempTapePool>& pool,
+                           const Delays& delays,
+                           SortProfile* profile = nullptr);
+
+} // namespace ext_sort
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "metrics.hpp"
+#include "tape.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#include <memory>
+#include <vector>
+
+// Ленты поверх потока stdio (stdin, stdout, pipe): ячейки int32 подряд,
+// в порядке байт машины, как в файле FileTape. Двигаются только вперёд,
+// длина потока заранее неизвестна. Задержек нет. Поток не закрывается:
+// им владеет вызывающий
+
+// Чтение из потока. Size() - сколько ячеек уже прочитано из потока (вместе
+// с подчитанными в буфер), окончательный размер известен, когда Exhausted().
+// Next() пропускает текущую ячейку. Назад лента не двигается, не пишется
+// и не создаёт временных лент: такие операции бросают std::runtime_error
+class StreamInputTape : public Tape {
+public:
+    explicit StreamInputTape(std::FILE* stream, std::size_t memory_limit_bytes = 0);
+
+    int32_t Read() override;
+    void Write(int32_t value) override;
+    // Большие блоки читаются из потока сразу в out, минуя буфер
+    std::size_t ReadBlock(int32_t* out, std::size_t n) override;
+    std::size_t ReadBlockBackward(int32_t* out, std::size_t n) override;
+    std::size_t WriteBlock(const int32_t* in, std::size_t n) override;
+
+    bool Next() override;
+    bool Prev() override;
+    bool Rewind(std::ptrdiff_t offset) override; // только вперёд
+    void Reset() override;                       // только если ничего не прочитано
+
+    std::size_t Size() const override;
+    std::size_t Position() const override;
+
+    void SetMemoryLimit(std::size_t bytes) override;
+    std::unique_ptr<Tape> CreateTemporary(std::size_t size,
+                                          std::size_t buffer_bytes) const override;
+
+    TapeMetrics Metrics() override;
+    TapeMetrics TemporaryMetrics() const override;
+
+    // Поток кончился и все ячейки прочитаны. Если буфер пуст, подчитывает его
+    bool Exhausted();
+
+    // Сортировка потока сама создаёт временные ленты (не через CreateTemporary)
+    // и дописывает их счётчики сюда
+    void AddTemporaryMetrics(const TapeMetrics& metrics);
+
+private:
+    // Читает из потока до cells ячеек в out; меньше cells => поток кончился
+    std::size_t readStream(int32_t* out, std::size_t cells);
+    void fill();
+    std::size_t bufferCells() const;
+
+    std::FILE* stream_;
+    std::size_t memory_limit_bytes_;
+    std::vector<int32_t> buffer_;
+    std::size_t buffer_pos_ = 0; // первая непрочитанная ячейка буфера
+    std::size_t position_ = 0;
+    std::size_t size_ = 0;
+    bool eof_ = false;
+
+    TapeMetrics metrics_;
+    std::shared_ptr<MetricsSink> temporaries_ = std::make_shared<MetricsSink>();
+};
+
+// Запись в поток. Size() и Position() - сколько ячеек уже записано:
+// Write дописывает ячейку в конец и сразу сдвигает головку за неё,
+// Next() сдвигать некуда. Записанное копится в буфере до Flush()
+// (или до закрытия ленты). Чтение и движение назад бросают std::runtime_error
+class StreamOutputTape : public Tape {
+public:
+    explicit StreamOutputTape(std::FILE* stream, std::size_t memory_limit_bytes = 0);
+    ~StreamOutputTape() override;
+
+    int32_t Read() override;
+    void Write(int32_t value) override;
+    std::size_t ReadBlock(int32_t* out, std::size_t n) override;
+    std::size_t ReadBlockBackward(int32_t* out, std::size_t n) override;
+    std::size_t WriteBlock(const int32_t* in, std::size_t n) override;
+
+    bool Next() override;
+    bool Prev() override;
+    bool Rewind(std::ptrdiff_t offset) override;
+    void Reset() override; // только если ничего не записано
+
+    std::size_t Size() const override;
+    std::size_t Position() const override;
+
+    void SetMemoryLimit(std::size_t bytes) override;
+    std::unique_ptr<Tape> CreateTemporary(std::size_t size,
+                                          std::size_t buffer_bytes) const override;
+
+    TapeMetrics Metrics() override;
+
+    // Отдать накопленное в поток (fwrite + fflush)
+    void Flush();
+
+private:
+    void writeStream(const int32_t* in, std::size_t cells);
+    std::size_t bufferCells() const;
+
+    std::FILE* stream_;
+    std::size_t memory_limit_bytes_;
+    std::vector<int32_t> buffer_;
+    std::size_t position_ = 0;
+
+    TapeMetrics metrics_;
+};
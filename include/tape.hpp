@@ -1,19 +1,24 @@
 #pragma once
 
+#include "metrics.hpp"
+
 #include <cstddef>
 #include <cstdint>
 
 #include <memory>
 
-class Tape {
+// Лента из ячеек типа Cell. Сортировки int32 работают с Tape = BasicTape<int32_t>,
+// записи фиксированной ширины (record.hpp) - с BasicTape<запись>
+template <typename Cell>
+class BasicTape {
 protected:
-    Tape() = default;
+    BasicTape() = default;
 public:
-    virtual ~Tape() = default;
+    virtual ~BasicTape() = default;
 
     // Чтение и запись по текущей позиции
-    virtual int32_t Read() = 0;
-    virtual void Write(int32_t value) = 0;
+    virtual Cell Read() = 0;
+    virtual void Write(Cell value) = 0;
 
     // Сдвиги: на одну ячейку и перемотка
     // Если перемещение невозможно, возвращают false и ничего не делают
@@ -21,6 +26,46 @@ public:
     virtual bool Prev() = 0;
     virtual bool Rewind(std::ptrdiff_t offset) = 0;
 
+    // Блочные чтение и запись: то же, что n раз Read()/Write() и Next(),
+    // но за один вызов. Головка сдвигается на обработанные ячейки
+    // (на последней ячейке ленты остаётся, как и Next()).
+    // Возвращают число обработанных ячеек: меньше n, если лента кончилась
+    virtual std::size_t ReadBlock(Cell* out, std::size_t n) {
+        std::size_t done = 0;
+        while (done < n && Position() < Size()) {
+            out[done++] = Read();
+            if (!Next()) {
+                break;
+            }
+        }
+        return done;
+    }
+
+    virtual std::size_t WriteBlock(const Cell* in, std::size_t n) {
+        std::size_t done = 0;
+        while (done < n && Position() < Size()) {
+            Write(in[done++]);
+            if (!Next()) {
+                break;
+            }
+        }
+        return done;
+    }
+
+    // Блочное чтение в обратную сторону: то же, что n раз Read() и Prev().
+    // out[0] - текущая ячейка, дальше - ячейки ближе к началу ленты.
+    // Головка на первой ячейке ленты остаётся, как и Prev()
+    virtual std::size_t ReadBlockBackward(Cell* out, std::size_t n) {
+        std::size_t done = 0;
+        while (done < n && Position() < Size()) {
+            out[done++] = Read();
+            if (!Prev()) {
+                break;
+            }
+        }
+        return done;
+    }
+
     // Позиция и размер (в элементах)
     virtual std::size_t Size() const = 0;
     virtual std::size_t Position() const = 0;
@@ -33,12 +78,43 @@ public:
     // Устанавливает лимит памяти (для кешей/буферов) в байтах
     virtual void SetMemoryLimit(std::size_t bytes) = 0;
 
+    // Открыть независимый доступ к ячейкам [first, first + length) этой ленты:
+    // своя головка (позиции от 0) и свой буфер buffer_bytes. Нужен, чтобы
+    // несколько потоков работали с непересекающимися участками одной ленты.
+    // Перед открытием лента сбрасывает свой буфер на носитель; изменения,
+    // сделанные через участок, видны ей после следующей загрузки буфера.
+    // nullptr => лента не поддерживает участки
+    virtual std::unique_ptr<BasicTape> OpenSection(std::size_t /*first*/,
+                                              std::size_t /*length*/,
+                                              std::size_t /*buffer_bytes*/) {
+        return nullptr;
+    }
+
+    // Поддерживает ли лента OpenSection. Ничего не открывает и не сбрасывает
+    virtual bool SupportsSections() const {
+        return false;
+    }
+
+    // Счётчики операций этой ленты с момента открытия.
+    // Ленты без учёта возвращают нули
+    virtual TapeMetrics Metrics() {
+        return {};
+    }
+
+    // Сумма счётчиков уже закрытых временных лент и участков,
+    // созданных от этой ленты (и от них самих)
+    virtual TapeMetrics TemporaryMetrics() const {
+        return {};
+    }
+
     // Создать временную ленту с указанным размером и буфером
-    virtual std::unique_ptr<Tape> CreateTemporary(std::size_t size, std::size_t buffer_bytes) const = 0;
+    virtual std::unique_ptr<BasicTape> CreateTemporary(std::size_t size, std::size_t buffer_bytes) const = 0;
 
     // Запрещаем копирование
-    Tape(const Tape&) = delete;
-    Tape& operator=(const Tape&) = delete;
-    Tape(Tape&&) = default;
-    Tape& operator=(Tape&&) = default;
+    BasicTape(const BasicTape&) = delete;
+    BasicTape& operator=(const BasicTape&) = delete;
+    BasicTape(BasicTape&&) = default;
+    BasicTape& operator=(BasicTape&&) = default;
 };
+
+using Tape = BasicTape<int32_t>;
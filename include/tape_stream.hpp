@@ -0,0 +1,122 @@
+#pragma once
+
+#include "tape.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <vector>
+
+namespace ext_sort {
+
+// Больше этого блок потока не делаем: дальше выигрыш от блочного API не растёт
+constexpr std::size_t MAX_STREAM_BLOCK_ELEMENTS = 4096;
+
+// Сколько элементов размером cell_bytes отдать под блок потока из бюджета
+// ленты tape_bytes: половину, но не больше MAX_STREAM_BLOCK_ELEMENTS и не меньше одного
+inline std::size_t StreamBlockElements(std::size_t tape_bytes, std::size_t cell_bytes = sizeof(int32_t)) {
+    std::size_t half = tape_bytes / 2 / cell_bytes;
+    return std::max<std::size_t>(1, std::min(half, MAX_STREAM_BLOCK_ELEMENTS));
+}
+
+// Остаток бюджета ленты после блока потока
+inline std::size_t TapeBytesAfterBlock(std::size_t tape_bytes, std::size_t cell_bytes = sizeof(int32_t)) {
+    std::size_t block_bytes = StreamBlockElements(tape_bytes, cell_bytes) * cell_bytes;
+    return tape_bytes > block_bytes ? tape_bytes - block_bytes : 0;
+}
+
+// Последовательное чтение серии с ленты блоками через ReadBlock.
+// backward => через ReadBlockBackward: от текущей ячейки к началу ленты
+template <typename Cell>
+class BasicTapeReader {
+public:
+    BasicTapeReader(BasicTape<Cell>& tape, std::size_t block_elements, bool backward = false)
+        : tape_(&tape)
+        , block_(std::max<std::size_t>(block_elements, 1))
+        , backward_(backward) {}
+
+    // Начать читать очередные remaining элементов с текущей позиции ленты
+    void Start(std::size_t remaining) {
+        remaining_ = remaining;
+        index_ = 0;
+        filled_ = 0;
+        fill();
+    }
+
+    bool Empty() const { return index_ == filled_; }
+    const Cell& Peek() const { return block_[index_]; }
+
+    void Pop() {
+        if (++index_ == filled_) {
+            fill();
+        }
+    }
+
+    // Сколько элементов серии ещё не прочитано с ленты (без уже загруженных в блок)
+    std::size_t Unread() const { return remaining_; }
+
+private:
+    void fill() {
+        std::size_t want = std::min(remaining_, block_.size());
+        index_ = 0;
+        if (want == 0) {
+            filled_ = 0;
+        } else {
+            filled_ = backward_ ? tape_->ReadBlockBackward(block_.data(), want)
+                                : tape_->ReadBlock(block_.data(), want);
+        }
+        remaining_ -= filled_;
+    }
+
+    BasicTape<Cell>* tape_;
+    std::vector<Cell> block_;
+    bool backward_;
+    std::size_t remaining_ = 0;
+    std::size_t index_ = 0;
+    std::size_t filled_ = 0;
+};
+
+// Последовательная запись на ленту блоками через WriteBlock.
+// Перед перемоткой ленты или чтением с неё нужно вызвать Flush()
+template <typename Cell>
+class BasicTapeWriter {
+public:
+    BasicTapeWriter(BasicTape<Cell>& tape, std::size_t block_elements)
+        : tape_(&tape) {
+        block_.reserve(std::max<std::size_t>(block_elements, 1));
+    }
+
+    ~BasicTapeWriter() {
+        Flush();
+    }
+
+    void Push(const Cell& value) {
+        block_.push_back(value);
+        if (block_.size() == block_.capacity()) {
+            Flush();
+        }
+    }
+
+    void Flush() {
+        if (!block_.empty()) {
+            tape_->WriteBlock(block_.data(), block_.size());
+            block_.clear();
+        }
+    }
+
+    // Писать дальше на другую ленту
+    void Retarget(BasicTape<Cell>& tape) {
+        Flush();
+        tape_ = &tape;
+    }
+
+private:
+    BasicTape<Cell>* tape_;
+    std::vector<Cell> block_;
+};
+
+using TapeReader = BasicTapeReader<int32_t>;
+using TapeWriter = BasicTapeWriter<int32_t>;
+
+} // namespace ext_sort
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Пул файлов временных лент в одном каталоге (например, на быстром локальном диске).
+// Все временные ленты (FileTape, MmapTape, CompressedTape, RecordFileTape) создают файлы здесь.
+// Закрытая временная лента не удаляет свой файл, а возвращает его в пул, и следующая
+// лента того же или меньшего размера получает его без создания и удлинения файла:
+// между проходами слияния и между сортировками, которые делят один пул.
+// Содержимое выданного файла не определено (там остаются старые серии) -
+// алгоритмы пишут ячейки временных лент раньше, чем читают.
+// Потокобезопасен. Файлы удаляются вместе с пулом
+class TempTapePool {
+public:
+    // Создаёт каталог directory и сразу размещает на диске (fallocate)
+    // preallocate_files файлов по preallocate_bytes байт
+    explicit TempTapePool(const std::string& directory,
+                          std::size_t preallocate_files = 0,
+                          std::size_t preallocate_bytes = 0);
+    ~TempTapePool();
+
+    TempTapePool(const TempTapePool&) = delete;
+    TempTapePool& operator=(const TempTapePool&) = delete;
+
+    // Путь к файлу не меньше bytes байт: наименьший подходящий из свободных,
+    // иначе удлиняется наибольший свободный, иначе создаётся новый.
+    // Удлинённый и новый файлы - с дырой: место на диске занимает только записанное
+    std::string Acquire(std::size_t bytes);
+    // Вернуть файл, выданный Acquire
+    void Release(const std::string& path);
+
+    // Новое имя в каталоге пула для лент, которые ведут свой файл сами
+    std::string UniqueName(const std::string& prefix);
+
+    const std::string& Directory() const;
+    std::size_t Files() const;     // сколько файлов в пуле
+    std::size_t DiskBytes() const; // сколько байт они занимают
+    std::size_t Reused() const;    // сколько раз файл выдан без создания и удлинения
+
+private:
+    struct File {
+        std::string path;
+        std::size_t bytes;
+        bool busy;
+    };
+
+    std::string nextName(const std::string& prefix); // под mutex_
+    static void allocate(const std::string& path, std::size_t bytes, bool reserve);
+
+    mutable std::mutex mutex_;
+    std::string directory_;
+    std::vector<File> files_;
+    std::size_t counter_ = 0;
+    std::size_t reused_ = 0;
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+
+// Виртуальное время лент в миллисекундах. У каждого потока своё "сейчас":
+// операция ленты начинается, когда свободны и поток, и сама лента, и сдвигает
+// оба на свою задержку. Ленты, с которыми работают разные потоки, поэтому
+// работают одновременно. Задача в другом потоке начинает с момента запуска
+// (Set), а дождавшийся её поток продолжает с момента её окончания (AdvanceTo).
+// Время идёт и тогда, когда задержки реально выдерживаются
+class VirtualClock {
+public:
+    // Текущее время потока
+    static std::size_t Now();
+    static void Set(std::size_t ms);
+    // Время потока - не раньше ms
+    static void AdvanceTo(std::size_t ms);
+
+    // Операция длительностью ms на ленте, занятой до busy_until
+    static void Occupy(std::size_t& busy_until, std::size_t ms);
+};
@@ -1,10 +1,19 @@
 #include "external_sort.hpp"
 
+#include "run_generator.hpp"
 #include "tape.hpp"
+#include "tape_stream.hpp"
+#include "virtual_clock.hpp"
 
 #include <cstdint>
 
 #include <algorithm>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <numeric>
 #include <stdexcept>
 #include <vector>
 
@@ -12,24 +21,34 @@ namespace {
 
 // 2 ленты: в одной последовательно записаны чанки с четными номерами
 //          в другой - с нечетными
+// Длины чанков храним явно: при выборе с замещением они разные
 struct Chunks {
     std::unique_ptr<Tape> even_tape;
     std::unique_ptr<Tape> odd_tape;
-    std::size_t chunk_length;
+    std::deque<std::size_t> even_runs;
+    std::deque<std::size_t> odd_runs;
     std::size_t total_size;
+    bool descending = false; // серии упорядочены по убыванию (после обратного прохода)
+
+    std::size_t Count() const {
+        return even_runs.size() + odd_runs.size();
+    }
 
     void Swap(Chunks& other) {
         even_tape.swap(other.even_tape);
         odd_tape.swap(other.odd_tape);
-        std::swap(chunk_length, other.chunk_length);
+        even_runs.swap(other.even_runs);
+        odd_runs.swap(other.odd_runs);
         std::swap(total_size, other.total_size);
+        std::swap(descending, other.descending);
     }
 };
 
 Chunks sortChunks(
     Tape& input,
     std::size_t memory_limit_bytes,
-    bool use_heap_sort
+    ext_sort::RunFormation formation,
+    std::size_t threads
 ) {
     input.Reset();
 
@@ -46,53 +65,55 @@ Chunks sortChunks(
         throw std::runtime_error("Sort buffer too small for even one element");
     }
 
-    std::vector<int32_t> buffer;
-    buffer.reserve(max_elements);
-
     Chunks chunks{
         input.CreateTemporary(total, buffer_per_tape),
         input.CreateTemporary(total, buffer_per_tape),
-        max_elements,
+        {},
+        {},
         total
     };
 
     bool write_to_even = true;
-    std::size_t processed = 0;
-    while (processed < total) {
-        buffer.clear();
-        std::size_t chunk_size = std::min(max_elements, total - processed);
-
-        for (std::size_t i = 0; i < chunk_size; ++i) {
-            buffer.push_back(input.Read());
-
-            input.Next();
-        }
-
-        if (use_heap_sort) {
-            std::make_heap(buffer.begin(), buffer.end());
-            std::sort_heap(buffer.begin(), buffer.end());
-        } else {
-            std::sort(buffer.begin(), buffer.end());
-        }
-
+    std::vector<std::size_t> runs = ext_sort::GenerateRuns(input, max_elements, formation, [&]() -> Tape& {
         Tape* dest = write_to_even ? chunks.even_tape.get() : chunks.odd_tape.get();
-        for (std::size_t i = 0; i < buffer.size(); ++i) {
-            dest->Write(buffer[i]);
-            dest->Next();
-        }
-
         write_to_even = !write_to_even;
-        processed += chunk_size;
+        return *dest;
+    }, threads);
+    for (std::size_t i = 0; i < runs.size(); ++i) {
+        (i % 2 == 0 ? chunks.even_runs : chunks.odd_runs).push_back(runs[i]);
     }
 
     input.SetMemoryLimit(0);
     return chunks;
 }
 
-// Одна итерация: увеличиваем размер чанков в 2 раза
+// Сливает две серии в dest. При равных ключах первой идёт левая серия.
+// before(a, b) => a идёт раньше b: std::less - по возрастанию, std::greater - по убыванию
+template <typename Before = std::less<int32_t>>
+void mergeTwo(ext_sort::TapeReader& left, ext_sort::TapeReader& right, ext_sort::TapeWriter& dest,
+              Before before = {}) {
+    while (!left.Empty() && !right.Empty()) {
+        if (!before(right.Peek(), left.Peek())) {
+            dest.Push(left.Peek());
+            left.Pop();
+        } else {
+            dest.Push(right.Peek());
+            right.Pop();
+        }
+    }
+    for (; !left.Empty(); left.Pop()) {
+        dest.Push(left.Peek());
+    }
+    for (; !right.Empty(); right.Pop()) {
+        dest.Push(right.Peek());
+    }
+}
+
+// Одна итерация: сливаем чанки попарно, их число уменьшается в 2 раза
 void mergeIteration(
     Chunks& in,
-    Chunks& out
+    Chunks& out,
+    std::size_t block_elements
 ) {
     in.even_tape->Reset();
     in.odd_tape->Reset();
@@ -100,93 +121,503 @@ void mergeIteration(
     out.odd_tape->Reset();
 
     bool write_to_even = true;
-    std::size_t processed = 0;
 
-    Tape* curr_even = in.even_tape.get();
-    Tape* curr_odd  = in.odd_tape.get();
+    ext_sort::TapeReader left(*in.even_tape, block_elements);
+    ext_sort::TapeReader right(*in.odd_tape, block_elements);
+    ext_sort::TapeWriter dest(*out.even_tape, block_elements);
+
+    while (!in.even_runs.empty()) {
+        std::size_t left_size = in.even_runs.front();
+        in.even_runs.pop_front();
+        std::size_t right_size = 0;
+        if (!in.odd_runs.empty()) {
+            right_size = in.odd_runs.front();
+            in.odd_runs.pop_front();
+        }
+
+        left.Start(left_size);
+        right.Start(right_size);
+        dest.Retarget(write_to_even ? *out.even_tape : *out.odd_tape);
+        mergeTwo(left, right, dest);
+
+        (write_to_even ? out.even_runs : out.odd_runs).push_back(left_size + right_size);
+        write_to_even = !write_to_even;
+    }
+
+    dest.Flush();
+}
+
+// Ставит головку на последнюю из written ячеек, записанных с начала ленты.
+// После записи головка уже на ней (если лента кончилась) или на следующей
+void seekLast(Tape& tape, std::size_t written) {
+    if (written == 0) {
+        return;
+    }
+    std::size_t last = written - 1;
+    if (tape.Position() == last + 1) {
+        tape.Prev();
+    } else if (tape.Position() != last) {
+        tape.Rewind(static_cast<std::ptrdiff_t>(last) - static_cast<std::ptrdiff_t>(tape.Position()));
+    }
+}
+
+// Итерация без перемоток: серии in читаются назад с конца лент, результат
+// пишется вперёд с начала out (их головки там после прошлого обратного прохода).
+// Прочитанная назад серия идёт в обратном порядке, поэтому и серии out
+// упорядочены в другую сторону, чем серии in
+void mergeIterationBackward(
+    Chunks& in,
+    Chunks& out,
+    std::size_t block_elements
+) {
+    seekLast(*in.even_tape, std::accumulate(in.even_runs.begin(), in.even_runs.end(), std::size_t{0}));
+    seekLast(*in.odd_tape, std::accumulate(in.odd_runs.begin(), in.odd_runs.end(), std::size_t{0}));
+    for (Tape* tape : {out.even_tape.get(), out.odd_tape.get()}) {
+        if (tape->Position() != 0) {
+            tape->Reset();
+        }
+    }
+
+    bool write_to_even = true;
+
+    ext_sort::TapeReader left(*in.even_tape, block_elements, true);
+    ext_sort::TapeReader right(*in.odd_tape, block_elements, true);
+    ext_sort::TapeWriter dest(*out.even_tape, block_elements);
+
+    // Чётных серий бывает на одну больше: последняя из них без пары, её и читаем первой
+    while (!in.even_runs.empty()) {
+        std::size_t left_size = in.even_runs.back();
+        in.even_runs.pop_back();
+        std::size_t right_size = 0;
+        if (in.odd_runs.size() > in.even_runs.size()) {
+            right_size = in.odd_runs.back();
+            in.odd_runs.pop_back();
+        }
+
+        left.Start(left_size);
+        right.Start(right_size);
+        dest.Retarget(write_to_even ? *out.even_tape : *out.odd_tape);
+        if (in.descending) {
+            mergeTwo(left, right, dest, std::less<int32_t>());
+        } else {
+            mergeTwo(left, right, dest, std::greater<int32_t>());
+        }
+
+        (write_to_even ? out.even_runs : out.odd_runs).push_back(left_size + right_size);
+        write_to_even = !write_to_even;
+    }
+
+    dest.Flush();
+    out.descending = !in.descending;
+}
+
+// Пара серий прохода: левая - на in.even_tape, правая - на in.odd_tape,
+// результат - на out.even_tape или out.odd_tape (по очереди)
+struct MergePair {
+    std::size_t left_offset;
+    std::size_t left_length;
+    std::size_t right_offset;
+    std::size_t right_length;
+    bool to_even;
+    std::size_t out_offset;
+
+    std::size_t Length() const {
+        return left_length + right_length;
+    }
+};
+
+// Точка на пути слияния пары: сколько элементов левой и правой серий
+// попало в результат до неё
+struct MergePoint {
+    std::size_t pair;
+    std::size_t left;
+    std::size_t right;
+};
+
+// Часть пары, которую сливает один поток
+struct MergePiece {
+    std::size_t pair;
+    MergePoint begin;
+    MergePoint end;
+};
 
-    while (processed < in.total_size) {
-        std::size_t left_size  = std::min(in.chunk_length, in.total_size - processed);
-        std::size_t right_size = std::min(in.chunk_length, in.total_size - processed - left_size);
+// Непрерывный диапазон ячеек ленты, который нужен одному потоку
+struct Span {
+    std::size_t begin = 0;
+    std::size_t end = 0;
+    bool used = false;
 
-        std::size_t left_index = 0;
-        std::size_t right_index = 0;
-        int32_t left_value = left_size ? curr_even->Read() : 0;
-        int32_t right_value = right_size ? curr_odd->Read() : 0;
+    void Add(std::size_t first, std::size_t last) {
+        if (!used) {
+            begin = first;
+            used = true;
+        }
+        end = last;
+    }
+};
 
-        Tape* dest = write_to_even ? out.even_tape.get() : out.odd_tape.get();
-        while (left_index < left_size || right_index < right_size) {
-            if (left_index < left_size && (right_index >= right_size || left_value <= right_value)) {
-                dest->Write(left_value);
-                ++left_index;
+// Раскладка прохода: где лежат серии каждой пары и куда пишется результат.
+// Снимает серии со списков in и заносит серии результата в out
+std::vector<MergePair> planPass(Chunks& in, Chunks& out) {
+    std::vector<MergePair> pairs;
+    std::size_t left_offset = 0;
+    std::size_t right_offset = 0;
+    std::size_t out_offsets[2] = {0, 0};
+    bool to_even = true;
+
+    while (!in.even_runs.empty()) {
+        MergePair pair{left_offset, in.even_runs.front(), right_offset, 0, to_even, out_offsets[to_even]};
+        in.even_runs.pop_front();
+        if (!in.odd_runs.empty()) {
+            pair.right_length = in.odd_runs.front();
+            in.odd_runs.pop_front();
+        }
 
-                curr_even->Next();
+        left_offset += pair.left_length;
+        right_offset += pair.right_length;
+        out_offsets[to_even] += pair.Length();
+        (to_even ? out.even_runs : out.odd_runs).push_back(pair.Length());
 
-                if (left_index < left_size) {
-                    left_value = curr_even->Read();
-                }
+        pairs.push_back(pair);
+        to_even = !to_even;
+    }
+
+    return pairs;
+}
+
+int32_t readAt(Tape& tape, std::size_t index) {
+    tape.Rewind(static_cast<std::ptrdiff_t>(index) - static_cast<std::ptrdiff_t>(tape.Position()));
+    return tape.Read();
+}
+
+// Пересечение пути слияния пары с диагональю diagonal (merge path):
+// первые diagonal элементов результата - это left элементов левой серии
+// и diagonal - left правой. Ищем двоичным поиском по диагонали
+MergePoint splitPair(Chunks& in, const std::vector<MergePair>& pairs, std::size_t index, std::size_t diagonal) {
+    const MergePair& pair = pairs[index];
+    std::size_t lo = diagonal > pair.right_length ? diagonal - pair.right_length : 0;
+    std::size_t hi = std::min(diagonal, pair.left_length);
+
+    if (lo < hi) {
+        std::unique_ptr<Tape> left = in.even_tape->OpenSection(pair.left_offset, pair.left_length, 0);
+        std::unique_ptr<Tape> right = in.odd_tape->OpenSection(pair.right_offset, pair.right_length, 0);
+        while (lo < hi) {
+            std::size_t mid = lo + (hi - lo) / 2;
+            if (readAt(*left, mid) <= readAt(*right, diagonal - mid - 1)) {
+                lo = mid + 1;
             } else {
-                dest->Write(right_value);
-                ++right_index;
-
-                curr_odd->Next();
-                
-                if (right_index < right_size) {
-                    right_value = curr_odd->Read();
-                }
+                hi = mid;
             }
-            ++processed;
-            dest->Next();
         }
-        write_to_even = !write_to_even;
     }
 
-    out.chunk_length = in.chunk_length * 2;
+    return {index, lo, diagonal - lo};
+}
+
+// Делим результат прохода на parts равных частей; границы частей,
+// попавшие внутрь пары, находим по пути слияния
+std::vector<MergePoint> splitPass(Chunks& in, const std::vector<MergePair>& pairs, std::size_t parts) {
+    std::vector<MergePoint> points;
+    std::size_t index = 0;
+    std::size_t pair_start = 0;
+
+    for (std::size_t part = 0; part <= parts; ++part) {
+        std::size_t target = in.total_size / parts * part + in.total_size % parts * part / parts;
+        while (index < pairs.size() && pair_start + pairs[index].Length() <= target) {
+            pair_start += pairs[index].Length();
+            ++index;
+        }
+        points.push_back(index < pairs.size()
+                             ? splitPair(in, pairs, index, target - pair_start)
+                             : MergePoint{pairs.size(), 0, 0});
+    }
+
+    return points;
+}
+
+// Части пар между точками begin и end
+std::vector<MergePiece> piecesBetween(const std::vector<MergePair>& pairs, MergePoint begin, MergePoint end) {
+    std::vector<MergePiece> pieces;
+    for (std::size_t i = begin.pair; i < pairs.size() && i <= end.pair; ++i) {
+        MergePoint first = i == begin.pair ? begin : MergePoint{i, 0, 0};
+        MergePoint last = i == end.pair ? end : MergePoint{i, pairs[i].left_length, pairs[i].right_length};
+        if (first.left + first.right < last.left + last.right) {
+            pieces.push_back({i, first, last});
+        }
+    }
+    return pieces;
+}
+
+// Поток сливает свои части пар. Ленты - участки, открытые только для него
+void mergePieces(
+    const std::vector<MergePair>& pairs,
+    const std::vector<MergePiece>& pieces,
+    Tape& left_tape,
+    Tape& right_tape,
+    Tape& even_tape,
+    Tape& odd_tape,
+    std::size_t block_elements
+) {
+    ext_sort::TapeReader left(left_tape, block_elements);
+    ext_sort::TapeReader right(right_tape, block_elements);
+    ext_sort::TapeWriter even_dest(even_tape, block_elements);
+    ext_sort::TapeWriter odd_dest(odd_tape, block_elements);
+
+    for (const MergePiece& piece : pieces) {
+        left.Start(piece.end.left - piece.begin.left);
+        right.Start(piece.end.right - piece.begin.right);
+        mergeTwo(left, right, pairs[piece.pair].to_even ? even_dest : odd_dest);
+    }
+}
+
+// Та же итерация, но результат делится на threads равных частей,
+// и каждую часть сливает свой поток через собственные участки лент.
+// Пока пар много, потоки берут целые пары, на последних проходах
+// пары делятся по пути слияния. Память делится между потоками поровну.
+// final_output задают на последнем проходе, когда в in ровно две серии
+void mergeIterationParallel(
+    Chunks& in,
+    Chunks& out,
+    std::size_t memory_limit_bytes,
+    std::size_t threads,
+    Tape* final_output = nullptr
+) {
+    std::vector<MergePair> pairs = planPass(in, out);
+    std::vector<MergePoint> points = splitPass(in, pairs, threads);
+
+    // У потока четыре участка лент, из доли каждого - блок
+    std::size_t section_bytes = memory_limit_bytes / threads / 4;
+    std::size_t block_elements = ext_sort::StreamBlockElements(section_bytes);
+    std::size_t section_buffer = ext_sort::TapeBytesAfterBlock(section_bytes);
+
+    struct Worker {
+        std::vector<MergePiece> pieces;
+        std::unique_ptr<Tape> left;
+        std::unique_ptr<Tape> right;
+        std::unique_ptr<Tape> even;
+        std::unique_ptr<Tape> odd;
+    };
+
+    // Последний проход (одна пара) пишет сразу в final_output; участки
+    // нечётной ленты тогда пустые, и лент out может не быть
+    Tape& even_target = final_output ? *final_output : *out.even_tape;
+    Tape& odd_target = final_output ? *final_output : *out.odd_tape;
+
+    // Участки открываем заранее: OpenSection сбрасывает буфер исходной ленты
+    std::vector<Worker> workers;
+    for (std::size_t t = 0; t < threads; ++t) {
+        std::vector<MergePiece> pieces = piecesBetween(pairs, points[t], points[t + 1]);
+        if (pieces.empty()) {
+            continue;
+        }
+
+        Span left, right, even, odd;
+        for (const MergePiece& piece : pieces) {
+            const MergePair& pair = pairs[piece.pair];
+            left.Add(pair.left_offset + piece.begin.left, pair.left_offset + piece.end.left);
+            right.Add(pair.right_offset + piece.begin.right, pair.right_offset + piece.end.right);
+            (pair.to_even ? even : odd).Add(pair.out_offset + piece.begin.left + piece.begin.right,
+                                            pair.out_offset + piece.end.left + piece.end.right);
+        }
+
+        workers.push_back({
+            std::move(pieces),
+            in.even_tape->OpenSection(left.begin, left.end - left.begin, section_buffer),
+            in.odd_tape->OpenSection(right.begin, right.end - right.begin, section_buffer),
+            even_target.OpenSection(even.begin, even.end - even.begin, section_buffer),
+            odd_target.OpenSection(odd.begin, odd.end - odd.begin, section_buffer)
+        });
+    }
+
+    // Потоки начинают в одно виртуальное время, проход кончается с последним из них
+    std::vector<std::future<std::size_t>> running;
+    for (Worker& worker : workers) {
+        running.push_back(std::async(std::launch::async, [&pairs, &worker, block_elements,
+                                                          start = VirtualClock::Now()] {
+            VirtualClock::Set(start);
+            mergePieces(pairs, worker.pieces, *worker.left, *worker.right,
+                        *worker.even, *worker.odd, block_elements);
+            return VirtualClock::Now();
+        }));
+    }
+
+    // Дожидаемся всех потоков, даже если какой-то упал: они пишут в наши ленты
+    std::exception_ptr error;
+    for (std::future<std::size_t>& r : running) {
+        try {
+            VirtualClock::AdvanceTo(r.get());
+        } catch (...) {
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+// Последний проход: две оставшиеся серии сливаются сразу в output.
+// Серии по убыванию читаем с конца (после обратного прохода головки уже там),
+// по возрастанию - с начала
+void mergeFinal(
+    Chunks& in,
+    Tape& output,
+    std::size_t block_elements
+) {
+    if (in.descending) {
+        seekLast(*in.even_tape, in.even_runs.front());
+        seekLast(*in.odd_tape, in.odd_runs.front());
+    } else {
+        in.even_tape->Reset();
+        in.odd_tape->Reset();
+    }
+    output.Reset();
+
+    ext_sort::TapeReader left(*in.even_tape, block_elements, in.descending);
+    ext_sort::TapeReader right(*in.odd_tape, block_elements, in.descending);
+    ext_sort::TapeWriter dest(output, block_elements);
+    left.Start(in.even_runs.front());
+    right.Start(in.odd_runs.front());
+    mergeTwo(left, right, dest);
+    dest.Flush();
 }
 
 void mergeAllChunks(
     Chunks chunks,
     Tape& output,
-    std::size_t memory_limit_bytes
+    std::size_t memory_limit_bytes,
+    std::size_t threads,
+    bool alternate,
+    ext_sort::SortProfile* profile
 ) {
-    // Распределяем память на пять лент: текущие две, новые две, и выход
+    // Распределяем память на пять лент: текущие две, новые две, и выход.
+    // Из доли каждой ленты берём блок для блочного чтения/записи
     std::size_t per_buffer = memory_limit_bytes / 5;
-    chunks.even_tape->SetMemoryLimit(per_buffer);
-    chunks.odd_tape->SetMemoryLimit(per_buffer);
-    output.SetMemoryLimit(per_buffer);
-
-    // Создаём структуры для текущей и следующей фаз
+    std::size_t block_elements = ext_sort::StreamBlockElements(per_buffer);
+    std::size_t tape_buffer = ext_sort::TapeBytesAfterBlock(per_buffer);
+    chunks.even_tape->SetMemoryLimit(tape_buffer);
+    chunks.odd_tape->SetMemoryLimit(tape_buffer);
+    output.SetMemoryLimit(tape_buffer);
+
+    // Создаём структуры для текущей и следующей фаз. Последний проход пишет
+    // сразу в output, так что при двух сериях новые ленты не нужны
     Chunks current = std::move(chunks);
-    Chunks next{
-        current.even_tape->CreateTemporary(current.total_size, per_buffer),
-        current.odd_tape->CreateTemporary(current.total_size, per_buffer),
-        current.chunk_length,
-        current.total_size
-    };
-    next.even_tape->SetMemoryLimit(per_buffer);
-    next.odd_tape->SetMemoryLimit(per_buffer);
+    Chunks next{};
+    if (current.Count() > 2) {
+        next = {
+            current.even_tape->CreateTemporary(current.total_size, tape_buffer),
+            current.odd_tape->CreateTemporary(current.total_size, tape_buffer),
+            {},
+            {},
+            current.total_size
+        };
+        next.even_tape->SetMemoryLimit(tape_buffer);
+        next.odd_tape->SetMemoryLimit(tape_buffer);
+    }
+
+    // Параллельно сливаем, только если ленты умеют открывать участки.
+    // Участки читаются только вперёд, поэтому проходы без перемоток - в одном потоке
+    bool parallel = !alternate && threads > 1 && current.even_tape->SupportsSections();
+
+    while (current.Count() > 2) {
+        ext_sort::ScopedPhase phase(profile, "merge_pass");
+        if (alternate) {
+            mergeIterationBackward(current, next, block_elements);
+            current.Swap(next);
+            continue;
+        }
 
-    while (current.chunk_length < current.total_size) {
         current.even_tape->Reset();
         current.odd_tape->Reset();
         next.even_tape->Reset();
         next.odd_tape->Reset();
 
-        mergeIteration(current, next);
+        if (parallel) {
+            mergeIterationParallel(current, next, memory_limit_bytes, threads);
+        } else {
+            mergeIteration(current, next, block_elements);
+        }
 
         current.Swap(next);
     }
 
-    // Финальная запись в выходную ленту
-    current.even_tape->Reset();
+    if (current.Count() == 2) {
+        ext_sort::ScopedPhase phase(profile, "final_merge");
+        if (parallel && output.SupportsSections()) {
+            mergeIterationParallel(current, next, memory_limit_bytes, threads, &output);
+        } else {
+            mergeFinal(current, output, block_elements);
+        }
+        return;
+    }
+
+    // Одна серия (вход уже был упорядочен): копируем её в выходную ленту.
+    // Серию по убыванию читаем с конца - так она идёт по возрастанию, и перематывать ленту не нужно
+    ext_sort::ScopedPhase phase(profile, "copy_to_output");
+    if (current.descending) {
+        seekLast(*current.even_tape, current.total_size);
+    } else {
+        current.even_tape->Reset();
+    }
     output.Reset();
-    for (std::size_t i = 0; i < current.total_size; ++i) {
-        output.Write(current.even_tape->Read());
-        current.even_tape->Next();
-        output.Next();
+    std::vector<int32_t> block(block_elements);
+    for (std::size_t copied = 0; copied < current.total_size;) {
+        std::size_t want = std::min(block_elements, current.total_size - copied);
+        std::size_t n = current.descending ? current.even_tape->ReadBlockBackward(block.data(), want)
+                                           : current.even_tape->ReadBlock(block.data(), want);
+        output.WriteBlock(block.data(), n);
+        copied += n;
     }
 }
 
+void chunkMergeSort(
+    Tape& input,
+    Tape& output,
+    std::size_t memory_limit_bytes,
+    ext_sort::RunFormation formation,
+    std::size_t threads,
+    bool alternate,
+    ext_sort::SortProfile* profile
+) {
+    if (memory_limit_bytes < sizeof(int32_t)) {
+        throw std::runtime_error("Memory limit too small for even one element");
+    }
+
+    // Всё помещается в один чанк: генератор серий пишет сразу в выходную ленту,
+    // без временных лент и копирования. Выбор с замещением дал бы тут больше одной серии
+    std::size_t sort_buffer = std::max(memory_limit_bytes / 2, sizeof(int32_t));
+    std::size_t max_elements = sort_buffer / sizeof(int32_t);
+    ext_sort::RunFormation in_memory =
+        formation == ext_sort::RunFormation::ReplacementSelection ? ext_sort::RunFormation::Sort : formation;
+    if (input.Size() <= ext_sort::RunChunkElements(max_elements, in_memory)) {
+        ext_sort::ScopedPhase phase(profile, "sort_in_memory");
+        input.Reset();
+        input.SetMemoryLimit(0);
+        output.SetMemoryLimit(memory_limit_bytes - sort_buffer);
+        output.Reset();
+        ext_sort::GenerateRuns(input, max_elements, in_memory, [&]() -> Tape& { return output; });
+        output.Reset();
+        return;
+    }
+
+    if (formation == ext_sort::RunFormation::NaturalRuns) {
+        ext_sort::ScopedPhase phase(profile, "presorted_scan");
+        if (ext_sort::CopyIfPresorted(input, output, memory_limit_bytes)) {
+            output.Reset();
+            return;
+        }
+    }
+
+    Chunks chunks = [&] {
+        ext_sort::ScopedPhase phase(profile, "sort_chunks");
+        return sortChunks(input, memory_limit_bytes, formation, threads);
+    }();
+    mergeAllChunks(std::move(chunks), output, memory_limit_bytes, threads, alternate, profile);
+
+    output.Reset();
+}
+
 } // namespace
 
 namespace ext_sort {
@@ -197,14 +628,30 @@ void ChunkMergeSort(
     std::size_t memory_limit_bytes,
     bool use_heap_sort
 ) {
-    if (memory_limit_bytes < sizeof(int32_t)) {
-        throw std::runtime_error("Memory limit too small for even one element");
-    }
+    ChunkMergeSort(input, output, memory_limit_bytes,
+                   use_heap_sort ? RunFormation::HeapSort : RunFormation::Sort);
+}
 
-    Chunks chunks = sortChunks(input, memory_limit_bytes, use_heap_sort);
-    mergeAllChunks(std::move(chunks), output, memory_limit_bytes);
-    
-    output.Reset();
+void ChunkMergeSort(
+    Tape& input,
+    Tape& output,
+    std::size_t memory_limit_bytes,
+    RunFormation formation,
+    std::size_t threads,
+    SortProfile* profile
+) {
+    chunkMergeSort(input, output, memory_limit_bytes, formation, threads, false, profile);
+}
+
+void AlternatingMergeSort(
+    Tape& input,
+    Tape& output,
+    std::size_t memory_limit_bytes,
+    RunFormation formation,
+    std::size_t threads,
+    SortProfile* profile
+) {
+    chunkMergeSort(input, output, memory_limit_bytes, formation, threads, true, profile);
 }
 
 } // namespace ext_sort
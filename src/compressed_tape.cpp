@@ -0,0 +1,412 @@
+#include "compressed_tape.hpp"
+
+#include "virtual_clock.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+std::atomic<std::size_t> CompressedTape::tmp_counter_{0};
+
+namespace {
+
+constexpr std::size_t CELL_SIZE = sizeof(int32_t);
+constexpr std::size_t HEADER_BYTES = 2 * sizeof(uint32_t) + 1; // первое значение, минимум, ширина
+
+uint32_t zigzag(int32_t v) {
+    return (static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31);
+}
+
+int32_t unzigzag(uint32_t v) {
+    return static_cast<int32_t>((v >> 1) ^ (0u - (v & 1)));
+}
+
+// Разность соседних значений по модулю 2^32 - обратима при любом переполнении
+uint32_t deltaCode(int32_t prev, int32_t cur) {
+    return zigzag(static_cast<int32_t>(static_cast<uint32_t>(cur) - static_cast<uint32_t>(prev)));
+}
+
+void putU32(std::vector<uint8_t>& out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+    }
+}
+
+uint32_t getU32(const uint8_t* in) {
+    return static_cast<uint32_t>(in[0]) | static_cast<uint32_t>(in[1]) << 8 |
+           static_cast<uint32_t>(in[2]) << 16 | static_cast<uint32_t>(in[3]) << 24;
+}
+
+// Блок из одной ячейки - только значение, иначе заголовок и n - 1 кодов разностей
+// по width бит (младшие биты - раньше)
+void encodeBlock(const int32_t* in, std::size_t n, std::vector<uint8_t>& out) {
+    out.clear();
+    putU32(out, static_cast<uint32_t>(in[0]));
+    if (n == 1) {
+        return;
+    }
+
+    uint32_t min_code = UINT32_MAX;
+    uint32_t max_code = 0;
+    for (std::size_t i = 1; i < n; ++i) {
+        uint32_t code = deltaCode(in[i - 1], in[i]);
+        min_code = std::min(min_code, code);
+        max_code = std::max(max_code, code);
+    }
+    uint32_t range = max_code - min_code;
+    uint8_t width = 0;
+    while (width < 32 && (range >> width) != 0) {
+        ++width;
+    }
+    putU32(out, min_code);
+    out.push_back(width);
+
+    uint64_t acc = 0;
+    unsigned bits = 0;
+    for (std::size_t i = 1; i < n && width > 0; ++i) {
+        acc |= static_cast<uint64_t>(deltaCode(in[i - 1], in[i]) - min_code) << bits;
+        bits += width;
+        while (bits >= 8) {
+            out.push_back(static_cast<uint8_t>(acc));
+            acc >>= 8;
+            bits -= 8;
+        }
+    }
+    if (bits > 0) {
+        out.push_back(static_cast<uint8_t>(acc));
+    }
+}
+
+void decodeBlock(const uint8_t* in, std::size_t bytes, int32_t* out, std::size_t n) {
+    if (bytes < sizeof(uint32_t) || (n > 1 && bytes < HEADER_BYTES)) {
+        throw std::runtime_error("Corrupted compressed tape block");
+    }
+    out[0] = static_cast<int32_t>(getU32(in));
+    if (n == 1) {
+        return;
+    }
+
+    uint32_t min_code = getU32(in + 4);
+    unsigned width = in[8];
+    if (width > 32 || bytes < HEADER_BYTES + ((n - 1) * width + 7) / 8) {
+        throw std::runtime_error("Corrupted compressed tape block");
+    }
+
+    const uint8_t* packed = in + HEADER_BYTES;
+    uint64_t mask = width == 32 ? 0xFFFFFFFFull : (1ull << width) - 1;
+    uint64_t acc = 0;
+    unsigned bits = 0;
+    for (std::size_t i = 1; i < n; ++i) {
+        while (bits < width) {
+            acc |= static_cast<uint64_t>(*packed++) << bits;
+            bits += 8;
+        }
+        uint32_t code = static_cast<uint32_t>(acc & mask) + min_code;
+        acc >>= width;
+        bits -= width;
+        out[i] = static_cast<int32_t>(static_cast<uint32_t>(out[i - 1]) +
+                                      static_cast<uint32_t>(unzigzag(code)));
+    }
+}
+
+std::string threadId() {
+    std::ostringstream oss;
+    oss << std::this_thread::get_id();
+    return oss.str();
+}
+
+} // namespace
+
+CompressedTape::CompressedTape(const std::string& filename,
+                               std::size_t size,
+                               const Delays& delays,
+                               std::size_t buffer_bytes,
+                               std::shared_ptr<MetricsSink> temporaries,
+                               std::shared_ptr<TempTapePool> pool)
+    : filename_(filename)
+    , size_(size)
+    , delays_(delays)
+    , block_cells_(std::max(buffer_bytes / (2 * CELL_SIZE), MIN_BLOCK_CELLS))
+    , slots_((size + block_cells_ - 1) / block_cells_)
+    , temporaries_(std::move(temporaries))
+    , pool_(std::move(pool)) {
+    file_ = std::fopen(filename_.c_str(), "wb+");
+    if (!file_) {
+        throw std::runtime_error("Cannot create tmp file: " + filename_);
+    }
+}
+
+CompressedTape::~CompressedTape() {
+    flushBlock();
+    std::fclose(file_);
+    temporaries_->Add(metrics_);
+    std::remove(filename_.c_str());
+}
+
+int32_t CompressedTape::Read() {
+    loadBlock(position_, false);
+    if (position_ % block_cells_ >= valid_) {
+        completeBlock();
+    }
+    ++metrics_.reads;
+    applyDelay(delays_.read_ms);
+    return buffer_[position_ % block_cells_];
+}
+
+void CompressedTape::Write(int32_t value) {
+    std::size_t offset = position_ % block_cells_;
+    loadBlock(position_, offset == 0);
+    if (offset > valid_) {
+        completeBlock();
+    }
+    buffer_[offset] = value;
+    valid_ = std::max(valid_, offset + 1);
+    buffer_dirty_ = true;
+    ++metrics_.writes;
+    applyDelay(delays_.write_ms);
+}
+
+std::size_t CompressedTape::ReadBlock(int32_t* out, std::size_t n) {
+    std::size_t start = position_;
+    n = std::min(n, size_ - start);
+
+    for (std::size_t done = 0; done < n;) {
+        std::size_t cell = start + done;
+        std::size_t offset = cell % block_cells_;
+        loadBlock(cell, false);
+        std::size_t chunk = std::min(n - done, buffer_.size() - offset);
+        if (offset + chunk > valid_) {
+            completeBlock();
+        }
+        std::copy_n(buffer_.data() + offset, chunk, out + done);
+        done += chunk;
+    }
+    metrics_.reads += n;
+
+    shiftAfterBlock(n, delays_.read_ms);
+    return n;
+}
+
+std::size_t CompressedTape::ReadBlockBackward(int32_t* out, std::size_t n) {
+    if (size_ == 0) {
+        return 0;
+    }
+    std::size_t start = position_;
+    n = std::min(n, start + 1);
+
+    for (std::size_t done = 0; done < n;) {
+        std::size_t cell = start - done;
+        std::size_t offset = cell % block_cells_;
+        loadBlock(cell, false);
+        if (offset >= valid_) {
+            completeBlock();
+        }
+        std::size_t chunk = std::min(n - done, offset + 1);
+        std::reverse_copy(buffer_.data() + offset + 1 - chunk, buffer_.data() + offset + 1, out + done);
+        done += chunk;
+    }
+    metrics_.reads += n;
+
+    shiftBackAfterBlock(n, delays_.read_ms);
+    return n;
+}
+
+std::size_t CompressedTape::WriteBlock(const int32_t* in, std::size_t n) {
+    std::size_t start = position_;
+    n = std::min(n, size_ - start);
+
+    for (std::size_t done = 0; done < n;) {
+        std::size_t cell = start + done;
+        std::size_t offset = cell % block_cells_;
+        loadBlock(cell, offset == 0);
+        if (offset > valid_) {
+            completeBlock();
+        }
+        std::size_t chunk = std::min(n - done, buffer_.size() - offset);
+        std::copy_n(in + done, chunk, buffer_.data() + offset);
+        valid_ = std::max(valid_, offset + chunk);
+        buffer_dirty_ = true;
+        done += chunk;
+    }
+    metrics_.writes += n;
+
+    shiftAfterBlock(n, delays_.write_ms);
+    return n;
+}
+
+bool CompressedTape::Next() {
+    if (position_ + 1 >= size_) {
+        return false;
+    }
+    ++position_;
+    ++metrics_.shifts;
+    applyDelay(delays_.shift_ms);
+    return true;
+}
+
+bool CompressedTape::Prev() {
+    if (position_ == 0) {
+        return false;
+    }
+    --position_;
+    ++metrics_.shifts;
+    applyDelay(delays_.shift_ms);
+    return true;
+}
+
+bool CompressedTape::Rewind(std::ptrdiff_t offset) {
+    std::ptrdiff_t target = static_cast<std::ptrdiff_t>(position_) + offset;
+    if (target < 0 || (target >= static_cast<std::ptrdiff_t>(size_) && offset != 0)) {
+        return false;
+    }
+    position_ = static_cast<std::size_t>(target);
+    ++metrics_.rewinds;
+
+    std::size_t delay_if_use_next = delays_.shift_ms * static_cast<std::size_t>(std::abs(offset));
+    applyDelay(std::min(delays_.rewind_ms, delay_if_use_next));
+    return true;
+}
+
+std::size_t CompressedTape::Size() const {
+    return size_;
+}
+
+std::size_t CompressedTape::Position() const {
+    return position_;
+}
+
+void CompressedTape::SetMemoryLimit(std::size_t bytes) {
+    if (bytes < buffer_.size() * CELL_SIZE) {
+        flushBlock();
+        buffer_.clear();
+        buffer_.shrink_to_fit();
+        encoded_.clear();
+        encoded_.shrink_to_fit();
+        buffer_block_ = NO_BLOCK;
+    }
+}
+
+std::unique_ptr<Tape> CompressedTape::CreateTemporary(std::size_t size,
+                                                      std::size_t buffer_bytes) const {
+    // Имя - не от filename_: у лент, созданных от временных, оно росло бы с каждым проходом
+    std::string tmp_name = pool_ ? pool_->UniqueName("compressed")
+                                 : "tmp/compressed_" + threadId() + "_" + std::to_string(++tmp_counter_) + ".bin";
+    return std::make_unique<CompressedTape>(tmp_name, size, delays_, buffer_bytes, temporaries_, pool_);
+}
+
+TapeMetrics CompressedTape::Metrics() {
+    return metrics_;
+}
+
+TapeMetrics CompressedTape::TemporaryMetrics() const {
+    return temporaries_->Total();
+}
+
+std::size_t CompressedTape::StoredBytes() const {
+    return static_cast<std::size_t>(file_end_);
+}
+
+void CompressedTape::loadBlock(std::size_t cell, bool from_start) {
+    std::size_t block = cell / block_cells_;
+    if (block == buffer_block_) {
+        return;
+    }
+    ++metrics_.buffer_misses;
+
+    flushBlock();
+    buffer_.resize(blockCells(block));
+    buffer_block_ = block;
+    valid_ = 0;
+    if (!from_start) {
+        readSlot(block, buffer_);
+        valid_ = buffer_.size();
+    }
+}
+
+void CompressedTape::completeBlock() {
+    if (valid_ == buffer_.size()) {
+        return;
+    }
+    std::vector<int32_t> stored(buffer_.size());
+    readSlot(buffer_block_, stored);
+    std::copy(stored.begin() + valid_, stored.end(), buffer_.begin() + valid_);
+    valid_ = buffer_.size();
+}
+
+void CompressedTape::flushBlock() {
+    if (!buffer_dirty_) {
+        return;
+    }
+    completeBlock();
+    storeSlot(buffer_block_);
+    buffer_dirty_ = false;
+}
+
+void CompressedTape::readSlot(std::size_t block, std::vector<int32_t>& cells) {
+    const Slot& slot = slots_[block];
+    if (slot.bytes == 0) {
+        std::fill(cells.begin(), cells.end(), 0);
+        return;
+    }
+    encoded_.resize(slot.bytes);
+    std::fseek(file_, static_cast<long>(slot.offset), SEEK_SET);
+    if (std::fread(encoded_.data(), 1, slot.bytes, file_) != slot.bytes) {
+        throw std::runtime_error("Failed to read compressed block: " + filename_);
+    }
+    ++metrics_.io_calls;
+    metrics_.bytes_read += slot.bytes;
+    decodeBlock(encoded_.data(), slot.bytes, cells.data(), cells.size());
+}
+
+// Блок пишется на своё место, а если больше не помещается - в конец файла
+// с запасом в восьмую часть, чтобы следующие проходы писали на то же место
+void CompressedTape::storeSlot(std::size_t block) {
+    encodeBlock(buffer_.data(), buffer_.size(), encoded_);
+    Slot& slot = slots_[block];
+    if (encoded_.size() > slot.capacity) {
+        slot.offset = file_end_;
+        slot.capacity = static_cast<uint32_t>(encoded_.size() + encoded_.size() / 8);
+        file_end_ += slot.capacity;
+    }
+    slot.bytes = static_cast<uint32_t>(encoded_.size());
+
+    std::fseek(file_, static_cast<long>(slot.offset), SEEK_SET);
+    std::fwrite(encoded_.data(), 1, encoded_.size(), file_);
+    ++metrics_.io_calls;
+    metrics_.bytes_written += encoded_.size();
+}
+
+std::size_t CompressedTape::blockCells(std::size_t block) const {
+    return std::min(block_cells_, size_ - block * block_cells_);
+}
+
+void CompressedTape::shiftAfterBlock(std::size_t n, std::size_t op_delay_ms) {
+    if (n == 0) {
+        return;
+    }
+    std::size_t moved = std::min(n, size_ - 1 - position_);
+    position_ += moved;
+    metrics_.shifts += moved;
+    applyDelay(op_delay_ms * n + delays_.shift_ms * moved);
+}
+
+void CompressedTape::shiftBackAfterBlock(std::size_t n, std::size_t op_delay_ms) {
+    if (n == 0) {
+        return;
+    }
+    std::size_t moved = std::min(n, position_);
+    position_ -= moved;
+    metrics_.shifts += moved;
+    applyDelay(op_delay_ms * n + delays_.shift_ms * moved);
+}
+
+void CompressedTape::applyDelay(std::size_t ms) {
+    metrics_.delay_ms += ms;
+    VirtualClock::Occupy(busy_until_, ms);
+    if (ms > 0 && !delays_.virtual_time) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    }
+}
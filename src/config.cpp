@@ -2,6 +2,51 @@
 
 #include <yaml-cpp/yaml.h>
 
+#include <stdexcept>
+
+namespace {
+    MergeMode parseMergeMode(const std::string& name) {
+        if (name == "binary") {
+            return MergeMode::Binary;
+        }
+        if (name == "kway") {
+            return MergeMode::KWay;
+        }
+        if (name == "polyphase") {
+            return MergeMode::Polyphase;
+        }
+        if (name == "alternating") {
+            return MergeMode::Alternating;
+        }
+        if (name == "distribution") {
+            return MergeMode::Distribution;
+        }
+        throw std::runtime_error("Unknown merge_mode: " + name);
+    }
+
+    RecordFormat parseRecordFormat(const std::string& name) {
+        if (name == "int32") {
+            return RecordFormat::Int32;
+        }
+        if (name == "int64") {
+            return RecordFormat::Int64;
+        }
+        if (name == "uint64") {
+            return RecordFormat::UInt64;
+        }
+        if (name == "float") {
+            return RecordFormat::Float;
+        }
+        if (name == "double") {
+            return RecordFormat::Double;
+        }
+        if (name == "kv64") {
+            return RecordFormat::KeyValue64;
+        }
+        throw std::runtime_error("Unknown record_format: " + name);
+    }
+} // namespace
+
 Config Config::Load(const std::string& path) {
     YAML::Node node = YAML::LoadFile(path);
     Config cfg;
@@ -11,10 +56,51 @@ Config Config::Load(const std::string& path) {
     cfg.delays.write_ms  = node["delays"]["write_ms"].as<std::size_t>();
     cfg.delays.shift_ms  = node["delays"]["shift_ms"].as<std::size_t>();
     cfg.delays.rewind_ms = node["delays"]["rewind_ms"].as<std::size_t>();
+    cfg.delays.virtual_time = node["delays"]["virtual_time"]
+        ? node["delays"]["virtual_time"].as<bool>()
+        : false;
 
     // Ограничения по памяти
     cfg.memory_limit_bytes = node["memory_limit_bytes"].as<std::size_t>();
+    cfg.async_io = node["async_io"] ? node["async_io"].as<bool>() : false;
+    cfg.mmap_tapes = node["mmap_tapes"] ? node["mmap_tapes"].as<bool>() : false;
+    cfg.compress_temporaries = node["compress_temporaries"]
+        ? node["compress_temporaries"].as<bool>()
+        : false;
+    cfg.temp_dir = node["temp_dir"] ? node["temp_dir"].as<std::string>() : "tmp";
+    cfg.temp_preallocate = node["temp_preallocate"] ? node["temp_preallocate"].as<std::size_t>() : 0;
     cfg.strict_stack_limit  = node["strict_stack_limit"].as<bool>();
+    cfg.radix_sort = node["radix_sort"] ? node["radix_sort"].as<bool>() : false;
+    cfg.replacement_selection = node["replacement_selection"]
+        ? node["replacement_selection"].as<bool>()
+        : false;
+
+    cfg.natural_runs = node["natural_runs"] ? node["natural_runs"].as<bool>() : false;
+
+    cfg.threads = node["threads"] ? node["threads"].as<std::size_t>() : 1;
+
+    // Слияние (опционально)
+    cfg.merge_mode = node["merge_mode"]
+        ? parseMergeMode(node["merge_mode"].as<std::string>())
+        : MergeMode::Binary;
+    cfg.max_tapes = node["max_tapes"] ? node["max_tapes"].as<std::size_t>() : 16;
+
+    cfg.auto_plan = node["auto_plan"] ? node["auto_plan"].as<bool>() : false;
+
+    cfg.record_format = node["record_format"]
+        ? parseRecordFormat(node["record_format"].as<std::string>())
+        : RecordFormat::Int32;
+    cfg.stable = node["stable"] ? node["stable"].as<bool>() : false;
+    cfg.top_k = node["top_k"] ? node["top_k"].as<std::size_t>() : 0;
+    cfg.top_k_largest = node["top_k_largest"] ? node["top_k_largest"].as<bool>() : false;
+    if (node["quantiles"] && node["quantiles"].IsSequence()) {
+        cfg.quantiles = node["quantiles"].as<std::vector<double>>();
+    }
+    cfg.index_file = node["index_file"] ? node["index_file"].as<std::string>() : "";
+    cfg.distinct = node["distinct"] ? node["distinct"].as<bool>() : false;
+    cfg.counts_file = node["counts_file"] ? node["counts_file"].as<std::string>() : "";
+
+    cfg.metrics_file = node["metrics_file"] ? node["metrics_file"].as<std::string>() : "";
 
     // Опциональный диапазон
     if (node["value_range"] && node["value_range"].IsSequence() && node["value_range"].size() == 2) {
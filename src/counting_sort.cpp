@@ -1,119 +1,734 @@
 #include "external_sort.hpp"
 
+#include "growing_tape.hpp"
 #include "tape.hpp"
+#include "tape_stream.hpp"
 
 #include <cstdint>
 
 #include <algorithm>
+#include <limits>
+#include <memory>
+#include <optional>
 #include <stdexcept>
+#include <utility>
 #include <vector>
 
 namespace {
     constexpr std::size_t MAX_TAPE_BUFFER_BYTES = 128ull * 1024 * 1024;
 
+    // Меньше этого буфер ленты-раздела не делаем: число разделов ограничено памятью
+    constexpr std::size_t MIN_PARTITION_BUFFER_BYTES = 4 * 1024;
+
     // Количество памяти, которое будет отведено на каждую ленту (входную и выходную)
     std::size_t chooseTapeBufferSize(std::size_t memory_limit_bytes) {
         std::size_t quarter = memory_limit_bytes / 4;
         return std::min(quarter, MAX_TAPE_BUFFER_BYTES);
     }
 
-    // Подсчёт элементов в диапазоне [win_start, win_end]
+    // Число значений в [lo, hi]
+    uint64_t rangeWidth(int64_t lo, int64_t hi) {
+        return static_cast<uint64_t>(hi - lo) + 1;
+    }
+
+    // Подсчёт элементов в диапазоне [win_start, win_end], лента читается блоками в block
     std::vector<std::size_t> countWindow(Tape& tape,
                                          std::size_t total_elems,
                                          int32_t win_start,
-                                         int32_t win_end) {
+                                         int32_t win_end,
+                                         std::vector<int32_t>& block) {
         std::vector<std::size_t> counts(static_cast<std::size_t>(win_end - win_start + 1), 0);
 
         tape.Reset();
-        for (std::size_t i = 0; i < total_elems; ++i) {
-            int32_t v = tape.Read();
-            if (v >= win_start && v <= win_end) {
-                counts[static_cast<std::size_t>(v - win_start)]++;
+        for (std::size_t i = 0; i < total_elems;) {
+            std::size_t n = tape.ReadBlock(block.data(), std::min(block.size(), total_elems - i));
+            for (std::size_t j = 0; j < n; ++j) {
+                int32_t v = block[j];
+                if (v >= win_start && v <= win_end) {
+                    counts[static_cast<std::size_t>(v - win_start)]++;
+                }
             }
-            tape.Next();
+            i += n;
         }
 
         return counts;
     }
 
-    // Запись cnt значений value на ленту
-    void writeCount(Tape& tape, int32_t value, std::size_t cnt) {
-        for (std::size_t c = 0; c < cnt; ++c) {
-            tape.Write(value);
-            tape.Next();
+    // Запись cnt значений value на ленту блоками из block
+    void writeCount(Tape& tape, int32_t value, std::size_t cnt, std::vector<int32_t>& block) {
+        std::fill(block.begin(), block.begin() + std::min(cnt, block.size()), value);
+        while (cnt > 0) {
+            std::size_t n = std::min(cnt, block.size());
+            tape.WriteBlock(block.data(), n);
+            cnt -= n;
+        }
+    }
+
+    // Куда пишутся посчитанные значения. При сортировке значение повторяется
+    // столько раз, сколько встретилось (writeCount). При группировке - один раз,
+    // а его счётчик, если нужен, - на ленту counts, без развёртывания в повторы
+    class CountSink {
+    public:
+        // Сортировка: output пишется блоками из block
+        CountSink(Tape& output, std::vector<int32_t>& block)
+            : output_(output)
+            , block_(block) {}
+
+        // Группировка: значения и счётчики копятся в своих блоках по block_elements
+        CountSink(Tape& output, BasicTape<uint64_t>* counts, std::vector<int32_t>& block,
+                  std::size_t block_elements)
+            : output_(output)
+            , block_(block)
+            , values_(std::in_place, output, block_elements) {
+            if (counts) {
+                counts_.emplace(*counts, block_elements);
+            }
+        }
+
+        void Put(int32_t value, std::size_t count) {
+            if (count == 0) {
+                return;
+            }
+            ++groups_;
+            if (!values_) {
+                writeCount(output_, value, count, block_);
+                return;
+            }
+            values_->Push(value);
+            if (counts_) {
+                counts_->Push(count);
+            }
+        }
+
+        // Повторы не нужны: значение достаточно записать на ленту-раздел один раз
+        bool DropsRepeats() const {
+            return values_ && !counts_;
+        }
+
+        // Число различных значений
+        std::size_t Groups() const {
+            return groups_;
+        }
+
+        void Flush() {
+            if (values_) {
+                values_->Flush();
+            }
+            if (counts_) {
+                counts_->Flush();
+            }
+        }
+
+    private:
+        Tape& output_;
+        std::vector<int32_t>& block_;
+        std::optional<ext_sort::TapeWriter> values_;
+        std::optional<ext_sort::BasicTapeWriter<uint64_t>> counts_;
+        std::size_t groups_ = 0;
+    };
+
+    // Плотные счётчики окнами по window значений: по проходу ленты на окно
+    void countRange(Tape& tape,
+                    std::size_t total_elems,
+                    int32_t lo,
+                    int32_t hi,
+                    std::size_t window,
+                    CountSink& sink,
+                    std::vector<int32_t>& block,
+                    ext_sort::SortProfile* profile) {
+        for (int64_t start = lo; start <= hi; start += static_cast<int64_t>(window)) {
+            ext_sort::ScopedPhase phase(profile, "count_window");
+            int64_t end = std::min<int64_t>(hi, start + static_cast<int64_t>(window) - 1);
+
+            std::vector<std::size_t> counts = countWindow(tape, total_elems,
+                                                          static_cast<int32_t>(start),
+                                                          static_cast<int32_t>(end), block);
+
+            for (std::size_t i = 0; i < counts.size(); ++i) {
+                sink.Put(static_cast<int32_t>(start + static_cast<int64_t>(i)), counts[i]);
+            }
+        }
+    }
+
+    // Разреженная гистограмма в открытой адресации: ячейка - (значение, счётчик),
+    // счётчик 0 - свободная ячейка. Число ячеек - степень двойки, заполняем
+    // не больше половины. Память - memory_bytes, выделяется сразу
+    class SparseHistogram {
+    public:
+        using Entry = std::pair<int32_t, std::size_t>;
+
+        explicit SparseHistogram(std::size_t memory_bytes) {
+            std::size_t slots = slotsFor(memory_bytes);
+            if (slots > 0) {
+                slots_.assign(slots, Entry{0, 0});
+                unsigned bits = 0;
+                while ((std::size_t{1} << bits) < slots) {
+                    ++bits;
+                }
+                shift_ = 64 - bits;
+            }
+        }
+
+        // Сколько различных значений поместится в memory_bytes
+        static std::size_t CapacityFor(std::size_t memory_bytes) {
+            return slotsFor(memory_bytes) / 2;
+        }
+
+        // false => значения ещё нет, а места под него уже нет
+        bool Add(int32_t value, std::size_t count) {
+            if (slots_.empty()) {
+                return false;
+            }
+
+            std::size_t mask = slots_.size() - 1;
+            std::size_t i = index(value);
+            while (slots_[i].second != 0 && slots_[i].first != value) {
+                i = (i + 1) & mask;
+            }
+            if (slots_[i].second == 0) {
+                if (size_ == slots_.size() / 2) {
+                    return false;
+                }
+                slots_[i].first = value;
+                ++size_;
+            }
+            slots_[i].second += count;
+            return true;
+        }
+
+        // Значения со счётчиками по возрастанию. Add после этого недопустим
+        const std::vector<Entry>& Sorted() {
+            slots_.erase(std::remove_if(slots_.begin(), slots_.end(),
+                                        [](const Entry& e) { return e.second == 0; }),
+                         slots_.end());
+            std::sort(slots_.begin(), slots_.end());
+            return slots_;
+        }
+
+        // Сколько различных значений помещается
+        std::size_t Capacity() const {
+            return slots_.size() / 2;
+        }
+
+        void Release() {
+            std::vector<Entry>().swap(slots_);
+            size_ = 0;
+        }
+
+    private:
+        // Наибольшая степень двойки (не меньше 2), помещающаяся в memory_bytes; 0 - если никакая
+        static std::size_t slotsFor(std::size_t memory_bytes) {
+            std::size_t slots = 2;
+            while (slots * 2 * sizeof(Entry) <= memory_bytes) {
+                slots *= 2;
+            }
+            return slots * sizeof(Entry) <= memory_bytes ? slots : 0;
+        }
+
+        // Фибоначчиево хеширование: старшие биты произведения
+        std::size_t index(int32_t value) const {
+            uint64_t key = static_cast<uint32_t>(value);
+            return static_cast<std::size_t>((key * 0x9E3779B97F4A7C15ull) >> shift_);
+        }
+
+        std::vector<Entry> slots_;
+        std::size_t size_ = 0;
+        unsigned shift_ = 63;
+    };
+
+    void writeHistogram(CountSink& sink, SparseHistogram& histogram) {
+        for (const SparseHistogram::Entry& e : histogram.Sorted()) {
+            sink.Put(e.first, e.second);
+        }
+    }
+
+    // Как делится память на подсчёт (кроме буферов входной и выходной лент)
+    struct CountBudget {
+        std::size_t max_counts;      // плотных счётчиков
+        std::size_t histogram_bytes; // разреженная гистограмма
+        std::size_t partition_bytes; // буферы всех лент-разделов
+        std::size_t tape_bytes;      // буфер читаемой ленты-раздела
+    };
+
+    // Из доли каждой ленты (buf) берём блок: читаем вход и пишем выход по очереди,
+    // поэтому блок общий. Остальное - на счётчики; если понадобятся разделы,
+    // гистограмма делит память с их буферами пополам
+    CountBudget makeBudget(std::size_t memory_limit_bytes) {
+        std::size_t buf = chooseTapeBufferSize(memory_limit_bytes);
+        std::size_t count_buf = memory_limit_bytes - 2 * buf;
+        return CountBudget{
+            count_buf / sizeof(std::size_t),
+            count_buf / 2,
+            count_buf - count_buf / 2,
+            ext_sort::TapeBytesAfterBlock(buf)
+        };
+    }
+
+    void sortByHistogram(Tape& tape, std::size_t elems, bool known_range, int32_t lo, int32_t hi,
+                         const CountBudget& budget, CountSink& sink, std::vector<int32_t>& block,
+                         ext_sort::SortProfile* profile);
+
+    // Разделы значений на временных лентах: [lo, hi] делится на равные диапазоны,
+    // крайние разделы принимают и значения за его пределами.
+    // Лента раздела создаётся по первому значению и растёт по мере записи (GrowingTape):
+    // в раздел может попасть весь вход, но место занимают только записанные значения.
+    // buffer_bytes раздела делятся между блоком записи и буфером ленты.
+    // drop_repeats => посчитанное значение пишется один раз, а не count
+    class Partitions {
+    public:
+        Partitions(Tape& origin, std::size_t total, int32_t lo, int32_t hi,
+                   std::size_t count, std::size_t buffer_bytes, bool drop_repeats)
+            : origin_(origin)
+            , total_(total)
+            , lo_(lo)
+            , hi_(hi)
+            , width_((rangeWidth(lo, hi) + count - 1) / count)
+            , buffer_bytes_(buffer_bytes)
+            , drop_repeats_(drop_repeats)
+            , parts_(count) {}
+
+        void Add(int32_t value, std::size_t count) {
+            if (drop_repeats_) {
+                count = 1;
+            }
+            Part& part = parts_[index(value)];
+            if (!part.tape) {
+                part.tape = std::make_unique<GrowingTape>(origin_, total_,
+                                                          ext_sort::TapeBytesAfterBlock(buffer_bytes_));
+                part.writer.emplace(*part.tape, ext_sort::StreamBlockElements(buffer_bytes_));
+                part.min = value;
+                part.max = value;
+            }
+            part.min = std::min(part.min, value);
+            part.max = std::max(part.max, value);
+            part.size += count;
+            for (std::size_t i = 0; i < count; ++i) {
+                part.writer->Push(value);
+            }
+        }
+
+        // Разделы по возрастанию, каждый - тем же способом, что и вход
+        void CountInto(CountSink& sink, const CountBudget& budget, std::vector<int32_t>& block,
+                       ext_sort::SortProfile* profile) {
+            // Буферы записи сбрасываем сразу: при подсчёте раздела память нужна ему
+            for (Part& part : parts_) {
+                if (part.tape) {
+                    part.writer.reset();
+                    part.tape->SetMemoryLimit(0);
+                }
+            }
+
+            for (Part& part : parts_) {
+                if (!part.tape) {
+                    continue;
+                }
+                part.tape->SetMemoryLimit(budget.tape_bytes);
+                sortByHistogram(*part.tape, part.size, true, part.min, part.max, budget, sink, block, profile);
+                part.tape.reset();
+            }
+        }
+
+    private:
+        struct Part {
+            std::unique_ptr<Tape> tape;
+            std::optional<ext_sort::TapeWriter> writer; // пишет на tape
+            std::size_t size = 0;
+            int32_t min = 0;
+            int32_t max = 0;
+        };
+
+        std::size_t index(int32_t value) const {
+            if (value <= lo_) {
+                return 0;
+            }
+            if (value >= hi_) {
+                return parts_.size() - 1;
+            }
+            return static_cast<std::size_t>((rangeWidth(lo_, value) - 1) / width_);
+        }
+
+        Tape& origin_;
+        std::size_t total_;
+        int32_t lo_;
+        int32_t hi_;
+        uint64_t width_;
+        std::size_t buffer_bytes_;
+        bool drop_repeats_;
+        std::vector<Part> parts_;
+    };
+
+    // Подсчёт elems элементов с ленты tape с записью результата в output.
+    // Диапазон известен и помещается в плотные счётчики - один проход.
+    // Иначе проход в разреженную гистограмму; если различных значений слишком
+    // много, остаток ленты (и уже посчитанное) раскладывается по разделам
+    // значений, и каждый раздел обрабатывается так же. Разделов берём столько,
+    // чтобы каждый уложился в один проход, поэтому обычно проходов два.
+    // known_range => значения вне [lo, hi] отбрасываются
+    void sortByHistogram(Tape& tape, std::size_t elems, bool known_range, int32_t lo, int32_t hi,
+                         const CountBudget& budget, CountSink& sink, std::vector<int32_t>& block,
+                         ext_sort::SortProfile* profile) {
+        if (known_range && rangeWidth(lo, hi) <= budget.max_counts) {
+            countRange(tape, elems, lo, hi, budget.max_counts, sink, block, profile);
+            return;
+        }
+
+        // Проход в гистограмму (или по разделам) и запись гистограммы;
+        // разделы потом считаются своими проходами
+        auto phase = std::make_unique<ext_sort::ScopedPhase>(profile, "histogram_pass");
+        SparseHistogram histogram(budget.histogram_bytes);
+        std::unique_ptr<Partitions> partitions;
+        int32_t seen_min = std::numeric_limits<int32_t>::max();
+        int32_t seen_max = std::numeric_limits<int32_t>::min();
+
+        tape.Reset();
+        for (std::size_t i = 0; i < elems;) {
+            std::size_t got = tape.ReadBlock(block.data(), std::min(block.size(), elems - i));
+            for (std::size_t j = 0; j < got; ++j) {
+                int32_t v = block[j];
+                if (known_range && (v < lo || v > hi)) {
+                    continue;
+                }
+                if (partitions) {
+                    partitions->Add(v, 1);
+                    continue;
+                }
+
+                seen_min = std::min(seen_min, v);
+                seen_max = std::max(seen_max, v);
+                if (histogram.Add(v, 1)) {
+                    continue;
+                }
+
+                // Без известного диапазона делим тот, что видели до сих пор.
+                // Раздел укладывается в один проход, если его диапазон помещается
+                // в плотные счётчики или элементы - в гистограмму
+                int32_t part_lo = known_range ? lo : seen_min;
+                int32_t part_hi = known_range ? hi : seen_max;
+                uint64_t by_range = (rangeWidth(part_lo, part_hi) + budget.max_counts - 1) / budget.max_counts;
+                uint64_t by_size = histogram.Capacity() > 0
+                    ? (elems + histogram.Capacity() - 1) / histogram.Capacity()
+                    : elems;
+                std::size_t affordable = budget.partition_bytes / MIN_PARTITION_BUFFER_BYTES;
+                std::size_t count = static_cast<std::size_t>(std::min<uint64_t>(std::min(by_range, by_size), affordable));
+                count = std::max<std::size_t>(count, 2);
+
+                partitions = std::make_unique<Partitions>(tape, elems, part_lo, part_hi, count,
+                                                          budget.partition_bytes / count,
+                                                          sink.DropsRepeats());
+                for (const SparseHistogram::Entry& e : histogram.Sorted()) {
+                    partitions->Add(e.first, e.second);
+                }
+                histogram.Release();
+                partitions->Add(v, 1);
+            }
+            i += got;
+        }
+
+        if (!partitions) {
+            writeHistogram(sink, histogram);
+            return;
+        }
+
+        phase.reset();
+        tape.SetMemoryLimit(0);
+        partitions->CountInto(sink, budget, block, profile);
+    }
+
+    // grouped => каждое значение пишется один раз, а счётчики - на counts (если задана).
+    // Доля выходной ленты тогда делится: треть - значениям, остальное - счётчикам.
+    // Возвращает число различных значений
+    std::size_t countingSort(Tape& input,
+                             Tape& output,
+                             bool grouped,
+                             BasicTape<uint64_t>* counts,
+                             std::size_t memory_limit_bytes,
+                             bool known_range,
+                             int32_t range_min,
+                             int32_t range_max,
+                             ext_sort::SortProfile* profile) {
+        std::size_t n = input.Size();
+        if (n == 0) {
+            return 0;
         }
+
+        std::size_t buf = chooseTapeBufferSize(memory_limit_bytes);
+        std::vector<int32_t> block(ext_sort::StreamBlockElements(buf));
+        input.SetMemoryLimit(ext_sort::TapeBytesAfterBlock(buf));
+
+        CountBudget budget = makeBudget(memory_limit_bytes);
+        if (budget.max_counts == 0) {
+            throw std::runtime_error("Memory limit too small for counting sort buffer");
+        }
+
+        std::optional<CountSink> sink;
+        if (!grouped) {
+            output.SetMemoryLimit(buf);
+            sink.emplace(output, block);
+        } else {
+            std::size_t values_bytes = counts ? buf / 3 : buf;
+            std::size_t counts_bytes = buf - values_bytes;
+            output.SetMemoryLimit(ext_sort::TapeBytesAfterBlock(values_bytes));
+            if (counts) {
+                counts->SetMemoryLimit(ext_sort::TapeBytesAfterBlock(counts_bytes, sizeof(uint64_t)));
+                counts->Reset();
+            }
+            // Блоки значений и счётчиков - одной длины, каждый в пределах своей доли
+            std::size_t block_elements = ext_sort::StreamBlockElements(values_bytes);
+            if (counts) {
+                block_elements = std::min(block_elements,
+                                          ext_sort::StreamBlockElements(counts_bytes, sizeof(uint64_t)));
+            }
+            sink.emplace(output, counts, block, block_elements);
+        }
+
+        output.Reset();
+        sortByHistogram(input, n, known_range, range_min, range_max, budget, *sink, block, profile);
+        sink->Flush();
+        output.Reset();
+        if (counts) {
+            counts->Reset();
+        }
+        return sink->Groups();
+    }
+
+    // Искомый ранг: значение лежит в [lo, hi], перед ним rank элементов отрезка,
+    // всего в отрезке count элементов. lo == hi => значение найдено
+    struct SelectTarget {
+        int64_t lo;
+        int64_t hi;
+        std::size_t rank;
+        std::size_t count;
+    };
+
+    // Отрезок значений, общий для целей с одинаковыми [lo, hi], и что о нём
+    // собрано за проход: счётчики корзин по bucket_width значений или,
+    // если элементы помещаются в память, сами элементы (bucket_width == 0)
+    struct SelectInterval {
+        int64_t lo;
+        int64_t hi;
+        uint64_t bucket_width = 0;
+        std::vector<std::size_t> buckets;
+        std::vector<int32_t> values;
+    };
+
+    // Один проход по ленте: для каждого отрезка из intervals (не пересекаются,
+    // по возрастанию lo) - гистограмма или элементы
+    void selectPass(Tape& tape, std::size_t total_elems, std::vector<SelectInterval>& intervals,
+                    std::vector<int32_t>& block) {
+        int64_t lowest = intervals.front().lo;
+        int64_t highest = intervals.back().hi;
+
+        tape.Reset();
+        for (std::size_t i = 0; i < total_elems;) {
+            std::size_t n = tape.ReadBlock(block.data(), std::min(block.size(), total_elems - i));
+            for (std::size_t j = 0; j < n; ++j) {
+                int64_t v = block[j];
+                if (v < lowest || v > highest) {
+                    continue;
+                }
+                auto it = std::upper_bound(intervals.begin(), intervals.end(), v,
+                                           [](int64_t value, const SelectInterval& interval) {
+                                               return value < interval.lo;
+                                           });
+                SelectInterval& interval = *(it - 1);
+                if (v > interval.hi) {
+                    continue;
+                }
+                if (interval.bucket_width == 0) {
+                    interval.values.push_back(block[j]);
+                } else {
+                    ++interval.buckets[static_cast<std::size_t>(rangeWidth(interval.lo, v) - 1) / interval.bucket_width];
+                }
+            }
+            i += n;
+        }
+    }
+
+    // Сужает [lo, hi] цели до корзины, в которую попал её ранг
+    void narrowTarget(SelectTarget& target, const SelectInterval& interval) {
+        if (interval.bucket_width == 0) {
+            int32_t value = interval.values[target.rank];
+            target.lo = value;
+            target.hi = value;
+            return;
+        }
+        std::size_t before = 0;
+        for (std::size_t b = 0; b < interval.buckets.size(); ++b) {
+            if (target.rank < before + interval.buckets[b]) {
+                target.lo = interval.lo + static_cast<int64_t>(b * interval.bucket_width);
+                target.hi = std::min<int64_t>(interval.hi, target.lo + static_cast<int64_t>(interval.bucket_width) - 1);
+                target.rank -= before;
+                target.count = interval.buckets[b];
+                return;
+            }
+            before += interval.buckets[b];
+        }
+        throw std::runtime_error("Tape changed during selection");
     }
 } // namespace
 
 namespace ext_sort {
 
+CountingLimits CountingSortLimits(std::size_t memory_limit_bytes) {
+    CountBudget budget = makeBudget(memory_limit_bytes);
+    return CountingLimits{
+        budget.max_counts,
+        SparseHistogram::CapacityFor(budget.histogram_bytes),
+        std::max<std::size_t>(budget.partition_bytes / MIN_PARTITION_BUFFER_BYTES, 2)
+    };
+}
+
 // Сортировка подсчётом с известным диапазоном
 void CountingSort(
     Tape& input,
     Tape& output,
     std::size_t memory_limit_bytes,
     int32_t global_min,
-    int32_t global_max
+    int32_t global_max,
+    SortProfile* profile
+) {
+    countingSort(input, output, false, nullptr, memory_limit_bytes, true, global_min, global_max, profile);
+}
+
+// Сортировка подсчётом с неизвестным диапазоном
+void CountingSort(
+    Tape& input,
+    Tape& output,
+    std::size_t memory_limit_bytes,
+    SortProfile* profile
+) {
+    countingSort(input, output, false, nullptr, memory_limit_bytes, false, 0, 0, profile);
+}
+
+std::size_t CountingGroup(
+    Tape& input,
+    Tape& output,
+    BasicTape<uint64_t>* counts,
+    std::size_t memory_limit_bytes,
+    int32_t value_min,
+    int32_t value_max,
+    SortProfile* profile
+) {
+    return countingSort(input, output, true, counts, memory_limit_bytes, true, value_min, value_max, profile);
+}
+
+std::size_t CountingGroup(
+    Tape& input,
+    Tape& output,
+    BasicTape<uint64_t>* counts,
+    std::size_t memory_limit_bytes,
+    SortProfile* profile
+) {
+    return countingSort(input, output, true, counts, memory_limit_bytes, false, 0, 0, profile);
+}
+
+std::vector<int32_t> Select(
+    Tape& input,
+    const std::vector<std::size_t>& ranks,
+    std::size_t memory_limit_bytes,
+    SortProfile* profile
 ) {
     std::size_t n = input.Size();
-    if (n == 0) {
-        return;
+    for (std::size_t rank : ranks) {
+        if (rank >= n) {
+            throw std::runtime_error("Selection rank is out of the tape");
+        }
     }
 
+    // Вся память, кроме буфера входной ленты, - на счётчики или элементы отрезков
     std::size_t buf = chooseTapeBufferSize(memory_limit_bytes);
-    input.SetMemoryLimit(buf);
-    output.SetMemoryLimit(buf);
-
-    std::size_t count_buf = memory_limit_bytes - 2 * buf;
-    if (count_buf < sizeof(std::size_t)) {
-        throw std::runtime_error("Memory limit too small for counting sort buffer");
+    std::size_t select_bytes = memory_limit_bytes - buf;
+    if (select_bytes < 2 * sizeof(std::size_t)) {
+        throw std::runtime_error("Memory limit too small for selection");
     }
+    std::vector<int32_t> block(StreamBlockElements(buf));
+    input.SetMemoryLimit(TapeBytesAfterBlock(buf));
 
-    uint64_t total_range = static_cast<uint64_t>(global_max) - static_cast<uint64_t>(global_min) + 1;
-    std::size_t max_counts = count_buf / sizeof(std::size_t);
-    if (max_counts == 0) {
-        throw std::runtime_error("Memory limit too small for counting sort buffer");
+    std::vector<SelectTarget> targets;
+    for (std::size_t rank : ranks) {
+        targets.push_back({std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::max(), rank, n});
     }
-    std::size_t window_size = static_cast<std::size_t>(std::min(total_range, static_cast<uint64_t>(max_counts)));
 
-    std::size_t tmp = output.Size();
+    for (;;) {
+        // Нерешённые цели с одинаковым отрезком делят один отрезок прохода
+        std::vector<SelectInterval> intervals;
+        std::vector<std::size_t> counts;
+        for (const SelectTarget& t : targets) {
+            if (t.lo == t.hi) {
+                continue;
+            }
+            auto it = std::lower_bound(intervals.begin(), intervals.end(), t.lo,
+                                       [](const SelectInterval& interval, int64_t lo) {
+                                           return interval.lo < lo;
+                                       });
+            if (it == intervals.end() || it->lo != t.lo) {
+                counts.insert(counts.begin() + (it - intervals.begin()), t.count);
+                intervals.insert(it, SelectInterval{t.lo, t.hi, 0, {}, {}});
+            }
+        }
+        if (intervals.empty()) {
+            break;
+        }
 
-    output.Reset();
-    for (int32_t start = global_min; start <= global_max; start += static_cast<int32_t>(window_size)) {
-        int32_t end = std::min(global_max, start + static_cast<int32_t>(window_size) - 1);
+        // Память делится между отрезками поровну. Если элементы отрезка помещаются
+        // в свою долю - собираем их, иначе считаем корзины
+        ScopedPhase phase(profile, "select_pass");
+        std::size_t share = select_bytes / intervals.size();
+        for (std::size_t i = 0; i < intervals.size(); ++i) {
+            SelectInterval& interval = intervals[i];
+            if (counts[i] * sizeof(int32_t) <= share) {
+                interval.values.reserve(counts[i]);
+                continue;
+            }
+            uint64_t width = rangeWidth(interval.lo, interval.hi);
+            uint64_t buckets = std::max<uint64_t>(share / sizeof(std::size_t), 2);
+            interval.bucket_width = (width + buckets - 1) / buckets;
+            interval.buckets.assign(static_cast<std::size_t>((width + interval.bucket_width - 1) / interval.bucket_width), 0);
+        }
 
-        std::vector<std::size_t> counts = countWindow(input, n, start, end);
+        selectPass(input, n, intervals, block);
 
-        for (std::size_t i = 0; i < counts.size(); ++i) {
-            writeCount(output, start + static_cast<int32_t>(i), counts[i]);
+        for (SelectInterval& interval : intervals) {
+            std::sort(interval.values.begin(), interval.values.end());
+        }
+        for (SelectTarget& t : targets) {
+            if (t.lo == t.hi) {
+                continue;
+            }
+            auto it = std::lower_bound(intervals.begin(), intervals.end(), t.lo,
+                                       [](const SelectInterval& interval, int64_t lo) {
+                                           return interval.lo < lo;
+                                       });
+            narrowTarget(t, *it);
         }
     }
 
-    output.Reset();
+    std::vector<int32_t> result;
+    result.reserve(targets.size());
+    for (const SelectTarget& t : targets) {
+        result.push_back(static_cast<int32_t>(t.lo));
+    }
+    return result;
 }
 
-// Сортировка подсчётом с неизвестным диапазоном
-void CountingSort(
+std::vector<int32_t> Quantiles(
     Tape& input,
-    Tape& output,
-    std::size_t memory_limit_bytes
+    const std::vector<double>& quantiles,
+    std::size_t memory_limit_bytes,
+    SortProfile* profile
 ) {
-    if (input.Size() == 0) {
-        return;
-    }
-
-    input.Reset();
-    int32_t global_min = input.Read();
-    int32_t global_max = global_min;
-    std::size_t total = input.Size();
-    for (std::size_t i = 1; i < total; ++i) {
-        input.Next();
-        int32_t v = input.Read();
-        global_min = std::min(global_min, v);
-        global_max = std::max(global_max, v);
+    std::size_t n = input.Size();
+    std::vector<std::size_t> ranks;
+    for (double q : quantiles) {
+        if (!(q >= 0.0 && q <= 1.0)) {
+            throw std::runtime_error("Quantile must be in [0, 1]");
+        }
+        if (n == 0) {
+            throw std::runtime_error("Quantile of an empty tape");
+        }
+        ranks.push_back(static_cast<std::size_t>(q * static_cast<double>(n - 1)));
     }
-
-    CountingSort(input, output, memory_limit_bytes, global_min, global_max);
+    return Select(input, ranks, memory_limit_bytes, profile);
 }
 
-} // namespace ext_sort
\ No newline at end of file
+} // namespace ext_sort
@@ -0,0 +1,303 @@
+#include "external_sort.hpp"
+
+#include "growing_tape.hpp"
+#include "run_generator.hpp"
+#include "tape.hpp"
+#include "tape_stream.hpp"
+
+#include <cstdint>
+
+#include <algorithm>
+#include <deque>
+#include <future>
+#include <memory>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace {
+    // Меньше этого буфер ленты-корзины не делаем: число корзин ограничено памятью
+    constexpr std::size_t MIN_BUCKET_BUFFER_BYTES = 4 * 1024;
+
+    // Сколько элементов выборки приходится на один разделитель
+    constexpr std::size_t OVERSAMPLING = 32;
+
+    // Корзина между соседними разделителями. Лента создаётся по первому значению
+    // и растёт по мере записи (GrowingTape): в корзину может попасть вся раскладываемая
+    // лента, но место занимают только записанные значения. Буфер корзины делится
+    // между блоком записи и буфером ленты
+    struct Bucket {
+        std::unique_ptr<Tape> tape;
+        std::optional<ext_sort::TapeWriter> writer; // пишет на tape
+        std::size_t size = 0;
+        int32_t min = 0;
+        int32_t max = 0;
+    };
+
+    // Различные разделители (не больше splitters) по выборке из count элементов
+    // ленты: элементы берутся через равные промежутки со случайным сдвигом внутри
+    // промежутка, головка идёт только вперёд
+    std::vector<int32_t> chooseSplitters(Tape& tape, std::size_t count, std::size_t splitters,
+                                         std::mt19937_64& random) {
+        std::size_t sample_size = std::min(count, splitters * OVERSAMPLING);
+        std::vector<int32_t> sample;
+        sample.reserve(sample_size);
+
+        tape.Reset();
+        std::size_t position = 0;
+        for (std::size_t i = 0; i < sample_size; ++i) {
+            std::size_t first = i * count / sample_size;
+            std::size_t width = (i + 1) * count / sample_size - first;
+            std::size_t target = first + static_cast<std::size_t>(random() % width);
+            if (target != position) {
+                tape.Rewind(static_cast<std::ptrdiff_t>(target - position));
+                position = target;
+            }
+            sample.push_back(tape.Read());
+        }
+        std::sort(sample.begin(), sample.end());
+
+        std::vector<int32_t> result;
+        for (std::size_t j = 1; j <= splitters; ++j) {
+            int32_t splitter = sample[j * sample_size / (splitters + 1)];
+            if (result.empty() || result.back() != splitter) {
+                result.push_back(splitter);
+            }
+        }
+        return result;
+    }
+
+    // Сортировка с раскладкой по корзинам. Память: четверть - выходной ленте,
+    // четверть - ленте, которую раскладываем или читаем, половина - корзинам
+    // в памяти (threads штук сортируются, ещё одна читается) или, при раскладке,
+    // буферам лент-корзин
+    class DistributionSorter {
+    public:
+        DistributionSorter(Tape& input, Tape& output, std::size_t memory_limit_bytes,
+                           ext_sort::RunFormation formation, std::size_t threads,
+                           ext_sort::DistributionStats& stats, ext_sort::SortProfile* profile)
+            : input_(input)
+            , output_bytes_(memory_limit_bytes / 4)
+            , tape_bytes_(memory_limit_bytes / 4)
+            , work_bytes_(memory_limit_bytes - output_bytes_ - tape_bytes_)
+            , formation_(formation)
+            , threads_(std::max<std::size_t>(threads, 1))
+            , leaf_elements_(ext_sort::RunChunkElements(work_bytes_ / sizeof(int32_t), formation, threads_))
+            , writer_(output, ext_sort::StreamBlockElements(output_bytes_))
+            , stats_(stats)
+            , profile_(profile) {
+            output.SetMemoryLimit(ext_sort::TapeBytesAfterBlock(output_bytes_));
+        }
+
+        // Сколько элементов корзины сортируются в памяти
+        std::size_t LeafElements() const { return leaf_elements_; }
+
+        // count элементов ленты tape, начиная с её начала, - в выход по возрастанию
+        void Sort(Tape& tape, std::size_t count, std::size_t depth) {
+            std::vector<Bucket> buckets;
+            std::vector<int32_t> splitters;
+            std::vector<std::size_t> equal;
+            {
+                ext_sort::ScopedPhase phase(profile_, "distribute_pass");
+                tape.SetMemoryLimit(ext_sort::TapeBytesAfterBlock(tape_bytes_));
+
+                // Корзин - вдвое больше, чем нужно, чтобы каждая поместилась в память:
+                // с запасом на неточность выборки
+                std::size_t wanted = 2 * ((count + leaf_elements_ - 1) / leaf_elements_);
+                std::size_t affordable = work_bytes_ / MIN_BUCKET_BUFFER_BYTES;
+                std::size_t bucket_count = std::max<std::size_t>(std::min(wanted, affordable), 2);
+
+                splitters = chooseSplitters(tape, count, bucket_count - 1, random_);
+                buckets.resize(splitters.size() + 1);
+                equal.assign(splitters.size(), 0);
+                distribute(tape, count, splitters, buckets, equal, work_bytes_ / buckets.size());
+                tape.SetMemoryLimit(0);
+            }
+            stats_.passes = std::max(stats_.passes, depth + 1);
+            stats_.distributed_elements += count;
+
+            // Буферы корзин сбрасываем сразу: при чтении корзины память нужна ей
+            for (Bucket& bucket : buckets) {
+                if (bucket.tape) {
+                    bucket.writer.reset();
+                    bucket.tape->SetMemoryLimit(0);
+                }
+            }
+
+            auto phase = std::make_unique<ext_sort::ScopedPhase>(profile_, "sort_buckets");
+            for (std::size_t i = 0; i < buckets.size(); ++i) {
+                Bucket& bucket = buckets[i];
+                if (bucket.size > 0 && (bucket.min == bucket.max || bucket.size <= leaf_elements_)) {
+                    if (bucket.min == bucket.max) {
+                        writeEqual(bucket.min, bucket.size);
+                    } else {
+                        sortLeaf(*bucket.tape, bucket.size);
+                    }
+                } else if (bucket.size > 0) {
+                    // Корзина не помещается в память: раскладываем её так же
+                    flushPending();
+                    phase.reset();
+                    Sort(*bucket.tape, bucket.size, depth + 1);
+                    phase = std::make_unique<ext_sort::ScopedPhase>(profile_, "sort_buckets");
+                }
+                bucket.tape.reset();
+
+                if (i < equal.size() && equal[i] > 0) {
+                    writeEqual(splitters[i], equal[i]);
+                }
+            }
+            flushPending();
+        }
+
+        // Вход целиком в памяти: сортируем его сразу в выход
+        void SortInMemory(Tape& tape, std::size_t count) {
+            tape.SetMemoryLimit(ext_sort::TapeBytesAfterBlock(tape_bytes_));
+            tape.Reset();
+            sortLeaf(tape, count);
+            flushPending();
+        }
+
+        void Finish() {
+            flushPending();
+            writer_.Flush();
+        }
+
+    private:
+        // Один проход по ленте: значения, равные разделителю, только считаются,
+        // остальные пишутся на ленту своей корзины
+        void distribute(Tape& tape, std::size_t count, const std::vector<int32_t>& splitters,
+                        std::vector<Bucket>& buckets, std::vector<std::size_t>& equal,
+                        std::size_t bucket_bytes) {
+            tape.Reset();
+            ext_sort::TapeReader reader(tape, ext_sort::StreamBlockElements(tape_bytes_));
+            for (reader.Start(count); !reader.Empty(); reader.Pop()) {
+                int32_t value = reader.Peek();
+                std::size_t index = static_cast<std::size_t>(
+                    std::lower_bound(splitters.begin(), splitters.end(), value) - splitters.begin());
+                if (index < splitters.size() && splitters[index] == value) {
+                    ++equal[index];
+                    continue;
+                }
+
+                Bucket& bucket = buckets[index];
+                if (!bucket.tape) {
+                    bucket.tape = std::make_unique<GrowingTape>(input_, count,
+                                                                ext_sort::TapeBytesAfterBlock(bucket_bytes));
+                    bucket.writer.emplace(*bucket.tape, ext_sort::StreamBlockElements(bucket_bytes));
+                    bucket.min = value;
+                    bucket.max = value;
+                }
+                bucket.min = std::min(bucket.min, value);
+                bucket.max = std::max(bucket.max, value);
+                ++bucket.size;
+                bucket.writer->Push(value);
+            }
+        }
+
+        // Корзина читается целиком и сортируется; при threads > 1 - в фоне,
+        // пока читаются следующие, а в выход пишется строго по порядку
+        void sortLeaf(Tape& tape, std::size_t count) {
+            tape.SetMemoryLimit(ext_sort::TapeBytesAfterBlock(tape_bytes_));
+            tape.Reset();
+            std::vector<int32_t> chunk(count);
+            if (tape.ReadBlock(chunk.data(), count) != count) {
+                throw std::runtime_error("Bucket tape is shorter than expected");
+            }
+            tape.SetMemoryLimit(0);
+            ++stats_.buckets;
+
+            if (threads_ == 1) {
+                ext_sort::SortChunk(chunk, formation_);
+                writeChunk(chunk);
+                return;
+            }
+            if (pending_.size() == threads_) {
+                writeChunk(pending_.front().get());
+                pending_.pop_front();
+            }
+            ext_sort::RunFormation formation = formation_;
+            pending_.push_back(std::async(std::launch::async, [formation, chunk = std::move(chunk)]() mutable {
+                ext_sort::SortChunk(chunk, formation);
+                return std::move(chunk);
+            }));
+        }
+
+        void writeEqual(int32_t value, std::size_t count) {
+            flushPending();
+            ++stats_.buckets;
+            for (std::size_t i = 0; i < count; ++i) {
+                writer_.Push(value);
+            }
+        }
+
+        void writeChunk(const std::vector<int32_t>& chunk) {
+            for (int32_t value : chunk) {
+                writer_.Push(value);
+            }
+        }
+
+        void flushPending() {
+            while (!pending_.empty()) {
+                writeChunk(pending_.front().get());
+                pending_.pop_front();
+            }
+        }
+
+        Tape& input_;
+        std::size_t output_bytes_;
+        std::size_t tape_bytes_;
+        std::size_t work_bytes_;
+        ext_sort::RunFormation formation_;
+        std::size_t threads_;
+        std::size_t leaf_elements_;
+        ext_sort::TapeWriter writer_;
+        std::deque<std::future<std::vector<int32_t>>> pending_;
+        std::mt19937_64 random_{0x5EED};
+        ext_sort::DistributionStats& stats_;
+        ext_sort::SortProfile* profile_;
+    };
+} // namespace
+
+namespace ext_sort {
+
+DistributionStats DistributionSort(
+    Tape& input,
+    Tape& output,
+    std::size_t memory_limit_bytes,
+    RunFormation formation,
+    std::size_t threads,
+    SortProfile* profile
+) {
+    if (memory_limit_bytes < 4 * sizeof(int32_t)) {
+        throw std::runtime_error("Memory limit too small for distribution sort");
+    }
+    // Корзина сортируется целиком: выбор с замещением и естественные серии ни к чему
+    if (formation == RunFormation::ReplacementSelection || formation == RunFormation::NaturalRuns) {
+        formation = RunFormation::Sort;
+    }
+
+    DistributionStats stats;
+    std::size_t total = input.Size();
+    if (total == 0) {
+        return stats;
+    }
+
+    output.Reset();
+    {
+        DistributionSorter sorter(input, output, memory_limit_bytes, formation, threads, stats, profile);
+        if (total <= sorter.LeafElements()) {
+            ScopedPhase phase(profile, "sort_in_memory");
+            sorter.SortInMemory(input, total);
+        } else {
+            sorter.Sort(input, total, 0);
+        }
+        sorter.Finish();
+    }
+    input.SetMemoryLimit(0);
+    output.Reset();
+    return stats;
+}
+
+} // namespace ext_sort
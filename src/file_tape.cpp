@@ -1,19 +1,26 @@
 #include "file_tape.hpp"
 
+#include "compressed_tape.hpp"
+#include "virtual_clock.hpp"
+
 #include <algorithm>
 #include <sstream>
 #include <stdexcept>
 #include <thread>
 
 const std::size_t FileTape::CELL_SIZE = sizeof(int32_t);
-std::size_t FileTape::tmp_counter_ = 0;
+std::atomic<std::size_t> FileTape::tmp_counter_{0};
 
 FileTape::FileTape(const std::string& filename,
                    const Delays& delays,
-                   std::size_t memory_limit_bytes)
+                   std::size_t memory_limit_bytes,
+                   bool async_io,
+                   bool compress_temporaries)
     : filename_(filename)
     , delays_(delays)
     , memory_limit_bytes_(memory_limit_bytes)
+    , async_io_(async_io)
+    , compress_temporaries_(compress_temporaries)
     {
     file_ = std::fopen(filename_.c_str(), "rb+");
     if (!file_) {
@@ -37,16 +44,25 @@ FileTape::FileTape(const std::string& filename,
 
 FileTape::~FileTape() {
     flushAndClearBuffer();
+    stopIo();
     if (file_) {
         std::fclose(file_);
     }
+    if (report_metrics_) {
+        temporaries_->Add(metrics_);
+    }
 
     if (is_temporary_) {
-        std::remove(filename_.c_str());
+        if (pool_) {
+            pool_->Release(filename_);
+        } else {
+            std::remove(filename_.c_str());
+        }
     }
 }
 
 int32_t FileTape::Read() {
+    ++metrics_.reads;
     applyDelay(delays_.read_ms);
     return getValue(position_);
 }
@@ -54,14 +70,71 @@ int32_t FileTape::Read() {
 void FileTape::Write(int32_t value) {
     getValue(position_) = value;
     buffer_dirty_ = true;
+    ++metrics_.writes;
 
     applyDelay(delays_.write_ms);
 }
 
+std::size_t FileTape::ReadBlock(int32_t* out, std::size_t n) {
+    std::size_t start = position_;
+    n = std::min(n, size_ - start);
+
+    for (std::size_t done = 0; done < n;) {
+        loadBuffer(start + done);
+        std::size_t offset = start + done - buffer_start_;
+        std::size_t chunk = std::min(n - done, buffer_.size() - offset);
+        std::copy_n(buffer_.data() + offset, chunk, out + done);
+        done += chunk;
+    }
+    metrics_.reads += n;
+
+    shiftAfterBlock(n, delays_.read_ms);
+    return n;
+}
+
+std::size_t FileTape::ReadBlockBackward(int32_t* out, std::size_t n) {
+    if (size_ == 0) {
+        return 0;
+    }
+    std::size_t start = position_;
+    n = std::min(n, start + 1);
+
+    for (std::size_t done = 0; done < n;) {
+        loadBuffer(start - done);
+        std::size_t offset = start - done - buffer_start_;
+        std::size_t chunk = std::min(n - done, offset + 1);
+        std::reverse_copy(buffer_.data() + offset + 1 - chunk, buffer_.data() + offset + 1, out + done);
+        done += chunk;
+    }
+    metrics_.reads += n;
+
+    shiftBackAfterBlock(n, delays_.read_ms);
+    return n;
+}
+
+std::size_t FileTape::WriteBlock(const int32_t* in, std::size_t n) {
+    std::size_t start = position_;
+    n = std::min(n, size_ - start);
+
+    for (std::size_t done = 0; done < n;) {
+        loadBuffer(start + done);
+        std::size_t offset = start + done - buffer_start_;
+        std::size_t chunk = std::min(n - done, buffer_.size() - offset);
+        std::copy_n(in + done, chunk, buffer_.data() + offset);
+        buffer_dirty_ = true;
+        done += chunk;
+    }
+    metrics_.writes += n;
+
+    shiftAfterBlock(n, delays_.write_ms);
+    return n;
+}
+
 bool FileTape::Next() {
     if (!shift(1)) {
         return false;
     }
+    ++metrics_.shifts;
 
     applyDelay(delays_.shift_ms);
     return true;
@@ -71,6 +144,7 @@ bool FileTape::Prev() {
     if (!shift(-1)) {
         return false;
     }
+    ++metrics_.shifts;
 
     applyDelay(delays_.shift_ms);
     return true;
@@ -80,6 +154,7 @@ bool FileTape::Rewind(std::ptrdiff_t offset) {
     if (!shift(offset)) {
         return false;
     }
+    ++metrics_.rewinds;
 
     std::size_t delay_if_use_next = delays_.shift_ms * std::abs(offset);
     applyDelay(std::min(delays_.rewind_ms, delay_if_use_next));
@@ -95,7 +170,7 @@ std::size_t FileTape::Position() const {
 }
 
 void FileTape::SetMemoryLimit(std::size_t bytes) {
-    if (bytes < buffer_.size() * CELL_SIZE) {
+    if (bytes < (buffer_.size() + back_buffer_.size()) * CELL_SIZE) {
         flushAndClearBuffer();
 
         buffer_start_ = 0;
@@ -106,6 +181,22 @@ void FileTape::SetMemoryLimit(std::size_t bytes) {
 
 std::unique_ptr<Tape> FileTape::CreateTemporary(std::size_t size,
                                                  std::size_t buffer_bytes) const {
+    if (compress_temporaries_) {
+        std::string tmp_name = pool_ ? pool_->UniqueName("compressed") : "tmp/" + makeTmpFilename();
+        return std::make_unique<CompressedTape>(tmp_name, size, delays_, buffer_bytes, temporaries_, pool_);
+    }
+    if (pool_) {
+        // Файл из пула бывает длиннее ленты: лишние ячейки не видны
+        auto tmp = std::make_unique<FileTape>(pool_->Acquire(size * CELL_SIZE), delays_, buffer_bytes,
+                                              async_io_);
+        tmp->size_ = size;
+        tmp->is_temporary_ = true;
+        tmp->pool_ = pool_;
+        tmp->temporaries_ = temporaries_;
+        tmp->report_metrics_ = true;
+        return tmp;
+    }
+
     std::string tmp_name = "tmp/" + makeTmpFilename();
     std::FILE* f = std::fopen(tmp_name.c_str(), "wb");
     if (!f) {
@@ -116,12 +207,53 @@ std::unique_ptr<Tape> FileTape::CreateTemporary(std::size_t size,
         std::fputc(0, f);
     }
     std::fclose(f);
-    auto tmp = std::make_unique<FileTape>(tmp_name, delays_, buffer_bytes);
+    auto tmp = std::make_unique<FileTape>(tmp_name, delays_, buffer_bytes, async_io_);
     tmp->is_temporary_ = true;
+    tmp->temporaries_ = temporaries_;
+    tmp->report_metrics_ = true;
 
     return tmp;
 }
 
+std::unique_ptr<Tape> FileTape::OpenSection(std::size_t first,
+                                             std::size_t length,
+                                             std::size_t buffer_bytes) {
+    if (first > size_ || length > size_ - first) {
+        throw std::runtime_error("Section out of tape bounds: " + filename_);
+    }
+    flushAndClearBuffer();
+
+    auto section = std::make_unique<FileTape>(filename_, delays_, buffer_bytes, async_io_,
+                                              compress_temporaries_);
+    section->base_ = base_ + first;
+    section->size_ = length;
+    section->pool_ = pool_;
+    // Участки временной ленты считаются с временными, участки исходной - с ней самой
+    section->temporaries_ = report_metrics_ ? temporaries_ : sections_;
+    section->report_metrics_ = true;
+
+    return section;
+}
+
+bool FileTape::SupportsSections() const {
+    return true;
+}
+
+void FileTape::SetTemporaryPool(std::shared_ptr<TempTapePool> pool) {
+    pool_ = std::move(pool);
+}
+
+TapeMetrics FileTape::Metrics() {
+    waitIo();
+    TapeMetrics total = metrics_;
+    total += sections_->Total();
+    return total;
+}
+
+TapeMetrics FileTape::TemporaryMetrics() const {
+    return temporaries_->Total();
+}
+
 std::string FileTape::makeTmpFilename() const {
     std::ostringstream oss;
     oss << std::this_thread::get_id();
@@ -151,22 +283,55 @@ bool FileTape::shift(std::ptrdiff_t offset) {
     return true;
 }
 
-void FileTape::applyDelay(std::size_t ms) const {
-    if (ms > 0) {
+void FileTape::shiftAfterBlock(std::size_t n, std::size_t op_delay_ms) {
+    if (n == 0) {
+        return;
+    }
+
+    std::size_t moved = std::min(n, size_ - 1 - position_);
+    position_ += moved;
+    metrics_.shifts += moved;
+    applyDelay(op_delay_ms * n + delays_.shift_ms * moved);
+}
+
+void FileTape::shiftBackAfterBlock(std::size_t n, std::size_t op_delay_ms) {
+    if (n == 0) {
+        return;
+    }
+
+    std::size_t moved = std::min<std::size_t>(n, position_);
+    position_ -= moved;
+    metrics_.shifts += moved;
+    applyDelay(op_delay_ms * n + delays_.shift_ms * moved);
+}
+
+void FileTape::applyDelay(std::size_t ms) {
+    metrics_.delay_ms += ms;
+    VirtualClock::Occupy(busy_until_, ms);
+    if (ms > 0 && !delays_.virtual_time) {
         std::this_thread::sleep_for(std::chrono::milliseconds(ms));
     }
 }
 
 void FileTape::flushAndClearBuffer() {
+    if (async_io_) {
+        waitIo();
+        if (back_dirty_) {
+            writeCells(back_buffer_, back_start_);
+            back_dirty_ = false;
+        }
+        back_ready_ = false;
+        back_buffer_.clear();
+        back_buffer_.shrink_to_fit();
+    }
+
     if (!buffer_dirty_) {
         buffer_.clear();
         buffer_.shrink_to_fit();
         return;
     }
 
-    std::fseek(file_, buffer_start_ * CELL_SIZE, SEEK_SET);
-    std::fwrite(buffer_.data(), CELL_SIZE, buffer_.size(), file_);
-    std::fflush(file_);
+    writeCells(buffer_, buffer_start_);
 
     buffer_dirty_ = false;
 
@@ -179,7 +344,14 @@ void FileTape::loadBuffer(std::size_t target_cell) {
         target_cell < buffer_start_ + buffer_.size()) {
         return;
     }
+    ++metrics_.buffer_misses;
+
+    if (async_io_ && windowCells() > 1) {
+        loadBufferAsync(target_cell);
+        return;
+    }
 
+    bool forward = target_cell >= buffer_start_;
     flushAndClearBuffer();
 
     std::size_t max_cells = memory_limit_bytes_ / CELL_SIZE;
@@ -187,13 +359,154 @@ void FileTape::loadBuffer(std::size_t target_cell) {
         max_cells = 1;
     }
 
-    buffer_start_ = target_cell;
+    // Окно ставим так, чтобы головка дальше двигалась внутри него
+    if (forward) {
+        buffer_start_ = target_cell;
+    } else {
+        buffer_start_ = target_cell + 1 > max_cells ? target_cell + 1 - max_cells : 0;
+    }
 
     std::size_t new_size = std::min(max_cells, size_ - buffer_start_);
     buffer_.resize(new_size);
 
-    std::fseek(file_, buffer_start_ * CELL_SIZE, SEEK_SET);
-    std::fread(buffer_.data(), CELL_SIZE, buffer_.size(), file_);
+    readCells(buffer_, buffer_start_);
 
     buffer_dirty_ = false;
+}
+
+void FileTape::loadBufferAsync(std::size_t target_cell) {
+    bool forward = target_cell >= buffer_start_;
+    waitIo();
+
+    if (back_ready_ &&
+        target_cell >= back_start_ &&
+        target_cell < back_start_ + back_buffer_.size()) {
+        // Угадали: текущее окно уходит на фоновую запись, предзагруженное становится текущим
+        std::swap(buffer_, back_buffer_);
+        std::swap(buffer_start_, back_start_);
+        back_dirty_ = buffer_dirty_;
+        buffer_dirty_ = false;
+    } else {
+        if (buffer_dirty_) {
+            writeCells(buffer_, buffer_start_);
+            buffer_dirty_ = false;
+        }
+
+        // Окно ставим так, чтобы головка дальше двигалась внутри него
+        std::size_t cells = windowCells();
+        if (forward) {
+            buffer_start_ = target_cell;
+        } else {
+            buffer_start_ = target_cell + 1 > cells ? target_cell + 1 - cells : 0;
+        }
+        buffer_.resize(std::min(cells, size_ - buffer_start_));
+        readCells(buffer_, buffer_start_);
+    }
+
+    schedulePrefetch(forward);
+}
+
+void FileTape::schedulePrefetch(bool forward) {
+    std::size_t cells = windowCells();
+    std::size_t start = 0;
+    std::size_t count = 0;
+    if (forward) {
+        start = buffer_start_ + buffer_.size();
+        count = start < size_ ? std::min(cells, size_ - start) : 0;
+    } else {
+        start = buffer_start_ > cells ? buffer_start_ - cells : 0;
+        count = buffer_start_ - start;
+    }
+
+    back_ready_ = false;
+    if (!back_dirty_ && count == 0) {
+        return;
+    }
+
+    submitIo([this, start, count] {
+        if (back_dirty_) {
+            writeCells(back_buffer_, back_start_);
+            back_dirty_ = false;
+        }
+        if (count > 0) {
+            back_buffer_.resize(count);
+            readCells(back_buffer_, start);
+            back_start_ = start;
+            back_ready_ = true;
+        }
+    });
+}
+
+std::size_t FileTape::windowCells() const {
+    std::size_t bytes = async_io_ ? memory_limit_bytes_ / 2 : memory_limit_bytes_;
+    return std::max<std::size_t>(bytes / CELL_SIZE, 1);
+}
+
+void FileTape::submitIo(std::function<void()> job) {
+    std::lock_guard<std::mutex> lock(io_mutex_);
+    if (!io_thread_.joinable()) {
+        io_thread_ = std::thread(&FileTape::ioLoop, this);
+    }
+    io_job_ = std::move(job);
+    io_busy_ = true;
+    io_cv_.notify_all();
+}
+
+void FileTape::waitIo() {
+    std::unique_lock<std::mutex> lock(io_mutex_);
+    io_cv_.wait(lock, [this] { return !io_busy_; });
+    if (io_error_) {
+        std::exception_ptr error = io_error_;
+        io_error_ = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void FileTape::stopIo() {
+    {
+        std::lock_guard<std::mutex> lock(io_mutex_);
+        io_stop_ = true;
+        io_cv_.notify_all();
+    }
+    if (io_thread_.joinable()) {
+        io_thread_.join();
+    }
+}
+
+void FileTape::ioLoop() {
+    std::unique_lock<std::mutex> lock(io_mutex_);
+    while (true) {
+        io_cv_.wait(lock, [this] { return io_stop_ || io_job_; });
+        if (!io_job_) {
+            return;
+        }
+        std::function<void()> job = std::move(io_job_);
+        io_job_ = nullptr;
+        lock.unlock();
+        std::exception_ptr error;
+        try {
+            job();
+        } catch (...) {
+            error = std::current_exception();
+        }
+        lock.lock();
+        io_error_ = error;
+        io_busy_ = false;
+        io_cv_.notify_all();
+    }
+}
+
+void FileTape::writeCells(const std::vector<int32_t>& cells, std::size_t start) {
+    std::fseek(file_, (base_ + start) * CELL_SIZE, SEEK_SET);
+    std::fwrite(cells.data(), CELL_SIZE, cells.size(), file_);
+    std::fflush(file_);
+    ++metrics_.io_calls;
+    metrics_.bytes_written += cells.size() * CELL_SIZE;
+}
+
+void FileTape::readCells(std::vector<int32_t>& cells, std::size_t start) {
+    std::fseek(file_, (base_ + start) * CELL_SIZE, SEEK_SET);
+    std::fread(cells.data(), CELL_SIZE, cells.size(), file_);
+    ++metrics_.io_calls;
+    metrics_.bytes_read += cells.size() * CELL_SIZE;
 }
\ No newline at end of file
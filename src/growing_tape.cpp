@@ -0,0 +1,180 @@
+#include "growing_tape.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+    // Короче этого первый сегмент не делаем, чтобы не плодить мелкие ленты
+    constexpr std::size_t MIN_SEGMENT_CELLS = 1024;
+
+    // Ни один сегмент не получил буфер
+    constexpr std::size_t NO_SEGMENT = std::numeric_limits<std::size_t>::max();
+} // namespace
+
+GrowingTape::GrowingTape(const Tape& origin, std::size_t size, std::size_t buffer_bytes)
+    : origin_(origin)
+    , size_(size)
+    , first_cells_(std::max(buffer_bytes / sizeof(int32_t), MIN_SEGMENT_CELLS))
+    , memory_limit_bytes_(buffer_bytes)
+    , active_(NO_SEGMENT) {}
+
+int32_t GrowingTape::Read() {
+    Tape* segment = seek(position_, false);
+    return segment ? segment->Read() : 0;
+}
+
+void GrowingTape::Write(int32_t value) {
+    seek(position_, true)->Write(value);
+}
+
+std::size_t GrowingTape::ReadBlock(int32_t* out, std::size_t n) {
+    n = std::min(n, size_ - std::min(position_, size_));
+    for (std::size_t done = 0; done < n;) {
+        std::size_t cell = position_ + done;
+        std::size_t index = segmentOf(cell);
+        std::size_t chunk = std::min(n - done, segmentStart(index) + segmentLength(index) - cell);
+        Tape* segment = seek(cell, false);
+        if (segment) {
+            segment->ReadBlock(out + done, chunk);
+        } else {
+            std::fill(out + done, out + done + chunk, 0);
+        }
+        done += chunk;
+    }
+    if (n > 0) {
+        position_ = std::min(position_ + n, size_ - 1);
+    }
+    return n;
+}
+
+std::size_t GrowingTape::WriteBlock(const int32_t* in, std::size_t n) {
+    n = std::min(n, size_ - std::min(position_, size_));
+    for (std::size_t done = 0; done < n;) {
+        std::size_t cell = position_ + done;
+        std::size_t index = segmentOf(cell);
+        std::size_t chunk = std::min(n - done, segmentStart(index) + segmentLength(index) - cell);
+        seek(cell, true)->WriteBlock(in + done, chunk);
+        done += chunk;
+    }
+    if (n > 0) {
+        position_ = std::min(position_ + n, size_ - 1);
+    }
+    return n;
+}
+
+// Внутри сегмента под головкой двигаем и его головку, чтобы сдвиг учёлся как сдвиг.
+// В остальных случаях головку сегмента выставит seek при следующем обращении
+bool GrowingTape::Next() {
+    if (position_ + 1 >= size_) {
+        return false;
+    }
+    std::size_t index = segmentOf(position_);
+    ++position_;
+    if (index == active_ && segmentOf(position_) == index) {
+        segments_[index]->Next();
+    }
+    return true;
+}
+
+bool GrowingTape::Prev() {
+    if (position_ == 0) {
+        return false;
+    }
+    std::size_t index = segmentOf(position_);
+    --position_;
+    if (index == active_ && segmentOf(position_) == index) {
+        segments_[index]->Prev();
+    }
+    return true;
+}
+
+bool GrowingTape::Rewind(std::ptrdiff_t offset) {
+    std::ptrdiff_t target = static_cast<std::ptrdiff_t>(position_) + offset;
+    if (target < 0 || static_cast<std::size_t>(target) >= size_) {
+        return false;
+    }
+    position_ = static_cast<std::size_t>(target);
+    return true;
+}
+
+std::size_t GrowingTape::Size() const {
+    return size_;
+}
+
+std::size_t GrowingTape::Position() const {
+    return position_;
+}
+
+void GrowingTape::SetMemoryLimit(std::size_t bytes) {
+    memory_limit_bytes_ = bytes;
+    if (active_ != NO_SEGMENT) {
+        segments_[active_]->SetMemoryLimit(bytes);
+    }
+}
+
+std::unique_ptr<Tape> GrowingTape::CreateTemporary(std::size_t size,
+                                                   std::size_t buffer_bytes) const {
+    return origin_.CreateTemporary(size, buffer_bytes);
+}
+
+std::size_t GrowingTape::AllocatedCells() const {
+    std::size_t cells = 0;
+    for (const auto& segment : segments_) {
+        cells += segment->Size();
+    }
+    return cells;
+}
+
+std::size_t GrowingTape::segmentOf(std::size_t cell) const {
+    std::size_t index = 0;
+    std::size_t start = 0;
+    std::size_t length = first_cells_;
+    while (cell - start >= length) {
+        start += length;
+        length *= 2;
+        ++index;
+    }
+    return index;
+}
+
+std::size_t GrowingTape::segmentStart(std::size_t index) const {
+    std::size_t start = 0;
+    for (std::size_t i = 0; i < index; ++i) {
+        start += first_cells_ << i;
+    }
+    return start;
+}
+
+std::size_t GrowingTape::segmentLength(std::size_t index) const {
+    return std::min(first_cells_ << index, size_ - segmentStart(index));
+}
+
+Tape* GrowingTape::seek(std::size_t cell, bool create) {
+    std::size_t index = segmentOf(cell);
+    if (index >= segments_.size()) {
+        if (!create) {
+            return nullptr;
+        }
+        // Буфер при создании - не 0: сжатая временная лента (CompressedTape)
+        // выбирает по нему размер блока раз и навсегда
+        while (segments_.size() <= index) {
+            segments_.push_back(origin_.CreateTemporary(segmentLength(segments_.size()),
+                                                        first_cells_ * sizeof(int32_t)));
+        }
+    }
+
+    Tape* segment = segments_[index].get();
+    if (index != active_) {
+        if (active_ != NO_SEGMENT) {
+            segments_[active_]->SetMemoryLimit(0);
+        }
+        segment->SetMemoryLimit(memory_limit_bytes_);
+        active_ = index;
+    }
+
+    std::size_t local = cell - segmentStart(index);
+    if (segment->Position() != local) {
+        segment->Rewind(static_cast<std::ptrdiff_t>(local) - static_cast<std::ptrdiff_t>(segment->Position()));
+    }
+    return segment;
+}
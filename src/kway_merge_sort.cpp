@@ -0,0 +1,399 @@
+#include "external_sort.hpp"
+
+#include "kway_merge.hpp"
+#include "record.hpp"
+#include "run_generator.hpp"
+#include "tape.hpp"
+#include "tape_stream.hpp"
+
+#include <cstdint>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+// Меньше этого буфер ленты не делаем: иначе выигрыш от большего k съедят промахи буфера
+constexpr std::size_t MIN_TAPE_BUFFER_BYTES = 64 * 1024;
+
+using RunTape = ext_sort::detail::RunTape<int32_t>;
+using ValueKey = ext_sort::ScalarKey<int32_t>;
+
+// Ключ для наибольших: ~ обращает порядок int32
+struct DescendingKey {
+    using Key = int32_t;
+
+    Key operator()(int32_t value) const {
+        return ~value;
+    }
+};
+
+// Распределение серий по лентам для многофазного слияния
+// (алгоритм D из Кнута, т. 3, 5.4.2): после каждого уровня число серий
+// на лентах образует совершенное распределение Фибоначчи порядка ways,
+// недостающие до него серии считаются фиктивными
+class FibonacciDistribution {
+public:
+    explicit FibonacciDistribution(std::size_t ways)
+        : target_(ways, 1)
+        , dummy_(ways, 1) {}
+
+    // Номер ленты для очередной серии
+    std::size_t Next() {
+        if (pending_) {
+            advance();
+        }
+        pending_ = true;
+        --dummy_[current_];
+        return current_;
+    }
+
+    // Сколько фиктивных серий осталось на ленте
+    std::size_t Dummy(std::size_t tape) const {
+        return dummy_[tape];
+    }
+
+private:
+    void advance() {
+        std::size_t ways = target_.size();
+        if (current_ + 1 < ways && dummy_[current_] < dummy_[current_ + 1]) {
+            ++current_;
+            return;
+        }
+        current_ = 0;
+        if (dummy_[0] != 0) {
+            return;
+        }
+
+        // Переходим на следующий уровень распределения
+        std::size_t a = target_[0];
+        for (std::size_t i = 0; i < ways; ++i) {
+            std::size_t next = i + 1 < ways ? target_[i + 1] : 0;
+            dummy_[i] = a + next - target_[i];
+            target_[i] = a + next;
+        }
+    }
+
+    std::vector<std::size_t> target_; // сколько серий должно быть на ленте на текущем уровне
+    std::vector<std::size_t> dummy_;  // сколько из них ещё не записано
+    std::size_t current_ = 0;
+    bool pending_ = false;
+};
+
+std::size_t chooseFanIn(
+    std::size_t memory_limit_bytes,
+    std::size_t max_tapes,
+    bool polyphase,
+    std::size_t estimated_runs
+) {
+    if (max_tapes < (polyphase ? 3u : 4u)) {
+        throw std::runtime_error("max_tapes too small for k-way merge");
+    }
+
+    // Сколько лент (вместе с выходной) можно держать с буфером не меньше минимального
+    std::size_t affordable = memory_limit_bytes / MIN_TAPE_BUFFER_BYTES;
+    std::size_t fan_in = polyphase
+        ? std::min(max_tapes - 1, affordable > 2 ? affordable - 2 : 0)
+        : std::min(max_tapes / 2, affordable > 1 ? (affordable - 1) / 2 : 0);
+
+    fan_in = std::min(fan_in, estimated_runs);
+    return std::max<std::size_t>(fan_in, 2);
+}
+
+// Многофазное слияние на k+1 лентах: в каждой фазе сливаем на пустую ленту,
+// пока одна из входных не опустеет, и она становится следующей выходной
+void polyphaseMerge(std::vector<RunTape>& tapes, Tape& output, std::size_t block_elements,
+                    ext_sort::MergeStats& stats, ext_sort::SortProfile* profile) {
+    std::size_t out = tapes.size() - 1;
+
+    for (;;) {
+        std::vector<RunTape*> inputs;
+        for (std::size_t i = 0; i < tapes.size(); ++i) {
+            if (i != out && !tapes[i].runs.empty()) {
+                inputs.push_back(&tapes[i]);
+            }
+        }
+        if (ext_sort::detail::isLastMerge(inputs)) {
+            ext_sort::detail::finalMerge<int32_t, ValueKey>(inputs, output, block_elements, stats, profile);
+            return;
+        }
+        ext_sort::ScopedPhase phase(profile, "merge_pass");
+
+        std::size_t phase_runs = std::numeric_limits<std::size_t>::max();
+        for (const RunTape* t : inputs) {
+            phase_runs = std::min(phase_runs, t->runs.size());
+        }
+
+        // Остальные входные ленты продолжают читаться с текущей позиции
+        Tape& dest = *tapes[out].tape;
+        dest.Reset();
+        for (std::size_t r = 0; r < phase_runs; ++r) {
+            std::size_t length = ext_sort::detail::mergeRuns<int32_t, ValueKey>(inputs, dest, block_elements);
+            tapes[out].runs.push_back(length);
+            stats.merged_elements += length;
+        }
+        ++stats.passes;
+        dest.Reset();
+
+        for (std::size_t i = 0; i < tapes.size(); ++i) {
+            if (i != out && tapes[i].runs.empty()) {
+                out = i;
+                break;
+            }
+        }
+    }
+}
+
+// k наименьших из count элементов ленты (после xor с mask), по возрастанию.
+// Max-куча из k элементов: очередной элемент попадает в неё, только если меньше вершины
+std::vector<int32_t> selectSmallest(Tape& input, std::size_t count, std::size_t k,
+                                    std::size_t block_elements, int32_t mask) {
+    std::vector<int32_t> heap;
+    heap.reserve(k);
+    ext_sort::TapeReader reader(input, block_elements);
+    for (reader.Start(count); !reader.Empty(); reader.Pop()) {
+        int32_t value = reader.Peek() ^ mask;
+        if (heap.size() < k) {
+            heap.push_back(value);
+            std::push_heap(heap.begin(), heap.end());
+        } else if (value < heap.front()) {
+            std::pop_heap(heap.begin(), heap.end());
+            heap.back() = value;
+            std::push_heap(heap.begin(), heap.end());
+        }
+    }
+    std::sort_heap(heap.begin(), heap.end());
+    return heap;
+}
+
+} // namespace
+
+namespace ext_sort {
+
+MergeStats KWayMergeSort(
+    Tape& input,
+    Tape& output,
+    std::size_t memory_limit_bytes,
+    RunFormation formation,
+    std::size_t max_tapes,
+    bool polyphase,
+    std::size_t threads,
+    SortProfile* profile
+) {
+    if (memory_limit_bytes < sizeof(int32_t)) {
+        throw std::runtime_error("Memory limit too small for even one element");
+    }
+
+    MergeStats stats;
+    std::size_t total = input.Size();
+    if (total == 0) {
+        return stats;
+    }
+
+    // Половина памяти - на сортировку чанков, как в ChunkMergeSort
+    std::size_t sort_buffer = std::max(memory_limit_bytes / 2, sizeof(int32_t));
+    std::size_t max_elements = sort_buffer / sizeof(int32_t);
+    std::size_t chunk_elements = RunChunkElements(max_elements, formation, threads);
+    std::size_t estimated_runs = (total + chunk_elements - 1) / chunk_elements;
+
+    input.Reset();
+    output.SetMemoryLimit(memory_limit_bytes - sort_buffer);
+
+    // Всё помещается в один чанк: сортируем сразу в выходную ленту.
+    // Выбор с замещением мог бы дать тут больше одной серии - сортируем целиком
+    RunFormation in_memory = formation == RunFormation::ReplacementSelection ? RunFormation::Sort : formation;
+    if (total <= RunChunkElements(max_elements, in_memory)) {
+        ScopedPhase phase(profile, "sort_in_memory");
+        input.SetMemoryLimit(0);
+        output.Reset();
+        stats.runs = GenerateRuns(input, max_elements, in_memory,
+                                  [&]() -> Tape& { return output; }).size();
+        output.Reset();
+        return stats;
+    }
+
+    // Вход в памяти не поместился: может быть, он уже упорядочен
+    if (formation == RunFormation::NaturalRuns) {
+        ScopedPhase phase(profile, "presorted_scan");
+        if (CopyIfPresorted(input, output, memory_limit_bytes)) {
+            output.Reset();
+            stats.runs = 1;
+            return stats;
+        }
+    }
+
+    input.Reset();
+    output.SetMemoryLimit(memory_limit_bytes - sort_buffer);
+
+    std::size_t k = chooseFanIn(memory_limit_bytes, max_tapes, polyphase, estimated_runs);
+    std::size_t tape_count = polyphase ? k + 1 : 2 * k;
+    stats.fan_in = k;
+
+    // При формировании серий память делят входная лента и k лент, на которые пишем
+    std::size_t run_buffer = (memory_limit_bytes - sort_buffer) / (k + 1);
+    input.SetMemoryLimit(run_buffer);
+
+    std::vector<RunTape> tapes(tape_count);
+    for (RunTape& t : tapes) {
+        t.tape = input.CreateTemporary(total, run_buffer);
+    }
+
+    std::vector<std::size_t> chosen;
+    FibonacciDistribution distribution(k);
+    std::vector<std::size_t> runs;
+    {
+        ScopedPhase phase(profile, "sort_chunks");
+        runs = GenerateRuns(input, max_elements, formation, [&]() -> Tape& {
+            std::size_t index = polyphase ? distribution.Next() : chosen.size() % k;
+            chosen.push_back(index);
+            return *tapes[index].tape;
+        }, threads);
+    }
+    input.SetMemoryLimit(0);
+
+    stats.runs = runs.size();
+    if (polyphase) {
+        // Фиктивные серии идут первыми, чтобы сливаться в самых коротких фазах
+        for (std::size_t i = 0; i < k; ++i) {
+            tapes[i].runs.assign(distribution.Dummy(i), 0);
+        }
+    }
+    for (std::size_t r = 0; r < runs.size(); ++r) {
+        tapes[chosen[r]].runs.push_back(runs[r]);
+    }
+
+    // При слиянии память делят все временные ленты и выходная,
+    // из доли каждой берём блок для блочного чтения/записи
+    std::size_t merge_buffer = memory_limit_bytes / (tape_count + 1);
+    std::size_t block_elements = StreamBlockElements(merge_buffer);
+    for (RunTape& t : tapes) {
+        t.tape->SetMemoryLimit(TapeBytesAfterBlock(merge_buffer));
+        t.tape->Reset();
+    }
+    output.SetMemoryLimit(TapeBytesAfterBlock(merge_buffer));
+
+    if (polyphase) {
+        polyphaseMerge(tapes, output, block_elements, stats, profile);
+    } else {
+        detail::balancedMerge<int32_t, ValueKey>(tapes, k, output, block_elements, stats, profile);
+    }
+
+    output.Reset();
+    return stats;
+}
+
+std::size_t MergeFanIn(
+    std::size_t memory_limit_bytes,
+    std::size_t max_tapes,
+    bool polyphase,
+    std::size_t estimated_runs
+) {
+    return chooseFanIn(memory_limit_bytes, max_tapes, polyphase, estimated_runs);
+}
+
+MergeStats PartialSort(
+    Tape& input,
+    Tape& output,
+    std::size_t k,
+    std::size_t memory_limit_bytes,
+    bool largest,
+    std::size_t max_tapes,
+    SortProfile* profile
+) {
+    if (memory_limit_bytes < sizeof(int32_t)) {
+        throw std::runtime_error("Memory limit too small for even one element");
+    }
+
+    MergeStats stats;
+    std::size_t total = input.Size();
+    std::size_t keep = std::min(k, total);
+    if (keep == 0) {
+        return stats;
+    }
+
+    // В куче наибольшие ищем как наименьшие среди ~value: ~ обращает порядок int32.
+    // Серии на лентах для наибольших - по убыванию (DescendingKey)
+    int32_t mask = largest ? ~int32_t{0} : 0;
+
+    std::size_t sort_buffer = std::max(memory_limit_bytes / 2, sizeof(int32_t));
+    std::size_t max_elements = sort_buffer / sizeof(int32_t);
+    input.Reset();
+
+    // K элементов помещаются в память: один проход по входу с кучей,
+    // остаток памяти - пополам входной и выходной лентам
+    if (keep <= max_elements) {
+        ScopedPhase phase(profile, "top_k_heap");
+        std::size_t tape_buffer = (memory_limit_bytes - sort_buffer) / 2;
+        std::size_t block_elements = StreamBlockElements(tape_buffer);
+        input.SetMemoryLimit(TapeBytesAfterBlock(tape_buffer));
+        output.SetMemoryLimit(TapeBytesAfterBlock(tape_buffer));
+
+        std::vector<int32_t> smallest = selectSmallest(input, total, keep, block_elements, mask);
+        output.Reset();
+        {
+            TapeWriter writer(output, block_elements);
+            for (int32_t value : smallest) {
+                writer.Push(value ^ mask);
+            }
+        }
+        output.Reset();
+        stats.runs = 1;
+        return stats;
+    }
+
+    // Иначе серии из отсортированных чанков сливаются сбалансированно,
+    // но дальше K-го элемента ни одна слитая серия не пишется
+    std::size_t estimated_runs = (total + max_elements - 1) / max_elements;
+    std::size_t ways = chooseFanIn(memory_limit_bytes, max_tapes, false, estimated_runs);
+    stats.fan_in = ways;
+
+    std::size_t run_buffer = (memory_limit_bytes - sort_buffer) / (ways + 1);
+    input.SetMemoryLimit(run_buffer);
+    std::vector<RunTape> tapes(2 * ways);
+    for (RunTape& t : tapes) {
+        t.tape = input.CreateTemporary(total, run_buffer);
+    }
+
+    {
+        ScopedPhase phase(profile, "sort_chunks");
+        std::vector<int32_t> chunk(max_elements);
+        for (std::size_t done = 0; done < total; ++stats.runs) {
+            std::size_t length = input.ReadBlock(chunk.data(), std::min(max_elements, total - done));
+            auto end = chunk.begin() + static_cast<std::ptrdiff_t>(length);
+            if (largest) {
+                std::sort(chunk.begin(), end, std::greater<int32_t>());
+            } else {
+                std::sort(chunk.begin(), end);
+            }
+
+            RunTape& dest = tapes[stats.runs % ways];
+            dest.tape->WriteBlock(chunk.data(), length);
+            dest.runs.push_back(length);
+            done += length;
+        }
+    }
+    input.SetMemoryLimit(0);
+
+    std::size_t merge_buffer = memory_limit_bytes / (tapes.size() + 1);
+    std::size_t block_elements = StreamBlockElements(merge_buffer);
+    for (RunTape& t : tapes) {
+        t.tape->SetMemoryLimit(TapeBytesAfterBlock(merge_buffer));
+        t.tape->Reset();
+    }
+    output.SetMemoryLimit(TapeBytesAfterBlock(merge_buffer));
+
+    if (largest) {
+        detail::balancedMerge<int32_t, DescendingKey>(tapes, ways, output, block_elements, stats, profile, keep);
+    } else {
+        detail::balancedMerge<int32_t, ValueKey>(tapes, ways, output, block_elements, stats, profile, keep);
+    }
+
+    output.Reset();
+    return stats;
+}
+
+} // namespace ext_sort
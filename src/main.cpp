@@ -9,7 +9,8 @@
 
 int main(int argc, char* argv[]) {
     if (argc < 4) {
-        std::cerr << "Usage: " << argv[0] << " <input_file> <output_file> <config_file>\n";
+        std::cerr << "Usage: " << argv[0] << " <input_file> <output_file> <config_file>\n"
+                  << "  '-' as input_file or output_file means stdin or stdout\n";
         return 1;
     }
 
@@ -22,7 +23,8 @@ int main(int argc, char* argv[]) {
         ext_sort::FileSort(argv[1], argv[2], argv[3]);
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << "\n\n";
-        std::cerr << "Usage: " << argv[0] << " <input_file> <output_file> <config_file>\n";
+        std::cerr << "Usage: " << argv[0] << " <input_file> <output_file> <config_file>\n"
+                  << "  '-' as input_file or output_file means stdin or stdout\n";
         return 1;
     }
 
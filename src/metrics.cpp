@@ -0,0 +1,103 @@
+#include "metrics.hpp"
+
+#include "virtual_clock.hpp"
+
+#include <sstream>
+
+namespace {
+    void writeCounter(std::ostringstream& out, const char* name, std::size_t value, bool last = false) {
+        out << "\"" << name << "\": " << value << (last ? "" : ", ");
+    }
+
+    // Имена этапов и лент задаёт сама программа, но кавычки и '\' экранируем
+    std::string quoted(const std::string& text) {
+        std::string result = "\"";
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                result += '\\';
+            }
+            result += c;
+        }
+        return result + "\"";
+    }
+} // namespace
+
+TapeMetrics& TapeMetrics::operator+=(const TapeMetrics& other) {
+    reads += other.reads;
+    writes += other.writes;
+    shifts += other.shifts;
+    rewinds += other.rewinds;
+    buffer_misses += other.buffer_misses;
+    io_calls += other.io_calls;
+    bytes_read += other.bytes_read;
+    bytes_written += other.bytes_written;
+    delay_ms += other.delay_ms;
+    return *this;
+}
+
+void MetricsSink::Add(const TapeMetrics& metrics) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    total_ += metrics;
+}
+
+TapeMetrics MetricsSink::Total() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return total_;
+}
+
+namespace ext_sort {
+
+void SortProfile::Add(std::string name, double ms, std::size_t virtual_ms) {
+    phases_.push_back({std::move(name), ms, virtual_ms});
+}
+
+const std::vector<PhaseTiming>& SortProfile::Phases() const {
+    return phases_;
+}
+
+ScopedPhase::ScopedPhase(SortProfile* profile, const char* name)
+    : profile_(profile)
+    , name_(name)
+    , start_(std::chrono::steady_clock::now())
+    , virtual_start_(VirtualClock::Now()) {}
+
+ScopedPhase::~ScopedPhase() {
+    if (profile_) {
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start_;
+        profile_->Add(name_, elapsed.count(), VirtualClock::Now() - virtual_start_);
+    }
+}
+
+std::string MetricsJson(const SortProfile& profile,
+                        const std::vector<std::pair<std::string, TapeMetrics>>& tapes,
+                        std::size_t virtual_ms) {
+    std::ostringstream out;
+    out << "{\n  \"virtual_ms\": " << virtual_ms << ",\n  \"phases\": [";
+    const std::vector<PhaseTiming>& phases = profile.Phases();
+    for (std::size_t i = 0; i < phases.size(); ++i) {
+        out << (i == 0 ? "\n" : ",\n")
+            << "    {\"name\": " << quoted(phases[i].name) << ", \"ms\": " << phases[i].ms
+            << ", \"virtual_ms\": " << phases[i].virtual_ms << "}";
+    }
+    out << (phases.empty() ? "],\n" : "\n  ],\n");
+
+    out << "  \"tapes\": {";
+    for (std::size_t i = 0; i < tapes.size(); ++i) {
+        const TapeMetrics& m = tapes[i].second;
+        out << (i == 0 ? "\n" : ",\n") << "    " << quoted(tapes[i].first) << ": {";
+        writeCounter(out, "reads", m.reads);
+        writeCounter(out, "writes", m.writes);
+        writeCounter(out, "shifts", m.shifts);
+        writeCounter(out, "rewinds", m.rewinds);
+        writeCounter(out, "buffer_misses", m.buffer_misses);
+        writeCounter(out, "io_calls", m.io_calls);
+        writeCounter(out, "bytes_read", m.bytes_read);
+        writeCounter(out, "bytes_written", m.bytes_written);
+        writeCounter(out, "delay_ms", m.delay_ms, true);
+        out << "}";
+    }
+    out << (tapes.empty() ? "}\n" : "\n  }\n") << "}\n";
+    return out.str();
+}
+
+} // namespace ext_sort
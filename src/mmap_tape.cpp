@@ -0,0 +1,377 @@
+#include "mmap_tape.hpp"
+
+#include "virtual_clock.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+const std::size_t MmapTape::CELL_SIZE = sizeof(int32_t);
+std::atomic<std::size_t> MmapTape::tmp_counter_{0};
+
+namespace {
+    std::size_t pageSize() {
+        static const std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+        return page;
+    }
+} // namespace
+
+MmapTape::MmapTape(const std::string& filename,
+                   const Delays& delays,
+                   std::size_t memory_limit_bytes)
+    : filename_(filename)
+    , delays_(delays)
+    , memory_limit_bytes_(memory_limit_bytes)
+    {
+    fd_ = ::open(filename_.c_str(), O_RDWR);
+    if (fd_ < 0) {
+        throw std::runtime_error("Cannot open file: " + filename_);
+    }
+
+    struct stat st;
+    if (::fstat(fd_, &st) != 0) {
+        ::close(fd_);
+        throw std::runtime_error("Failed to tell file size: " + filename_);
+    }
+    if (static_cast<std::size_t>(st.st_size) % CELL_SIZE != 0) {
+        ::close(fd_);
+        throw std::runtime_error("Invalid tape file size: " + filename_);
+    }
+    size_ = static_cast<std::size_t>(st.st_size) / CELL_SIZE;
+}
+
+MmapTape::~MmapTape() {
+    unmapWindow();
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+    if (report_metrics_) {
+        temporaries_->Add(metrics_);
+    }
+
+    if (is_temporary_) {
+        if (pool_) {
+            pool_->Release(filename_);
+        } else {
+            std::remove(filename_.c_str());
+        }
+    }
+}
+
+int32_t MmapTape::Read() {
+    ++metrics_.reads;
+    applyDelay(delays_.read_ms);
+    return getValue(position_);
+}
+
+void MmapTape::Write(int32_t value) {
+    getValue(position_) = value;
+    window_dirty_ = true;
+    ++metrics_.writes;
+
+    applyDelay(delays_.write_ms);
+}
+
+std::size_t MmapTape::ReadBlock(int32_t* out, std::size_t n) {
+    std::size_t start = position_;
+    n = std::min(n, size_ - start);
+
+    for (std::size_t done = 0; done < n;) {
+        int32_t* first = &getValue(start + done);
+        std::size_t chunk = std::min(n - done, window_start_ + window_cells_ - (base_ + start + done));
+        std::copy_n(first, chunk, out + done);
+        done += chunk;
+    }
+    metrics_.reads += n;
+
+    shiftAfterBlock(n, delays_.read_ms);
+    return n;
+}
+
+std::size_t MmapTape::ReadBlockBackward(int32_t* out, std::size_t n) {
+    if (size_ == 0) {
+        return 0;
+    }
+    std::size_t start = position_;
+    n = std::min(n, start + 1);
+
+    for (std::size_t done = 0; done < n;) {
+        int32_t* last = &getValue(start - done);
+        std::size_t chunk = std::min(n - done, base_ + start - done - window_start_ + 1);
+        std::reverse_copy(last + 1 - chunk, last + 1, out + done);
+        done += chunk;
+    }
+    metrics_.reads += n;
+
+    shiftBackAfterBlock(n, delays_.read_ms);
+    return n;
+}
+
+std::size_t MmapTape::WriteBlock(const int32_t* in, std::size_t n) {
+    std::size_t start = position_;
+    n = std::min(n, size_ - start);
+
+    for (std::size_t done = 0; done < n;) {
+        int32_t* first = &getValue(start + done);
+        std::size_t chunk = std::min(n - done, window_start_ + window_cells_ - (base_ + start + done));
+        std::copy_n(in + done, chunk, first);
+        window_dirty_ = true;
+        done += chunk;
+    }
+    metrics_.writes += n;
+
+    shiftAfterBlock(n, delays_.write_ms);
+    return n;
+}
+
+bool MmapTape::Next() {
+    if (!shift(1)) {
+        return false;
+    }
+    ++metrics_.shifts;
+
+    applyDelay(delays_.shift_ms);
+    return true;
+}
+
+bool MmapTape::Prev() {
+    if (!shift(-1)) {
+        return false;
+    }
+    ++metrics_.shifts;
+
+    applyDelay(delays_.shift_ms);
+    return true;
+}
+
+bool MmapTape::Rewind(std::ptrdiff_t offset) {
+    if (!shift(offset)) {
+        return false;
+    }
+    ++metrics_.rewinds;
+
+    std::size_t delay_if_use_next = delays_.shift_ms * std::abs(offset);
+    applyDelay(std::min(delays_.rewind_ms, delay_if_use_next));
+    return true;
+}
+
+std::size_t MmapTape::Size() const {
+    return size_;
+}
+
+std::size_t MmapTape::Position() const {
+    return position_;
+}
+
+void MmapTape::SetMemoryLimit(std::size_t bytes) {
+    memory_limit_bytes_ = bytes;
+    if (map_length_ > windowBytes()) {
+        unmapWindow();
+    }
+}
+
+std::unique_ptr<Tape> MmapTape::CreateTemporary(std::size_t size,
+                                                std::size_t buffer_bytes) const {
+    if (pool_) {
+        // Файл из пула бывает длиннее ленты: лишние ячейки не видны
+        auto tmp = std::make_unique<MmapTape>(pool_->Acquire(size * CELL_SIZE), delays_, buffer_bytes);
+        tmp->size_ = size;
+        tmp->is_temporary_ = true;
+        tmp->pool_ = pool_;
+        tmp->temporaries_ = temporaries_;
+        tmp->report_metrics_ = true;
+        return tmp;
+    }
+
+    std::string tmp_name = "tmp/" + makeTmpFilename();
+    int fd = ::open(tmp_name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot create tmp file: " + tmp_name);
+    }
+    if (::ftruncate(fd, static_cast<off_t>(size * CELL_SIZE)) != 0) {
+        ::close(fd);
+        std::remove(tmp_name.c_str());
+        throw std::runtime_error("Cannot resize tmp file: " + tmp_name);
+    }
+    ::close(fd);
+
+    auto tmp = std::make_unique<MmapTape>(tmp_name, delays_, buffer_bytes);
+    tmp->is_temporary_ = true;
+    tmp->temporaries_ = temporaries_;
+    tmp->report_metrics_ = true;
+
+    return tmp;
+}
+
+std::unique_ptr<Tape> MmapTape::OpenSection(std::size_t first,
+                                             std::size_t length,
+                                             std::size_t buffer_bytes) {
+    if (first > size_ || length > size_ - first) {
+        throw std::runtime_error("Section out of tape bounds: " + filename_);
+    }
+    // Отображение MAP_SHARED согласовано с page cache, сбрасывать нечего
+
+    auto section = std::make_unique<MmapTape>(filename_, delays_, buffer_bytes);
+    section->base_ = base_ + first;
+    section->size_ = length;
+    section->pool_ = pool_;
+    // Участки временной ленты считаются с временными, участки исходной - с ней самой
+    section->temporaries_ = report_metrics_ ? temporaries_ : sections_;
+    section->report_metrics_ = true;
+
+    return section;
+}
+
+bool MmapTape::SupportsSections() const {
+    return true;
+}
+
+void MmapTape::SetTemporaryPool(std::shared_ptr<TempTapePool> pool) {
+    pool_ = std::move(pool);
+}
+
+TapeMetrics MmapTape::Metrics() {
+    TapeMetrics total = metrics_;
+    total += sections_->Total();
+    return total;
+}
+
+TapeMetrics MmapTape::TemporaryMetrics() const {
+    return temporaries_->Total();
+}
+
+std::string MmapTape::makeTmpFilename() const {
+    std::ostringstream oss;
+    oss << std::this_thread::get_id();
+    std::string thread_id = oss.str();
+    std::string base = filename_;
+    for (char& c : base) {
+        if (c == '/' || c == '\\' || c == ':' || c == '.') {
+            c = '_';
+        }
+    }
+    return base + "_mmap_" + thread_id + "_" + std::to_string(++tmp_counter_) + ".bin";
+}
+
+int32_t& MmapTape::getValue(std::size_t index) {
+    std::size_t cell = base_ + index;
+    if (cell < window_start_ || cell >= window_start_ + window_cells_) {
+        mapWindow(cell);
+    }
+    return window_[cell - window_start_];
+}
+
+bool MmapTape::shift(std::ptrdiff_t offset) {
+    position_ += offset;
+
+    if (position_ < 0 || position_ >= static_cast<std::ptrdiff_t>(size_)) {
+        position_ -= offset;
+        return false;
+    }
+
+    return true;
+}
+
+void MmapTape::shiftAfterBlock(std::size_t n, std::size_t op_delay_ms) {
+    if (n == 0) {
+        return;
+    }
+
+    std::size_t moved = std::min(n, size_ - 1 - position_);
+    position_ += moved;
+    metrics_.shifts += moved;
+    applyDelay(op_delay_ms * n + delays_.shift_ms * moved);
+}
+
+void MmapTape::shiftBackAfterBlock(std::size_t n, std::size_t op_delay_ms) {
+    if (n == 0) {
+        return;
+    }
+
+    std::size_t moved = std::min<std::size_t>(n, position_);
+    position_ -= moved;
+    metrics_.shifts += moved;
+    applyDelay(op_delay_ms * n + delays_.shift_ms * moved);
+}
+
+void MmapTape::applyDelay(std::size_t ms) {
+    metrics_.delay_ms += ms;
+    VirtualClock::Occupy(busy_until_, ms);
+    if (ms > 0 && !delays_.virtual_time) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    }
+}
+
+std::size_t MmapTape::windowBytes() const {
+    std::size_t page = pageSize();
+    return std::max(page, memory_limit_bytes_ / page * page);
+}
+
+void MmapTape::mapWindow(std::size_t file_cell) {
+    bool forward = file_cell >= window_start_;
+    unmapWindow();
+
+    std::size_t page = pageSize();
+    // Дальше конца ленты (или участка) не отображаем
+    std::size_t file_bytes = (base_ + size_) * CELL_SIZE;
+    std::size_t window = windowBytes();
+
+    // Окно ставим так, чтобы головка дальше двигалась внутри него
+    std::size_t offset = 0;
+    if (forward) {
+        offset = file_cell * CELL_SIZE / page * page;
+    } else {
+        std::size_t end = ((file_cell + 1) * CELL_SIZE + page - 1) / page * page;
+        offset = end > window ? end - window : 0;
+    }
+    std::size_t length = std::min(window, file_bytes - offset);
+
+    void* map = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, static_cast<off_t>(offset));
+    if (map == MAP_FAILED) {
+        throw std::runtime_error("Failed to mmap tape file: " + filename_);
+    }
+    ::madvise(map, length, MADV_SEQUENTIAL);
+    ::madvise(map, length, MADV_WILLNEED);
+    ++metrics_.buffer_misses;
+    ++metrics_.io_calls;
+    metrics_.bytes_read += length;
+
+    map_ = map;
+    map_length_ = length;
+    window_ = static_cast<int32_t*>(map);
+    window_start_ = offset / CELL_SIZE;
+    window_cells_ = length / CELL_SIZE;
+
+    // Следующее окно подчитываем в page cache заранее, не отображая его
+    std::size_t ahead = forward ? offset + length : (offset > window ? offset - window : 0);
+    std::size_t ahead_length = forward ? std::min(window, file_bytes - ahead) : offset - ahead;
+    if (ahead_length > 0) {
+        ::posix_fadvise(fd_, static_cast<off_t>(ahead), static_cast<off_t>(ahead_length), POSIX_FADV_WILLNEED);
+    }
+}
+
+void MmapTape::unmapWindow() {
+    if (!map_) {
+        return;
+    }
+
+    // Грязные страницы остаются в page cache, из отображения их можно выбросить сразу
+    ::madvise(map_, map_length_, MADV_DONTNEED);
+    ::munmap(map_, map_length_);
+    if (window_dirty_) {
+        metrics_.bytes_written += map_length_;
+        window_dirty_ = false;
+    }
+
+    map_ = nullptr;
+    map_length_ = 0;
+    window_ = nullptr;
+    window_cells_ = 0;
+}
@@ -0,0 +1,317 @@
+#include "planner.hpp"
+
+#include "run_generator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <unordered_map>
+
+namespace {
+
+// Сколько данных проходит через ленты за сортировку
+struct Traffic {
+    double reads = 0;
+    double writes = 0;
+    double rewinds = 0;      // перемоток в начало ленты
+    double rewind_cells = 0; // типичная длина перематываемой ленты
+};
+
+double tapeMs(const Delays& d, const Traffic& t) {
+    double rewind = std::min<double>(static_cast<double>(d.rewind_ms),
+                                     static_cast<double>(d.shift_ms) * t.rewind_cells);
+    return t.reads * static_cast<double>(d.read_ms + d.shift_ms) +
+           t.writes * static_cast<double>(d.write_ms + d.shift_ms) +
+           t.rewinds * rewind;
+}
+
+ext_sort::SortPlan makePlan(ext_sort::Strategy strategy, ext_sort::RunFormation formation,
+                            std::size_t fan_in, std::size_t runs, std::size_t passes,
+                            const Traffic& traffic, const Delays& delays) {
+    return ext_sort::SortPlan{strategy, formation, fan_in, runs, passes,
+                              tapeMs(delays, traffic), traffic.reads + traffic.writes};
+}
+
+// Сколько проходов слияния по fan_in серий нужно, чтобы из runs осталась одна
+std::size_t mergePasses(std::size_t runs, std::size_t fan_in) {
+    std::size_t passes = 0;
+    for (double covered = 1; covered < static_cast<double>(runs); covered *= static_cast<double>(fan_in)) {
+        ++passes;
+    }
+    return passes;
+}
+
+std::size_t divideUp(std::size_t a, std::size_t b) {
+    return (a + b - 1) / b;
+}
+
+// Оценка числа различных значений по выборке (Chao1): d + f1^2 / (2 f2),
+// где f1 и f2 - сколько значений встретилось в выборке один и два раза.
+// Без выборки считаем все значения различными
+double estimateDistinct(const std::vector<int32_t>& sample, std::size_t elements) {
+    if (sample.empty()) {
+        return static_cast<double>(elements);
+    }
+
+    std::unordered_map<int32_t, std::size_t> counts;
+    for (int32_t v : sample) {
+        ++counts[v];
+    }
+    double f1 = 0;
+    double f2 = 0;
+    for (const auto& [value, count] : counts) {
+        f1 += count == 1;
+        f2 += count == 2;
+    }
+
+    double d = static_cast<double>(counts.size());
+    double estimate = f2 > 0 ? d + f1 * f1 / (2 * f2) : d + f1 * (f1 - 1) / 2;
+    return std::min(estimate, static_cast<double>(elements));
+}
+
+// Число серий: у выбора с замещением серии в среднем вдвое длиннее кучи,
+// на упорядоченных данных - одна, на упорядоченных по убыванию - длиной в кучу.
+// Естественные серии на упорядоченных в любую сторону данных - одна (вход копируется),
+// иначе - по чанку
+std::size_t estimateRuns(const ext_sort::PlanInput& input, ext_sort::RunFormation formation, std::size_t chunk) {
+    const std::vector<int32_t>& s = input.sample;
+    if (formation == ext_sort::RunFormation::NaturalRuns) {
+        bool presorted = s.size() > 1 &&
+            (std::is_sorted(s.begin(), s.end()) || std::is_sorted(s.rbegin(), s.rend()));
+        return presorted ? 1 : divideUp(input.elements, chunk);
+    }
+    if (formation != ext_sort::RunFormation::ReplacementSelection) {
+        return divideUp(input.elements, chunk);
+    }
+
+    if (s.size() > 1 && std::is_sorted(s.begin(), s.end())) {
+        return 1;
+    }
+    if (s.size() > 1 && std::is_sorted(s.rbegin(), s.rend())) {
+        return divideUp(input.elements, chunk);
+    }
+    return divideUp(input.elements, 2 * chunk);
+}
+
+// Естественные серии на упорядоченном входе: проверка чтением и проход копирования,
+// без временных лент
+bool presortedCopy(ext_sort::Strategy strategy, ext_sort::RunFormation formation, std::size_t runs,
+                   const ext_sort::PlanInput& input, std::vector<ext_sort::SortPlan>& plans) {
+    if (formation != ext_sort::RunFormation::NaturalRuns || runs != 1) {
+        return false;
+    }
+    double n = static_cast<double>(input.elements);
+    plans.push_back(makePlan(strategy, formation, 0, 1, 1, Traffic{2 * n, n, 2, n}, input.delays));
+    return true;
+}
+
+void addCounting(const ext_sort::PlanInput& input, std::vector<ext_sort::SortPlan>& plans) {
+    ext_sort::CountingLimits limits = ext_sort::CountingSortLimits(input.memory_limit_bytes);
+    if (limits.dense_values == 0) {
+        return;
+    }
+
+    // Проходов: один, если хватает счётчиков, иначе ещё по одному на каждый уровень разделов
+    bool known_range = input.value_min.has_value() && input.value_max.has_value();
+    double width = known_range
+        ? static_cast<double>(static_cast<int64_t>(*input.value_max) - *input.value_min + 1)
+        : 0;
+    std::size_t passes = 1;
+    if (!known_range || width > static_cast<double>(limits.dense_values)) {
+        double distinct = estimateDistinct(input.sample, input.elements);
+        if (known_range) {
+            distinct = std::min(distinct, width);
+        }
+        double capacity = static_cast<double>(std::max<std::size_t>(limits.distinct_values, 1));
+        if (distinct > capacity) {
+            passes += mergePasses(static_cast<std::size_t>(std::ceil(distinct / capacity)), limits.partitions);
+        }
+    }
+
+    double n = static_cast<double>(input.elements);
+    Traffic traffic{n * passes, n * passes, 2.0 * passes, n};
+    plans.push_back(makePlan(ext_sort::Strategy::Counting, ext_sort::RunFormation::Sort,
+                             0, 0, passes, traffic, input.delays));
+}
+
+void addChunkMerge(const ext_sort::PlanInput& input, ext_sort::RunFormation formation,
+                   std::size_t max_elements, std::vector<ext_sort::SortPlan>& plans) {
+    double n = static_cast<double>(input.elements);
+
+    // Всё помещается в память - серия пишется сразу в выходную ленту
+    ext_sort::RunFormation in_memory = formation == ext_sort::RunFormation::ReplacementSelection
+        ? ext_sort::RunFormation::Sort
+        : formation;
+    if (input.elements <= ext_sort::RunChunkElements(max_elements, in_memory)) {
+        for (ext_sort::Strategy strategy : {ext_sort::Strategy::ChunkMerge, ext_sort::Strategy::AlternatingMerge}) {
+            plans.push_back(makePlan(strategy, formation, 0, 1, 1, Traffic{n, n, 2, n}, input.delays));
+        }
+        return;
+    }
+
+    std::size_t chunk = ext_sort::RunChunkElements(max_elements, formation, input.threads);
+    std::size_t runs = estimateRuns(input, formation, chunk);
+    if (presortedCopy(ext_sort::Strategy::ChunkMerge, formation, runs, input, plans)) {
+        return;
+    }
+    std::size_t merges = mergePasses(runs, 2);
+
+    // Формирование серий и проходы слияния; последний пишет сразу в выходную ленту.
+    // Одну серию остаётся только скопировать
+    std::size_t passes = std::max<std::size_t>(merges, 1) + 1;
+    Traffic traffic{n * passes, n * passes, merges == 0 ? 5.0 : 2.0 + 4.0 * merges, n / 2};
+    plans.push_back(makePlan(ext_sort::Strategy::ChunkMerge, formation, 2, runs, passes,
+                             traffic, input.delays));
+
+    // Те же проходы без перемоток временных лент: остаются вход, выход
+    // и, если последние серии оказались по возрастанию, две временные ленты
+    traffic.rewinds = merges == 0 ? 3.0 : 2.0 + 2.0 * (merges % 2);
+    plans.push_back(makePlan(ext_sort::Strategy::AlternatingMerge, formation, 2, runs, passes,
+                             traffic, input.delays));
+}
+
+void addKWayMerge(const ext_sort::PlanInput& input, ext_sort::RunFormation formation,
+                  std::size_t max_elements, std::vector<ext_sort::SortPlan>& plans) {
+    double n = static_cast<double>(input.elements);
+
+    // Всё помещается в память - сортируем сразу в выходную ленту, как и KWayMergeSort
+    ext_sort::RunFormation in_memory = formation == ext_sort::RunFormation::ReplacementSelection
+        ? ext_sort::RunFormation::Sort
+        : formation;
+    if (input.elements <= ext_sort::RunChunkElements(max_elements, in_memory)) {
+        plans.push_back(makePlan(ext_sort::Strategy::KWayMerge, formation, 0, 1, 1,
+                                 Traffic{n, n, 2, n}, input.delays));
+        return;
+    }
+    if (input.max_tapes < 4) {
+        return;
+    }
+
+    std::size_t chunk = ext_sort::RunChunkElements(max_elements, formation, input.threads);
+    std::size_t runs = estimateRuns(input, formation, chunk);
+    if (presortedCopy(ext_sort::Strategy::KWayMerge, formation, runs, input, plans)) {
+        return;
+    }
+    std::size_t max_fan_in = ext_sort::MergeFanIn(input.memory_limit_bytes, input.max_tapes, false,
+                                                  divideUp(input.elements, chunk));
+
+    // Для каждого числа проходов - наименьшее k: меньше лент перематывать
+    std::size_t last_merges = 0;
+    for (std::size_t k = 2; k <= max_fan_in; ++k) {
+        std::size_t merges = std::max<std::size_t>(mergePasses(runs, k), 1);
+        if (k > 2 && merges == last_merges) {
+            continue;
+        }
+        last_merges = merges;
+
+        Traffic traffic{n * (merges + 1), n * (merges + 1),
+                        static_cast<double>(k + 2 + 2 * k * merges), n / static_cast<double>(k)};
+        plans.push_back(makePlan(ext_sort::Strategy::KWayMerge, formation, k, runs, merges + 1,
+                                 traffic, input.delays));
+    }
+}
+
+const char* formationName(ext_sort::RunFormation formation) {
+    switch (formation) {
+    case ext_sort::RunFormation::Sort:
+        return "std::sort chunks";
+    case ext_sort::RunFormation::HeapSort:
+        return "heap sort chunks";
+    case ext_sort::RunFormation::RadixSort:
+        return "radix sort chunks";
+    case ext_sort::RunFormation::ReplacementSelection:
+        return "replacement selection";
+    case ext_sort::RunFormation::NaturalRuns:
+        return "natural runs";
+    }
+    return "";
+}
+
+} // namespace
+
+namespace ext_sort {
+
+std::vector<SortPlan> EstimatePlans(const PlanInput& input) {
+    std::vector<SortPlan> plans;
+    addCounting(input, plans);
+
+    // Чанки - тем способом, что в конфиге, и выбором с замещением
+    std::vector<RunFormation> formations = {
+        input.formation == RunFormation::ReplacementSelection ? RunFormation::Sort : input.formation,
+        RunFormation::ReplacementSelection
+    };
+    std::size_t sort_buffer = std::max(input.memory_limit_bytes / 2, sizeof(int32_t));
+    std::size_t max_elements = sort_buffer / sizeof(int32_t);
+    for (RunFormation formation : formations) {
+        addChunkMerge(input, formation, max_elements, plans);
+        addKWayMerge(input, formation, max_elements, plans);
+    }
+
+    std::stable_sort(plans.begin(), plans.end(), [](const SortPlan& a, const SortPlan& b) {
+        if (a.tape_ms != b.tape_ms) {
+            return a.tape_ms < b.tape_ms;
+        }
+        return a.moved < b.moved;
+    });
+    return plans;
+}
+
+SortPlan ChoosePlan(const PlanInput& input) {
+    return EstimatePlans(input).front();
+}
+
+std::string DescribePlan(const SortPlan& plan) {
+    std::ostringstream out;
+    switch (plan.strategy) {
+    case Strategy::Counting:
+        out << "Counting Sort";
+        break;
+    case Strategy::ChunkMerge:
+        out << "Chunk Merge Sort (" << formationName(plan.formation) << ", "
+            << plan.runs << " runs)";
+        break;
+    case Strategy::AlternatingMerge:
+        out << "Alternating Merge Sort (" << formationName(plan.formation) << ", "
+            << plan.runs << " runs)";
+        break;
+    case Strategy::KWayMerge:
+        out << "K-way Merge Sort (" << formationName(plan.formation) << ", "
+            << plan.runs << " runs";
+        if (plan.fan_in > 0) {
+            out << ", k = " << plan.fan_in;
+        }
+        out << ")";
+        break;
+    }
+    out << ": " << plan.passes << (plan.passes == 1 ? " pass" : " passes")
+        << ", ~" << static_cast<std::size_t>(plan.tape_ms) << " ms of tape delays, "
+        << static_cast<std::size_t>(plan.moved) << " elements moved";
+    return out.str();
+}
+
+std::vector<int32_t> SampleTape(Tape& tape, std::size_t count) {
+    std::size_t size = tape.Size();
+    std::size_t sample_size = std::min(count, size);
+    std::vector<int32_t> sample;
+    sample.reserve(sample_size);
+
+    // Сдвиги - от постоянного зерна: план одного и того же входа не меняется
+    std::mt19937_64 random(0x5EED);
+    tape.Reset();
+    std::size_t position = 0;
+    for (std::size_t i = 0; i < sample_size; ++i) {
+        std::size_t first = i * size / sample_size;
+        std::size_t width = (i + 1) * size / sample_size - first;
+        std::size_t target = first + static_cast<std::size_t>(random() % width);
+        if (target != position) {
+            tape.Rewind(static_cast<std::ptrdiff_t>(target - position));
+            position = target;
+        }
+        sample.push_back(tape.Read());
+    }
+    tape.Reset();
+    return sample;
+}
+
+} // namespace ext_sort
@@ -0,0 +1,397 @@
+#include "run_generator.hpp"
+
+#include "tape.hpp"
+#include "tape_stream.hpp"
+#include "virtual_clock.hpp"
+
+#include <cstdint>
+
+#include <algorithm>
+#include <functional>
+#include <future>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+// Разряд radix sort - байт, ключ - 4 байта
+constexpr unsigned RADIX_BITS = 8;
+constexpr std::size_t RADIX_BUCKETS = std::size_t{1} << RADIX_BITS;
+constexpr unsigned RADIX_PASSES = 32 / RADIX_BITS;
+
+// На коротких чанках подсчёт гистограмм дороже самой сортировки
+constexpr std::size_t RADIX_MIN_ELEMENTS = 256;
+
+// Беззнаковый ключ с тем же порядком, что у int32
+uint32_t radixKey(int32_t value) {
+    return static_cast<uint32_t>(value) ^ 0x80000000u;
+}
+
+std::size_t radixDigit(int32_t value, unsigned pass) {
+    return (radixKey(value) >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1);
+}
+
+void sortChunk(std::vector<int32_t>& chunk, ext_sort::RunFormation formation, std::vector<int32_t>& scratch) {
+    if (formation == ext_sort::RunFormation::RadixSort) {
+        ext_sort::RadixSortChunk(chunk, scratch);
+    } else {
+        ext_sort::SortChunk(chunk, formation == ext_sort::RunFormation::HeapSort);
+    }
+}
+
+// Чанки по RunChunkElements(buffer_elements), каждый сортируется целиком
+std::vector<std::size_t> sortedChunks(
+    Tape& input,
+    std::size_t buffer_elements,
+    ext_sort::RunFormation formation,
+    const std::function<Tape&()>& next_tape
+) {
+    std::size_t chunk_elements = ext_sort::RunChunkElements(buffer_elements, formation);
+    std::vector<int32_t> buffer;
+    buffer.reserve(chunk_elements);
+    std::vector<int32_t> scratch;
+
+    std::vector<std::size_t> runs;
+    std::size_t total = input.Size();
+    std::size_t processed = input.Position();
+    while (processed < total) {
+        std::size_t chunk_size = std::min(chunk_elements, total - processed);
+        buffer.resize(chunk_size);
+        input.ReadBlock(buffer.data(), chunk_size);
+
+        sortChunk(buffer, formation, scratch);
+
+        next_tape().WriteBlock(buffer.data(), buffer.size());
+
+        runs.push_back(chunk_size);
+        processed += chunk_size;
+    }
+
+    return runs;
+}
+
+// Конвейер для threads > 1: буфер делится на threads + 1 слотов.
+// Вызывающий поток читает очередной чанк в свободный слот, сортировка идёт
+// в фоновой задаче, запись - в следующей, которая ждёт и сортировку, и запись
+// предыдущего чанка, поэтому серии попадают на ленты строго по порядку.
+// Задача записи возвращает виртуальное время, когда запись закончилась
+std::vector<std::size_t> parallelSortedChunks(
+    Tape& input,
+    std::size_t buffer_elements,
+    ext_sort::RunFormation formation,
+    const std::function<Tape&()>& next_tape,
+    std::size_t threads
+) {
+    struct Slot {
+        std::vector<int32_t> data;
+        std::vector<int32_t> scratch;     // для RadixSort
+        std::shared_future<std::size_t> written; // чанк из слота записан
+    };
+
+    std::size_t chunk_elements = ext_sort::RunChunkElements(buffer_elements, formation, threads);
+    std::vector<std::size_t> runs;
+    std::shared_future<std::size_t> last_written;
+    std::vector<Slot> slots(threads + 1);
+
+    std::size_t total = input.Size();
+    std::size_t processed = input.Position();
+    try {
+        for (std::size_t chunk = 0; processed < total; ++chunk) {
+            Slot& slot = slots[chunk % slots.size()];
+            if (slot.written.valid()) {
+                VirtualClock::AdvanceTo(slot.written.get());
+            }
+
+            std::size_t chunk_size = std::min(chunk_elements, total - processed);
+            slot.data.resize(chunk_size);
+            input.ReadBlock(slot.data.data(), chunk_size);
+            processed += chunk_size;
+
+            std::future<void> sorted = std::async(std::launch::async, [&slot, formation] {
+                sortChunk(slot.data, formation, slot.scratch);
+            });
+            slot.written = std::async(std::launch::async,
+                [&slot, &runs, &next_tape, sorted = std::move(sorted), previous = last_written,
+                 read_at = VirtualClock::Now()]() mutable {
+                    sorted.get();
+                    VirtualClock::Set(read_at);
+                    if (previous.valid()) {
+                        VirtualClock::AdvanceTo(previous.get());
+                        // Иначе состояния задач держат друг друга цепочкой длиной в число серий
+                        previous = {};
+                    }
+                    next_tape().WriteBlock(slot.data.data(), slot.data.size());
+                    runs.push_back(slot.data.size());
+                    return VirtualClock::Now();
+                }).share();
+            last_written = slot.written;
+        }
+
+        if (last_written.valid()) {
+            VirtualClock::AdvanceTo(last_written.get());
+        }
+    } catch (...) {
+        // Фоновые задачи ссылаются на слоты: дожидаемся их, прежде чем отпустить память
+        for (Slot& slot : slots) {
+            if (slot.written.valid()) {
+                slot.written.wait();
+            }
+        }
+        throw;
+    }
+
+    return runs;
+}
+
+// Естественные серии: чанк по buffer_elements упорядочивается (проверкой,
+// разворотом или std::sort) и дописывается к текущей серии, если его первый
+// элемент не меньше её последнего. Почти упорядоченный вход даёт длинные серии
+std::vector<std::size_t> naturalRuns(
+    Tape& input,
+    std::size_t buffer_elements,
+    const std::function<Tape&()>& next_tape
+) {
+    std::vector<int32_t> buffer;
+    buffer.reserve(buffer_elements);
+
+    std::vector<std::size_t> runs;
+    Tape* run_tape = nullptr;
+    int32_t run_last = 0;
+    std::size_t total = input.Size();
+    std::size_t processed = input.Position();
+    while (processed < total) {
+        std::size_t chunk_size = std::min(buffer_elements, total - processed);
+        buffer.resize(chunk_size);
+        input.ReadBlock(buffer.data(), chunk_size);
+        processed += chunk_size;
+
+        if (!std::is_sorted(buffer.begin(), buffer.end())) {
+            if (std::is_sorted(buffer.rbegin(), buffer.rend())) {
+                std::reverse(buffer.begin(), buffer.end());
+            } else {
+                std::sort(buffer.begin(), buffer.end());
+            }
+        }
+
+        if (run_tape == nullptr || buffer.front() < run_last) {
+            run_tape = &next_tape();
+            runs.push_back(0);
+        }
+        run_tape->WriteBlock(buffer.data(), buffer.size());
+        runs.back() += chunk_size;
+        run_last = buffer.back();
+    }
+
+    return runs;
+}
+
+// Выбор с замещением: buffer[0, heap_end) - min-куча текущей серии,
+// buffer[heap_end, count) - элементы, меньшие последнего записанного,
+// они ждут следующей серии. Из бюджета берутся ещё два блока потоков
+std::vector<std::size_t> replacementSelection(
+    Tape& input,
+    std::size_t buffer_elements,
+    const std::function<Tape&()>& next_tape
+) {
+    std::size_t block = std::max<std::size_t>(1, std::min(ext_sort::MAX_STREAM_BLOCK_ELEMENTS, buffer_elements / 16));
+    std::size_t heap_capacity = buffer_elements > 2 * block ? buffer_elements - 2 * block : 1;
+
+    std::size_t total = input.Size();
+    ext_sort::TapeReader reader(input, block);
+    reader.Start(total - input.Position());
+
+    std::vector<int32_t> buffer;
+    buffer.reserve(heap_capacity);
+    while (!reader.Empty() && buffer.size() < heap_capacity) {
+        buffer.push_back(reader.Peek());
+        reader.Pop();
+    }
+
+    std::greater<int32_t> min_heap;
+    std::vector<std::size_t> runs;
+    std::size_t count = buffer.size();
+    while (count > 0) {
+        std::size_t heap_end = count;
+        std::make_heap(buffer.begin(), buffer.begin() + heap_end, min_heap);
+
+        ext_sort::TapeWriter writer(next_tape(), block);
+        std::size_t run_length = 0;
+        while (heap_end > 0) {
+            std::pop_heap(buffer.begin(), buffer.begin() + heap_end, min_heap);
+            int32_t last = buffer[heap_end - 1];
+            writer.Push(last);
+            ++run_length;
+
+            if (!reader.Empty()) {
+                int32_t value = reader.Peek();
+                reader.Pop();
+
+                buffer[heap_end - 1] = value;
+                if (value >= last) {
+                    std::push_heap(buffer.begin(), buffer.begin() + heap_end, min_heap);
+                } else {
+                    --heap_end;
+                }
+            } else {
+                // Вход кончился: освободившееся место занимает последний отложенный элемент
+                --heap_end;
+                buffer[heap_end] = buffer[count - 1];
+                --count;
+            }
+        }
+
+        runs.push_back(run_length);
+    }
+
+    return runs;
+}
+
+} // namespace
+
+namespace ext_sort {
+
+void SortChunk(std::vector<int32_t>& chunk, bool use_heap_sort) {
+    if (use_heap_sort) {
+        std::make_heap(chunk.begin(), chunk.end());
+        std::sort_heap(chunk.begin(), chunk.end());
+    } else {
+        std::sort(chunk.begin(), chunk.end());
+    }
+}
+
+void SortChunk(std::vector<int32_t>& chunk, RunFormation formation) {
+    std::vector<int32_t> scratch;
+    sortChunk(chunk, formation, scratch);
+}
+
+void RadixSortChunk(std::vector<int32_t>& chunk, std::vector<int32_t>& scratch) {
+    std::size_t n = chunk.size();
+    if (n < RADIX_MIN_ELEMENTS) {
+        std::sort(chunk.begin(), chunk.end());
+        return;
+    }
+    scratch.resize(n);
+
+    // Гистограммы всех разрядов за один проход по данным
+    std::vector<std::size_t> counts(RADIX_PASSES * RADIX_BUCKETS, 0);
+    for (int32_t value : chunk) {
+        for (unsigned pass = 0; pass < RADIX_PASSES; ++pass) {
+            ++counts[pass * RADIX_BUCKETS + radixDigit(value, pass)];
+        }
+    }
+
+    int32_t* src = chunk.data();
+    int32_t* dst = scratch.data();
+    for (unsigned pass = 0; pass < RADIX_PASSES; ++pass) {
+        std::size_t* count = counts.data() + pass * RADIX_BUCKETS;
+        if (count[radixDigit(src[0], pass)] == n) {
+            continue;
+        }
+
+        std::size_t offset = 0;
+        for (std::size_t digit = 0; digit < RADIX_BUCKETS; ++digit) {
+            std::size_t c = count[digit];
+            count[digit] = offset;
+            offset += c;
+        }
+        for (std::size_t i = 0; i < n; ++i) {
+            dst[count[radixDigit(src[i], pass)]++] = src[i];
+        }
+        std::swap(src, dst);
+    }
+
+    if (src != chunk.data()) {
+        chunk.swap(scratch);
+    }
+}
+
+std::vector<std::size_t> GenerateRuns(
+    Tape& input,
+    std::size_t buffer_elements,
+    RunFormation formation,
+    const std::function<Tape&()>& next_tape,
+    std::size_t threads
+) {
+    if (buffer_elements == 0) {
+        throw std::runtime_error("Sort buffer too small for even one element");
+    }
+
+    if (formation == RunFormation::ReplacementSelection) {
+        return replacementSelection(input, buffer_elements, next_tape);
+    }
+    if (formation == RunFormation::NaturalRuns) {
+        return naturalRuns(input, buffer_elements, next_tape);
+    }
+
+    if (threads > 1) {
+        return parallelSortedChunks(input, buffer_elements, formation, next_tape, threads);
+    }
+    return sortedChunks(input, buffer_elements, formation, next_tape);
+}
+
+std::size_t RunChunkElements(
+    std::size_t buffer_elements,
+    RunFormation formation,
+    std::size_t threads
+) {
+    if (formation == RunFormation::ReplacementSelection || formation == RunFormation::NaturalRuns) {
+        return buffer_elements;
+    }
+    std::size_t chunk = threads > 1 ? buffer_elements / (threads + 1) : buffer_elements;
+    if (formation == RunFormation::RadixSort) {
+        chunk /= 2;
+    }
+    return std::max<std::size_t>(chunk, 1);
+}
+
+bool CopyIfPresorted(Tape& input, Tape& output, std::size_t memory_limit_bytes) {
+    std::size_t share = memory_limit_bytes / 2;
+    std::size_t block_elements = StreamBlockElements(share);
+    input.SetMemoryLimit(TapeBytesAfterBlock(share));
+    input.Reset();
+
+    // Только чтение: на почти упорядоченном входе с поздним нарушением порядка
+    // не пишем в output то, что придётся выбросить.
+    // 0 - пока все элементы равны, 1 - по возрастанию, -1 - по убыванию
+    int direction = 0;
+    std::vector<int32_t> block(block_elements);
+    std::size_t total = input.Size();
+    int32_t last = 0;
+    for (std::size_t read = 0; read < total;) {
+        std::size_t n = input.ReadBlock(block.data(), std::min(block_elements, total - read));
+        for (std::size_t i = read == 0 ? 1 : 0; i < n; ++i) {
+            int32_t prev = i == 0 ? last : block[i - 1];
+            if (block[i] == prev) {
+                continue;
+            }
+            int step = block[i] > prev ? 1 : -1;
+            if (direction == -step) {
+                return false;
+            }
+            direction = step;
+        }
+        last = block[n - 1];
+        read += n;
+    }
+
+    output.SetMemoryLimit(TapeBytesAfterBlock(share));
+    output.Reset();
+    if (direction < 0) {
+        // Головка входа - у его конца: копируем назад, без перемотки
+        if (input.Position() >= total) {
+            input.Prev();
+        }
+    } else {
+        input.Reset();
+    }
+    for (std::size_t copied = 0; copied < total;) {
+        std::size_t want = std::min(block_elements, total - copied);
+        std::size_t n = direction < 0 ? input.ReadBlockBackward(block.data(), want)
+                                      : input.ReadBlock(block.data(), want);
+        output.WriteBlock(block.data(), n);
+        copied += n;
+    }
+    return true;
+}
+
+} // namespace ext_sort
@@ -0,0 +1,208 @@
+#include "stream_sort.hpp"
+
+#include "file_tape.hpp"
+#include "loser_tree.hpp"
+#include "run_generator.hpp"
+#include "tape_stream.hpp"
+
+#include <cstdint>
+#include <cstdio>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Серия на ленте: где начинается и сколько в ней элементов
+struct Run {
+    std::size_t offset;
+    std::size_t length;
+};
+
+// Читает следующий чанк потока (до chunk_elements элементов)
+void readChunk(StreamInputTape& input, std::vector<int32_t>& chunk, std::size_t chunk_elements) {
+    chunk.resize(chunk_elements);
+    chunk.resize(input.ReadBlock(chunk.data(), chunk_elements));
+}
+
+// Сливает серии runs ленты tape (каждую - через свой участок) в dest
+void mergeRuns(Tape& tape, const std::vector<Run>& runs, ext_sort::TapeWriter& dest,
+               std::size_t block_elements, std::size_t section_buffer) {
+    std::vector<std::unique_ptr<Tape>> sections;
+    std::vector<ext_sort::TapeReader> readers;
+    sections.reserve(runs.size());
+    readers.reserve(runs.size());
+    LoserTree tree(runs.size());
+    for (std::size_t i = 0; i < runs.size(); ++i) {
+        sections.push_back(tape.OpenSection(runs[i].offset, runs[i].length, section_buffer));
+        readers.emplace_back(*sections.back(), block_elements);
+        readers[i].Start(runs[i].length);
+        if (!readers[i].Empty()) {
+            tree.Set(i, readers[i].Peek());
+        }
+    }
+    tree.Build();
+
+    while (!tree.Empty()) {
+        ext_sort::TapeReader& src = readers[tree.Winner()];
+        dest.Push(tree.Top());
+        src.Pop();
+        if (!src.Empty()) {
+            tree.Replace(src.Peek());
+        } else {
+            tree.Pop();
+        }
+    }
+}
+
+// Серии накопителя spool, записанные подряд. Сливает их по fan_in, пока их больше
+// fan_in, последний проход - в output
+void mergeSpool(
+    Tape& spool,
+    std::vector<Run> runs,
+    Tape& output,
+    std::size_t memory_limit_bytes,
+    std::size_t fan_in,
+    ext_sort::MergeStats& stats,
+    ext_sort::SortProfile* profile
+) {
+    // У прохода fan_in участков для чтения и одна лента для записи
+    std::size_t per_tape = memory_limit_bytes / (fan_in + 1);
+    std::size_t block_elements = ext_sort::StreamBlockElements(per_tape);
+    std::size_t tape_buffer = ext_sort::TapeBytesAfterBlock(per_tape);
+    std::size_t total = runs.back().offset + runs.back().length;
+
+    std::unique_ptr<Tape> current_holder;
+    Tape* current = &spool;
+    while (runs.size() > fan_in) {
+        ext_sort::ScopedPhase phase(profile, "merge_pass");
+        std::unique_ptr<Tape> next = spool.CreateTemporary(total, tape_buffer);
+        next->Reset();
+
+        std::vector<Run> merged;
+        {
+            ext_sort::TapeWriter dest(*next, block_elements);
+            for (std::size_t first = 0; first < runs.size(); first += fan_in) {
+                std::size_t last = std::min(first + fan_in, runs.size());
+                std::vector<Run> group(runs.begin() + static_cast<std::ptrdiff_t>(first),
+                                       runs.begin() + static_cast<std::ptrdiff_t>(last));
+                mergeRuns(*current, group, dest, block_elements, tape_buffer);
+
+                std::size_t offset = merged.empty() ? 0 : merged.back().offset + merged.back().length;
+                std::size_t length = group.back().offset + group.back().length - group.front().offset;
+                merged.push_back({offset, length});
+            }
+        }
+
+        stats.merged_elements += total;
+        ++stats.passes;
+        runs.swap(merged);
+        current_holder = std::move(next);
+        current = current_holder.get();
+    }
+
+    ext_sort::ScopedPhase phase(profile, "final_merge");
+    output.SetMemoryLimit(tape_buffer);
+    ext_sort::TapeWriter dest(output, block_elements);
+    mergeRuns(*current, runs, dest, block_elements, tape_buffer);
+    dest.Flush();
+    stats.merged_elements += total;
+    ++stats.passes;
+}
+
+} // namespace
+
+namespace ext_sort {
+
+MergeStats StreamMergeSort(
+    StreamInputTape& input,
+    Tape& output,
+    std::size_t memory_limit_bytes,
+    RunFormation formation,
+    std::size_t max_tapes,
+    const std::shared_ptr<TempTapePool>& pool,
+    const Delays& delays,
+    SortProfile* profile
+) {
+    if (memory_limit_bytes < sizeof(int32_t)) {
+        throw std::runtime_error("Memory limit too small for even one element");
+    }
+    if (formation == RunFormation::ReplacementSelection || formation == RunFormation::NaturalRuns) {
+        formation = RunFormation::Sort;
+    }
+
+    // Половина памяти - на чанк, остаток делят буферы входа и накопителя
+    std::size_t sort_buffer = std::max(memory_limit_bytes / 2, sizeof(int32_t));
+    std::size_t chunk_elements = RunChunkElements(sort_buffer / sizeof(int32_t), formation);
+    std::size_t stream_buffer = (memory_limit_bytes - sort_buffer) / 2;
+    input.SetMemoryLimit(stream_buffer);
+
+    MergeStats stats;
+    std::vector<int32_t> chunk;
+    readChunk(input, chunk, chunk_elements);
+
+    // Вход уместился в память: сортируем сразу в выходную ленту
+    if (input.Exhausted()) {
+        ScopedPhase phase(profile, "sort_in_memory");
+        SortChunk(chunk, formation);
+        output.SetMemoryLimit(stream_buffer);
+        TapeWriter dest(output, StreamBlockElements(stream_buffer));
+        for (int32_t value : chunk) {
+            dest.Push(value);
+        }
+        stats.runs = chunk.empty() ? 0 : 1;
+        return stats;
+    }
+
+    // Серии - подряд в накопитель; его длина известна только в конце входа
+    std::string spool_name = pool->UniqueName("stream_runs");
+    std::vector<Run> runs;
+    {
+        ScopedPhase phase(profile, "sort_chunks");
+        std::FILE* file = std::fopen(spool_name.c_str(), "wb");
+        if (!file) {
+            throw std::runtime_error("Cannot create tmp file: " + spool_name);
+        }
+        try {
+            StreamOutputTape writer(file, stream_buffer);
+            std::size_t offset = 0;
+            while (!chunk.empty()) {
+                SortChunk(chunk, formation);
+                writer.WriteBlock(chunk.data(), chunk.size());
+                runs.push_back({offset, chunk.size()});
+                offset += chunk.size();
+                readChunk(input, chunk, chunk_elements);
+            }
+            writer.Flush();
+            input.AddTemporaryMetrics(writer.Metrics());
+        } catch (...) {
+            std::fclose(file);
+            std::remove(spool_name.c_str());
+            throw;
+        }
+        std::fclose(file);
+    }
+    stats.runs = runs.size();
+    chunk = std::vector<int32_t>();
+
+    try {
+        FileTape spool(spool_name, delays);
+        spool.SetTemporaryPool(pool);
+        stats.fan_in = MergeFanIn(memory_limit_bytes, max_tapes, true, runs.size());
+        mergeSpool(spool, std::move(runs), output, memory_limit_bytes, stats.fan_in, stats, profile);
+
+        TapeMetrics temporary = spool.Metrics();
+        temporary += spool.TemporaryMetrics();
+        input.AddTemporaryMetrics(temporary);
+    } catch (...) {
+        std::remove(spool_name.c_str());
+        throw;
+    }
+    std::remove(spool_name.c_str());
+
+    return stats;
+}
+
+} // namespace ext_sort
@@ -0,0 +1,276 @@
+#include "stream_tape.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace {
+    constexpr std::size_t CELL_SIZE = sizeof(int32_t);
+
+    [[noreturn]] void unsupported(const char* what) {
+        throw std::runtime_error(std::string("Stream tape does not support ") + what);
+    }
+} // namespace
+
+StreamInputTape::StreamInputTape(std::FILE* stream, std::size_t memory_limit_bytes)
+    : stream_(stream)
+    , memory_limit_bytes_(memory_limit_bytes) {
+    if (!stream_) {
+        throw std::runtime_error("Input stream is not open");
+    }
+}
+
+int32_t StreamInputTape::Read() {
+    if (Exhausted()) {
+        throw std::runtime_error("Read past the end of the input stream");
+    }
+    ++metrics_.reads;
+    return buffer_[buffer_pos_];
+}
+
+void StreamInputTape::Write(int32_t /*value*/) {
+    unsupported("writing to the input stream");
+}
+
+std::size_t StreamInputTape::ReadBlock(int32_t* out, std::size_t n) {
+    std::size_t done = std::min(n, buffer_.size() - buffer_pos_);
+    std::copy_n(buffer_.begin() + static_cast<std::ptrdiff_t>(buffer_pos_), done, out);
+    buffer_pos_ += done;
+
+    if (done < n && !eof_) {
+        if (n - done >= bufferCells()) {
+            done += readStream(out + done, n - done);
+        } else {
+            fill();
+            std::size_t more = std::min(n - done, buffer_.size());
+            std::copy_n(buffer_.begin(), more, out + done);
+            buffer_pos_ = more;
+            done += more;
+        }
+    }
+
+    position_ += done;
+    metrics_.reads += done;
+    metrics_.shifts += done;
+    return done;
+}
+
+std::size_t StreamInputTape::ReadBlockBackward(int32_t* /*out*/, std::size_t /*n*/) {
+    unsupported("reading backward");
+}
+
+std::size_t StreamInputTape::WriteBlock(const int32_t* /*in*/, std::size_t /*n*/) {
+    unsupported("writing to the input stream");
+}
+
+bool StreamInputTape::Next() {
+    if (Exhausted()) {
+        return false;
+    }
+    ++buffer_pos_;
+    ++position_;
+    ++metrics_.shifts;
+    return true;
+}
+
+bool StreamInputTape::Prev() {
+    return false;
+}
+
+bool StreamInputTape::Rewind(std::ptrdiff_t offset) {
+    if (offset < 0) {
+        return false;
+    }
+    for (std::ptrdiff_t i = 0; i < offset; ++i) {
+        if (!Next()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void StreamInputTape::Reset() {
+    if (position_ != 0) {
+        unsupported("rewinding the input stream");
+    }
+}
+
+std::size_t StreamInputTape::Size() const {
+    return size_;
+}
+
+std::size_t StreamInputTape::Position() const {
+    return position_;
+}
+
+void StreamInputTape::SetMemoryLimit(std::size_t bytes) {
+    memory_limit_bytes_ = bytes;
+}
+
+std::unique_ptr<Tape> StreamInputTape::CreateTemporary(std::size_t /*size*/,
+                                                       std::size_t /*buffer_bytes*/) const {
+    unsupported("temporary tapes");
+}
+
+TapeMetrics StreamInputTape::Metrics() {
+    return metrics_;
+}
+
+TapeMetrics StreamInputTape::TemporaryMetrics() const {
+    return temporaries_->Total();
+}
+
+bool StreamInputTape::Exhausted() {
+    if (buffer_pos_ == buffer_.size() && !eof_) {
+        fill();
+    }
+    return buffer_pos_ == buffer_.size();
+}
+
+void StreamInputTape::AddTemporaryMetrics(const TapeMetrics& metrics) {
+    temporaries_->Add(metrics);
+}
+
+// fread дочитывает из pipe, пока не наберёт всё или поток не кончится
+std::size_t StreamInputTape::readStream(int32_t* out, std::size_t cells) {
+    std::size_t bytes = std::fread(out, 1, cells * CELL_SIZE, stream_);
+    ++metrics_.io_calls;
+    metrics_.bytes_read += bytes;
+    if (bytes < cells * CELL_SIZE) {
+        if (std::ferror(stream_)) {
+            throw std::runtime_error("Failed to read the input stream");
+        }
+        if (bytes % CELL_SIZE != 0) {
+            throw std::runtime_error("Input stream ends in the middle of a cell");
+        }
+        eof_ = true;
+    }
+    size_ += bytes / CELL_SIZE;
+    return bytes / CELL_SIZE;
+}
+
+void StreamInputTape::fill() {
+    buffer_.resize(bufferCells());
+    buffer_.resize(readStream(buffer_.data(), buffer_.size()));
+    buffer_pos_ = 0;
+    ++metrics_.buffer_misses;
+}
+
+std::size_t StreamInputTape::bufferCells() const {
+    return std::max<std::size_t>(memory_limit_bytes_ / CELL_SIZE, 1);
+}
+
+StreamOutputTape::StreamOutputTape(std::FILE* stream, std::size_t memory_limit_bytes)
+    : stream_(stream)
+    , memory_limit_bytes_(memory_limit_bytes) {
+    if (!stream_) {
+        throw std::runtime_error("Output stream is not open");
+    }
+}
+
+StreamOutputTape::~StreamOutputTape() {
+    try {
+        Flush();
+    } catch (...) {
+        // Ошибку записи видно по потоку; из деструктора не бросаем
+    }
+}
+
+int32_t StreamOutputTape::Read() {
+    unsupported("reading from the output stream");
+}
+
+void StreamOutputTape::Write(int32_t value) {
+    WriteBlock(&value, 1);
+}
+
+std::size_t StreamOutputTape::ReadBlock(int32_t* /*out*/, std::size_t /*n*/) {
+    unsupported("reading from the output stream");
+}
+
+std::size_t StreamOutputTape::ReadBlockBackward(int32_t* /*out*/, std::size_t /*n*/) {
+    unsupported("reading from the output stream");
+}
+
+std::size_t StreamOutputTape::WriteBlock(const int32_t* in, std::size_t n) {
+    if (buffer_.size() + n > bufferCells()) {
+        writeStream(buffer_.data(), buffer_.size());
+        buffer_.clear();
+    }
+    if (n >= bufferCells()) {
+        writeStream(in, n);
+    } else {
+        buffer_.insert(buffer_.end(), in, in + n);
+    }
+
+    position_ += n;
+    metrics_.writes += n;
+    metrics_.shifts += n;
+    return n;
+}
+
+bool StreamOutputTape::Next() {
+    return false;
+}
+
+bool StreamOutputTape::Prev() {
+    return false;
+}
+
+bool StreamOutputTape::Rewind(std::ptrdiff_t offset) {
+    return offset == 0;
+}
+
+void StreamOutputTape::Reset() {
+    if (position_ != 0) {
+        unsupported("rewinding the output stream");
+    }
+}
+
+std::size_t StreamOutputTape::Size() const {
+    return position_;
+}
+
+std::size_t StreamOutputTape::Position() const {
+    return position_;
+}
+
+void StreamOutputTape::SetMemoryLimit(std::size_t bytes) {
+    if (bytes / CELL_SIZE < buffer_.size()) {
+        writeStream(buffer_.data(), buffer_.size());
+        buffer_.clear();
+    }
+    memory_limit_bytes_ = bytes;
+}
+
+std::unique_ptr<Tape> StreamOutputTape::CreateTemporary(std::size_t /*size*/,
+                                                        std::size_t /*buffer_bytes*/) const {
+    unsupported("temporary tapes");
+}
+
+TapeMetrics StreamOutputTape::Metrics() {
+    return metrics_;
+}
+
+void StreamOutputTape::Flush() {
+    writeStream(buffer_.data(), buffer_.size());
+    buffer_.clear();
+    if (std::fflush(stream_) != 0) {
+        throw std::runtime_error("Failed to flush the output stream");
+    }
+}
+
+void StreamOutputTape::writeStream(const int32_t* in, std::size_t cells) {
+    if (cells == 0) {
+        return;
+    }
+    if (std::fwrite(in, CELL_SIZE, cells, stream_) != cells) {
+        throw std::runtime_error("Failed to write the output stream");
+    }
+    ++metrics_.io_calls;
+    metrics_.bytes_written += cells * CELL_SIZE;
+}
+
+std::size_t StreamOutputTape::bufferCells() const {
+    return std::max<std::size_t>(memory_limit_bytes_ / CELL_SIZE, 1);
+}
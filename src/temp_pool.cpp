@@ -0,0 +1,140 @@
+#include "temp_pool.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+
+#include <filesystem>
+#include <stdexcept>
+
+namespace {
+    // Размеры файлов кратны 8 байтам: в файле целое число ячеек любой ленты
+    std::size_t roundUp(std::size_t bytes) {
+        return (bytes + 7) / 8 * 8;
+    }
+} // namespace
+
+TempTapePool::TempTapePool(const std::string& directory,
+                           std::size_t preallocate_files,
+                           std::size_t preallocate_bytes)
+    : directory_(directory) {
+    preallocate_bytes = roundUp(preallocate_bytes);
+    std::error_code ec;
+    std::filesystem::create_directories(directory_, ec);
+    if (ec) {
+        throw std::runtime_error("Cannot create temporary directory " + directory_ + ": " + ec.message());
+    }
+
+    for (std::size_t i = 0; i < preallocate_files; ++i) {
+        std::string path = nextName("pool");
+        allocate(path, preallocate_bytes, true);
+        files_.push_back({path, preallocate_bytes, false});
+    }
+}
+
+TempTapePool::~TempTapePool() {
+    for (const File& file : files_) {
+        std::remove(file.path.c_str());
+    }
+}
+
+std::string TempTapePool::Acquire(std::size_t bytes) {
+    bytes = roundUp(bytes);
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    File* best = nullptr;
+    File* largest = nullptr;
+    for (File& file : files_) {
+        if (file.busy) {
+            continue;
+        }
+        if (file.bytes >= bytes && (!best || file.bytes < best->bytes)) {
+            best = &file;
+        }
+        if (!largest || file.bytes > largest->bytes) {
+            largest = &file;
+        }
+    }
+
+    if (best) {
+        ++reused_;
+    } else if (largest) {
+        allocate(largest->path, bytes, false);
+        largest->bytes = bytes;
+        best = largest;
+    } else {
+        std::string path = nextName("pool");
+        allocate(path, bytes, false);
+        files_.push_back({path, bytes, false});
+        best = &files_.back();
+    }
+
+    best->busy = true;
+    return best->path;
+}
+
+void TempTapePool::Release(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (File& file : files_) {
+        if (file.path == path) {
+            file.busy = false;
+            return;
+        }
+    }
+    throw std::runtime_error("File does not belong to the temporary pool: " + path);
+}
+
+std::string TempTapePool::UniqueName(const std::string& prefix) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return nextName(prefix);
+}
+
+const std::string& TempTapePool::Directory() const {
+    return directory_;
+}
+
+std::size_t TempTapePool::Files() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return files_.size();
+}
+
+std::size_t TempTapePool::DiskBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::size_t total = 0;
+    for (const File& file : files_) {
+        total += file.bytes;
+    }
+    return total;
+}
+
+std::size_t TempTapePool::Reused() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return reused_;
+}
+
+// Имя уникально и между процессами, которые делят каталог
+std::string TempTapePool::nextName(const std::string& prefix) {
+    return directory_ + "/" + prefix + "_" + std::to_string(::getpid()) + "_" +
+           std::to_string(++counter_) + ".bin";
+}
+
+// Файл длиной bytes. reserve => место выделено на диске сразу, а не при записи;
+// иначе (и на файловых системах без fallocate) - файл с дырой, как при fseek + fputc:
+// алгоритмы заказывают временные ленты с запасом (на весь вход), а диск занимают
+// только записанные ячейки
+void TempTapePool::allocate(const std::string& path, std::size_t bytes, bool reserve) {
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot create tmp file: " + path);
+    }
+    int error = reserve && bytes > 0 ? ::posix_fallocate(fd, 0, static_cast<off_t>(bytes)) : EOPNOTSUPP;
+    if (error == EINVAL || error == EOPNOTSUPP) {
+        error = ::ftruncate(fd, static_cast<off_t>(bytes)) == 0 ? 0 : errno;
+    }
+    ::close(fd);
+    if (error != 0) {
+        throw std::runtime_error("Cannot allocate tmp file: " + path);
+    }
+}
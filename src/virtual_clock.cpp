@@ -0,0 +1,24 @@
+#include "virtual_clock.hpp"
+
+#include <algorithm>
+
+namespace {
+    thread_local std::size_t now_ms = 0;
+} // namespace
+
+std::size_t VirtualClock::Now() {
+    return now_ms;
+}
+
+void VirtualClock::Set(std::size_t ms) {
+    now_ms = ms;
+}
+
+void VirtualClock::AdvanceTo(std::size_t ms) {
+    now_ms = std::max(now_ms, ms);
+}
+
+void VirtualClock::Occupy(std::size_t& busy_until, std::size_t ms) {
+    now_ms = std::max(now_ms, busy_until) + ms;
+    busy_until = now_ms;
+}
@@ -30,6 +30,24 @@ static std::vector<int32_t> ReadIntFile(const std::string& filename) {
   return data;
 }
 
+// Файл из записей фиксированной ширины (как их пишет RecordFileTape)
+template <typename Record>
+static void WriteRecordFile(const std::string& filename, const std::vector<Record>& data) {
+  std::ofstream ofs(filename, std::ios::binary);
+  ofs.write(reinterpret_cast<const char*>(data.data()), data.size() * sizeof(Record));
+}
+
+template <typename Record>
+static std::vector<Record> ReadRecordFile(const std::string& filename) {
+  std::ifstream ifs(filename, std::ios::binary);
+  std::vector<Record> data;
+  Record v;
+  while (ifs.read(reinterpret_cast<char*>(&v), sizeof(v))) {
+      data.push_back(v);
+  }
+  return data;
+}
+
 static std::vector<int32_t> RandomVector(std::size_t n,
                                          int32_t min_value, int32_t max_value) {
   std::mt19937 gen(2025);
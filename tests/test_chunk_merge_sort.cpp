@@ -1,10 +1,13 @@
 #include "external_sort.hpp"
+#include "file_tape.hpp"
 
 #include "vector_tape.hpp"
 #include "helpers.hpp"
 
 #include <vector>
 #include <algorithm>
+#include <filesystem>
+#include <numeric>
 #include <random>
 
 #include <gtest/gtest.h>
@@ -64,10 +67,229 @@ TEST(ChunkMergeSortTest, RandomLarge) {
     }
 }
 
+TEST(ChunkMergeSortTest, ReplacementSelection) {
+    std::vector<int32_t> input = RandomVector(10000, -1000, 1000);
+
+    std::vector<int32_t> expected = input;
+    std::sort(expected.begin(), expected.end());
+
+    for (size_t memory_limit : {8, 64, 512, 8192}) {
+        VectorTape in_t(input);
+        VectorTape out_t(std::vector<int32_t>(10000, 0));
+        ext_sort::ChunkMergeSort(in_t, out_t, memory_limit, ext_sort::RunFormation::ReplacementSelection);
+        EXPECT_EQ(TapeToVector(out_t), expected);
+    }
+
+    // Почти упорядоченный вход - одна серия
+    VectorTape in_t(expected);
+    VectorTape out_t(std::vector<int32_t>(10000, 0));
+    ext_sort::ChunkMergeSort(in_t, out_t, 64, ext_sort::RunFormation::ReplacementSelection);
+    EXPECT_EQ(TapeToVector(out_t), expected);
+}
+
+TEST(ChunkMergeSortTest, ParallelRunsMatchSingleThreaded) {
+    std::vector<int32_t> input = RandomVector(20000, -1000, 1000);
+
+    VectorTape single_in(input);
+    VectorTape single_out(std::vector<int32_t>(input.size(), 0));
+    ext_sort::ChunkMergeSort(single_in, single_out, 4096, ext_sort::RunFormation::Sort);
+    auto expected = TapeToVector(single_out);
+
+    for (auto formation : {ext_sort::RunFormation::Sort, ext_sort::RunFormation::HeapSort,
+                           ext_sort::RunFormation::RadixSort}) {
+        for (std::size_t threads : {2, 8}) {
+            for (std::size_t memory_limit : {400, 4096}) {
+                VectorTape in_t(input);
+                VectorTape out_t(std::vector<int32_t>(input.size(), 0));
+                ext_sort::ChunkMergeSort(in_t, out_t, memory_limit, formation, threads);
+                EXPECT_EQ(TapeToVector(out_t), expected);
+            }
+        }
+    }
+}
+
+// Проходы слияния делятся между потоками через участки файловых лент
+TEST(ChunkMergeSortTest, ParallelMergeFileTapes) {
+    std::filesystem::create_directory("tmp");
+    std::vector<int32_t> input = RandomVector(30000, -50, 50);
+    std::vector<int32_t> expected = input;
+    std::sort(expected.begin(), expected.end());
+
+    for (std::size_t threads : {2, 3, 16}) {
+        WriteIntFile("test_parallel_merge_in.bin", input);
+        WriteIntFile("test_parallel_merge_out.bin", std::vector<int32_t>(input.size(), 0));
+        {
+            FileTape in_t("test_parallel_merge_in.bin", Delays{0,0,0,0});
+            FileTape out_t("test_parallel_merge_out.bin", Delays{0,0,0,0});
+            ext_sort::ChunkMergeSort(in_t, out_t, 2048, ext_sort::RunFormation::Sort, threads);
+        }
+        EXPECT_EQ(ReadIntFile("test_parallel_merge_out.bin"), expected);
+    }
+}
+
+TEST(ChunkMergeSortTest, Alternating) {
+    std::vector<int32_t> input = RandomVector(10000, -1000, 1000);
+    std::vector<int32_t> expected = input;
+    std::sort(expected.begin(), expected.end());
+
+    // Разное число серий: проходов слияния и чётное, и нечётное
+    for (auto formation : {ext_sort::RunFormation::Sort, ext_sort::RunFormation::ReplacementSelection}) {
+        for (std::size_t memory_limit : {8, 64, 200, 512, 8192, 65536}) {
+            VectorTape in_t(input);
+            VectorTape out_t(std::vector<int32_t>(input.size(), 0));
+            ext_sort::AlternatingMergeSort(in_t, out_t, memory_limit, formation, 2);
+            EXPECT_EQ(TapeToVector(out_t), expected);
+        }
+    }
+
+    VectorTape empty_in(std::vector<int32_t>{});
+    VectorTape empty_out(std::vector<int32_t>{});
+    ext_sort::AlternatingMergeSort(empty_in, empty_out, 64, ext_sort::RunFormation::Sort);
+    EXPECT_TRUE(TapeToVector(empty_out).empty());
+}
+
+// Между проходами временные ленты не перематываются
+TEST(ChunkMergeSortTest, AlternatingSkipsRewinds) {
+    std::filesystem::create_directory("tmp");
+    std::vector<int32_t> input = RandomVector(5000, -1000, 1000);
+    std::vector<int32_t> expected = input;
+    std::sort(expected.begin(), expected.end());
+
+    TapeMetrics temporary[2];
+    for (bool alternate : {false, true}) {
+        WriteIntFile("test_alternating_in.bin", input);
+        WriteIntFile("test_alternating_out.bin", std::vector<int32_t>(input.size(), 0));
+        {
+            FileTape in_t("test_alternating_in.bin", Delays{0,0,0,0});
+            FileTape out_t("test_alternating_out.bin", Delays{0,0,0,0});
+            if (alternate) {
+                ext_sort::AlternatingMergeSort(in_t, out_t, 1024, ext_sort::RunFormation::Sort);
+            } else {
+                ext_sort::ChunkMergeSort(in_t, out_t, 1024, ext_sort::RunFormation::Sort);
+            }
+            temporary[alternate] = in_t.TemporaryMetrics();
+        }
+        EXPECT_EQ(ReadIntFile("test_alternating_out.bin"), expected);
+    }
+
+    // 128 элементов в чанке => 40 серий и 6 проходов: 5 по 4 перемотки,
+    // последний перематывает только две ленты, из которых читает
+    EXPECT_GE(temporary[false].rewinds, 22u);
+    EXPECT_LE(temporary[true].rewinds, 1u);
+    EXPECT_EQ(temporary[true].reads, temporary[false].reads);
+}
+
+// Последний проход слияния пишет сразу в выходную ленту, а вход, который
+// помещается в память, вообще не попадает на временные ленты
+TEST(ChunkMergeSortTest, WritesStraightToOutput) {
+    std::filesystem::create_directory("tmp");
+    std::vector<int32_t> input = RandomVector(5000, -1000, 1000);
+    std::vector<int32_t> expected = input;
+    std::sort(expected.begin(), expected.end());
+
+    // 1024 байта - 40 серий и 6 проходов, 16 КиБ - 3 серии и 2 прохода, 64 КиБ - одна сортировка.
+    // В два потока чанки вдвое короче: 79 серий и 7 проходов, 5 серий и 3 прохода
+    const std::size_t cases[][3] = {{1024, 6, 7}, {16384, 2, 3}, {65536, 0, 0}};
+    for (const auto& [memory_limit, sequential_merges, parallel_merges] : cases) {
+        for (int mode = 0; mode < 3; ++mode) {
+            std::size_t merges = mode == 1 ? parallel_merges : sequential_merges;
+            WriteIntFile("test_direct_in.bin", input);
+            WriteIntFile("test_direct_out.bin", std::vector<int32_t>(input.size(), 0));
+            TapeMetrics temporary;
+            TapeMetrics output;
+            {
+                FileTape in_t("test_direct_in.bin", Delays{0,0,0,0});
+                FileTape out_t("test_direct_out.bin", Delays{0,0,0,0});
+                if (mode == 2) {
+                    ext_sort::AlternatingMergeSort(in_t, out_t, memory_limit, ext_sort::RunFormation::Sort);
+                } else {
+                    ext_sort::ChunkMergeSort(in_t, out_t, memory_limit, ext_sort::RunFormation::Sort,
+                                             mode == 0 ? 1 : 2);
+                }
+                temporary = in_t.TemporaryMetrics();
+                output = out_t.Metrics();
+            }
+            EXPECT_EQ(ReadIntFile("test_direct_out.bin"), expected) << memory_limit << " " << mode;
+            // Формирование серий и все проходы слияния, кроме последнего
+            EXPECT_EQ(temporary.writes, input.size() * merges) << memory_limit << " " << mode;
+            EXPECT_EQ(output.writes, input.size()) << memory_limit << " " << mode;
+        }
+    }
+}
+
 // Недостаточно памяти (меньше sizeof(int32_t))
 TEST(ChunkMergeSortTest, MemoryTooSmall) {
     std::vector<int32_t> input = {1,2,3};
     VectorTape in_t(input);
     VectorTape out_t(std::vector<int32_t>(input.size(), 0));
     EXPECT_THROW(ext_sort::ChunkMergeSort(in_t, out_t, /*memory_limit_bytes=*/3, false), std::runtime_error);
-}
\ No newline at end of file
+}
+
+// Упорядоченный в любую сторону вход копируется без временных лент,
+// остальной - сортируется естественными сериями
+TEST(ChunkMergeSortTest, NaturalRunsSkipMerging) {
+    std::filesystem::create_directory("tmp");
+    std::vector<int32_t> ascending(5000);
+    std::iota(ascending.begin(), ascending.end(), 0);
+    std::vector<int32_t> descending(ascending.rbegin(), ascending.rend());
+    std::vector<int32_t> random = RandomVector(5000, -1000, 1000);
+
+    for (bool alternate : {false, true}) {
+        for (const std::vector<int32_t>* input_ptr : {&ascending, &descending, &random}) {
+            const std::vector<int32_t>& input = *input_ptr;
+            WriteIntFile("test_natural_in.bin", input);
+            WriteIntFile("test_natural_out.bin", std::vector<int32_t>(input.size(), 0));
+            TapeMetrics temporary;
+            {
+                FileTape in_t("test_natural_in.bin", Delays{0,0,0,0});
+                FileTape out_t("test_natural_out.bin", Delays{0,0,0,0});
+                if (alternate) {
+                    ext_sort::AlternatingMergeSort(in_t, out_t, 1024, ext_sort::RunFormation::NaturalRuns);
+                } else {
+                    ext_sort::ChunkMergeSort(in_t, out_t, 1024, ext_sort::RunFormation::NaturalRuns);
+                }
+                temporary = in_t.TemporaryMetrics();
+            }
+            std::vector<int32_t> expected = input;
+            std::sort(expected.begin(), expected.end());
+            EXPECT_EQ(ReadIntFile("test_natural_out.bin"), expected);
+            if (&input != &random) {
+                EXPECT_EQ(temporary.writes, 0u);
+            } else {
+                EXPECT_GT(temporary.writes, 0u);
+            }
+        }
+    }
+}
+
+// Журнал с поздним нарушением порядка: проверка упорядоченности только читает вход,
+// в выход пишет одно слияние
+TEST(ChunkMergeSortTest, NaturalRunsLateInversion) {
+    std::filesystem::create_directory("tmp");
+    std::vector<int32_t> input(20000);
+    std::iota(input.begin(), input.end(), 0);
+    std::swap(input[19990], input[19991]);
+
+    for (bool alternate : {false, true}) {
+        WriteIntFile("test_natural_in.bin", input);
+        WriteIntFile("test_natural_out.bin", std::vector<int32_t>(input.size(), 0));
+        TapeMetrics in_metrics;
+        TapeMetrics out_metrics;
+        {
+            FileTape in_t("test_natural_in.bin", Delays{0,0,0,0});
+            FileTape out_t("test_natural_out.bin", Delays{0,0,0,0});
+            if (alternate) {
+                ext_sort::AlternatingMergeSort(in_t, out_t, 1024, ext_sort::RunFormation::NaturalRuns);
+            } else {
+                ext_sort::ChunkMergeSort(in_t, out_t, 1024, ext_sort::RunFormation::NaturalRuns);
+            }
+            in_metrics = in_t.Metrics();
+            out_metrics = out_t.Metrics();
+        }
+        std::vector<int32_t> expected = input;
+        std::sort(expected.begin(), expected.end());
+        EXPECT_EQ(ReadIntFile("test_natural_out.bin"), expected);
+        EXPECT_EQ(out_metrics.writes, input.size()) << alternate;
+        EXPECT_LE(in_metrics.reads, 2 * input.size()) << alternate;
+    }
+}
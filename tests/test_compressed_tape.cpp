@@ -0,0 +1,193 @@
+#include "compressed_tape.hpp"
+#include "external_sort.hpp"
+#include "file_tape.hpp"
+
+#include "helpers.hpp"
+
+#include <cstdint>
+
+#include <algorithm>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+
+namespace {
+    const Delays NO_DELAYS{0, 0, 0, 0};
+
+    std::unique_ptr<CompressedTape> makeTape(std::size_t size, std::size_t buffer_bytes) {
+        std::filesystem::create_directory("tmp");
+        return std::make_unique<CompressedTape>("tmp/test_compressed.bin", size, NO_DELAYS, buffer_bytes,
+                                                std::make_shared<MetricsSink>());
+    }
+} // namespace
+
+// Блоки любых значений (с переполнением разностей) читаются так же, как записаны
+TEST(CompressedTapeTest, RoundTrip) {
+    std::vector<int32_t> data = RandomVector(5000, std::numeric_limits<int32_t>::min(),
+                                             std::numeric_limits<int32_t>::max());
+    data[10] = std::numeric_limits<int32_t>::max();
+    data[11] = std::numeric_limits<int32_t>::min();
+
+    auto tape = makeTape(data.size(), 256);
+    EXPECT_EQ(tape->WriteBlock(data.data(), data.size()), data.size());
+    EXPECT_EQ(tape->Position(), data.size() - 1);
+
+    tape->Reset();
+    std::vector<int32_t> read(data.size());
+    EXPECT_EQ(tape->ReadBlock(read.data(), read.size()), data.size());
+    EXPECT_EQ(read, data);
+
+    // Назад от последней ячейки
+    std::vector<int32_t> backward(data.size());
+    EXPECT_EQ(tape->ReadBlockBackward(backward.data(), backward.size()), data.size());
+    EXPECT_EQ(tape->Position(), 0u);
+    std::reverse(backward.begin(), backward.end());
+    EXPECT_EQ(backward, data);
+}
+
+// Запись с середины блока не портит остальные ячейки, незаписанные ячейки - нули
+TEST(CompressedTapeTest, PartialBlocks) {
+    auto tape = makeTape(3000, 64); // блоки по MIN_BLOCK_CELLS = 1024 ячейки
+    std::vector<int32_t> ones(40, 1);
+    tape->Rewind(1010);
+    tape->WriteBlock(ones.data(), ones.size()); // через границу блоков, головка - на 1050
+
+    tape->Rewind(-30);
+    tape->Write(7);
+    tape->Rewind(1030);
+    tape->Write(-5);
+    tape->Next();
+    tape->Write(6);
+
+    std::vector<int32_t> expected(3000, 0);
+    std::fill(expected.begin() + 1010, expected.begin() + 1050, 1);
+    expected[1020] = 7;
+    expected[2050] = -5;
+    expected[2051] = 6;
+
+    tape->Reset();
+    EXPECT_EQ(TapeToVector(*tape), expected);
+
+    // Сброс буфера лимитом памяти и чтение с носителя
+    tape->SetMemoryLimit(0);
+    tape->Reset();
+    EXPECT_EQ(TapeToVector(*tape), expected);
+}
+
+// Маленький буфер не делает блоки короче MIN_BLOCK_CELLS: поэлементная запись
+// сбрасывается на носитель блоками, а не по ячейке
+TEST(CompressedTapeTest, TinyBufferKeepsBlocks) {
+    auto tape = makeTape(3 * CompressedTape::MIN_BLOCK_CELLS, 0);
+    for (std::size_t i = 0; i < tape->Size(); ++i) {
+        tape->Write(static_cast<int32_t>(i));
+        tape->Next();
+    }
+    tape->SetMemoryLimit(0);
+    EXPECT_EQ(tape->Metrics().io_calls, 3u);
+    EXPECT_LT(tape->StoredBytes(), tape->Size() * sizeof(int32_t) / 2);
+
+    tape->Reset();
+    std::vector<int32_t> read(tape->Size());
+    tape->ReadBlock(read.data(), read.size());
+    EXPECT_EQ(read[2500], 2500);
+    EXPECT_EQ(tape->Metrics().io_calls, 6u);
+}
+
+// Отсортированная серия занимает в несколько раз меньше, чем int32 подряд,
+// а повторная запись встаёт на те же места файла
+TEST(CompressedTapeTest, SortedRunsCompress) {
+    std::vector<int32_t> data = RandomVector(100000, -1000000, 1000000);
+    std::sort(data.begin(), data.end());
+
+    auto tape = makeTape(data.size(), 16 * 1024);
+    for (int pass = 0; pass < 3; ++pass) {
+        tape->Reset();
+        tape->WriteBlock(data.data(), data.size());
+    }
+    tape->SetMemoryLimit(0);
+
+    std::size_t raw = data.size() * sizeof(int32_t);
+    EXPECT_LT(tape->StoredBytes(), raw / 2);
+    EXPECT_LT(tape->Metrics().bytes_written, 3 * raw / 2);
+
+    tape->Reset();
+    std::vector<int32_t> read(data.size());
+    tape->ReadBlock(read.data(), read.size());
+    EXPECT_EQ(read, data);
+    EXPECT_LT(tape->Metrics().bytes_read, raw / 2);
+}
+
+// Сортировки через FileTape со сжатыми временными лентами: тот же результат,
+// меньше байт на временных лентах
+TEST(CompressedTapeTest, SortsWithCompressedTemporaries) {
+    std::filesystem::create_directory("tmp");
+    std::vector<int32_t> input = RandomVector(20000, -2000, 2000);
+    std::vector<int32_t> expected = input;
+    std::sort(expected.begin(), expected.end());
+
+    for (int algorithm = 0; algorithm < 4; ++algorithm) {
+        std::size_t written[2] = {0, 0};
+        for (bool compress : {false, true}) {
+            WriteIntFile("test_compressed_in.bin", input);
+            WriteIntFile("test_compressed_out.bin", std::vector<int32_t>(input.size(), 0));
+            {
+                FileTape in_t("test_compressed_in.bin", NO_DELAYS, 0, false, compress);
+                FileTape out_t("test_compressed_out.bin", NO_DELAYS);
+                switch (algorithm) {
+                case 0:
+                    ext_sort::ChunkMergeSort(in_t, out_t, 4096, ext_sort::RunFormation::Sort);
+                    break;
+                case 1:
+                    ext_sort::AlternatingMergeSort(in_t, out_t, 4096, ext_sort::RunFormation::Sort);
+                    break;
+                case 2:
+                    ext_sort::KWayMergeSort(in_t, out_t, 4096, ext_sort::RunFormation::ReplacementSelection,
+                                            8, false);
+                    break;
+                case 3:
+                    ext_sort::CountingSort(in_t, out_t, 4096);
+                    break;
+                }
+                written[compress] = in_t.TemporaryMetrics().bytes_written;
+            }
+            EXPECT_EQ(ReadIntFile("test_compressed_out.bin"), expected) << algorithm << " " << compress;
+        }
+        EXPECT_GT(written[false], 0u) << algorithm;
+        EXPECT_LT(written[true], written[false]) << algorithm;
+    }
+}
+
+// Разделы CountingSort и корзины DistributionSort - GrowingTape из сжатых сегментов:
+// сегменты пишутся блоками, вызовов ввода-вывода не больше, чем без сжатия
+TEST(CompressedTapeTest, GrowingTemporariesWriteBlocks) {
+    std::filesystem::create_directory("tmp");
+    std::vector<int32_t> input = RandomVector(200000, std::numeric_limits<int32_t>::min(),
+                                              std::numeric_limits<int32_t>::max());
+    std::vector<int32_t> expected = input;
+    std::sort(expected.begin(), expected.end());
+
+    for (int algorithm = 0; algorithm < 2; ++algorithm) {
+        std::size_t io_calls[2] = {0, 0};
+        for (bool compress : {false, true}) {
+            WriteIntFile("test_compressed_in.bin", input);
+            WriteIntFile("test_compressed_out.bin", std::vector<int32_t>(input.size(), 0));
+            {
+                FileTape in_t("test_compressed_in.bin", NO_DELAYS, 0, false, compress);
+                FileTape out_t("test_compressed_out.bin", NO_DELAYS);
+                if (algorithm == 0) {
+                    ext_sort::CountingSort(in_t, out_t, 64 * 1024);
+                } else {
+                    ext_sort::DistributionSort(in_t, out_t, 64 * 1024, ext_sort::RunFormation::Sort);
+                }
+                io_calls[compress] = in_t.TemporaryMetrics().io_calls;
+            }
+            EXPECT_EQ(ReadIntFile("test_compressed_out.bin"), expected) << algorithm << " " << compress;
+        }
+        EXPECT_GT(io_calls[false], 0u) << algorithm;
+        EXPECT_LE(io_calls[true], io_calls[false]) << algorithm;
+    }
+}
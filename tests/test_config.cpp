@@ -17,8 +17,13 @@ TEST(ConfigTest, ValidFullConfig) {
           write_ms: 20
           shift_ms: 30
           rewind_ms: 40
+          virtual_time: true
         memory_limit_bytes: 12345
         strict_stack_limit: true
+        radix_sort: true
+        replacement_selection: true
+        metrics_file: run_metrics.json
+        auto_plan: true
         value_range: [ -5, 15 ]
     )";
     WriteYaml(fname, yaml);
@@ -28,8 +33,13 @@ TEST(ConfigTest, ValidFullConfig) {
     EXPECT_EQ(cfg.delays.write_ms, 20u);
     EXPECT_EQ(cfg.delays.shift_ms, 30u);
     EXPECT_EQ(cfg.delays.rewind_ms, 40u);
+    EXPECT_TRUE(cfg.delays.virtual_time);
     EXPECT_EQ(cfg.memory_limit_bytes, 12345u);
     EXPECT_TRUE(cfg.strict_stack_limit);
+    EXPECT_TRUE(cfg.radix_sort);
+    EXPECT_TRUE(cfg.replacement_selection);
+    EXPECT_EQ(cfg.metrics_file, "run_metrics.json");
+    EXPECT_TRUE(cfg.auto_plan);
     ASSERT_TRUE(cfg.value_min.has_value());
     ASSERT_TRUE(cfg.value_max.has_value());
     EXPECT_EQ(cfg.value_min.value(), -5);
@@ -54,8 +64,11 @@ TEST(ConfigTest, ValidNoRange) {
     EXPECT_EQ(cfg.delays.write_ms, 2u);
     EXPECT_EQ(cfg.delays.shift_ms, 3u);
     EXPECT_EQ(cfg.delays.rewind_ms, 4u);
+    EXPECT_FALSE(cfg.delays.virtual_time);
     EXPECT_EQ(cfg.memory_limit_bytes, 1000u);
     EXPECT_FALSE(cfg.strict_stack_limit);
+    EXPECT_TRUE(cfg.metrics_file.empty());
+    EXPECT_FALSE(cfg.auto_plan);
     EXPECT_FALSE(cfg.value_min.has_value());
     EXPECT_FALSE(cfg.value_max.has_value());
 }
@@ -95,3 +108,74 @@ TEST(ConfigTest, InvalidValueRangeSize) {
 TEST(ConfigTest, NonexistentFile) {
     EXPECT_THROW(Config::Load("nonexistent.yaml"), std::exception);
 }
+
+TEST(ConfigTest, MergeMode) {
+    const std::string fname = "test_merge_mode.yaml";
+    std::string yaml = R"(
+        delays:
+          read_ms: 0
+          write_ms: 0
+          shift_ms: 0
+          rewind_ms: 0
+        memory_limit_bytes: 500
+        strict_stack_limit: false
+    )";
+    WriteYaml(fname, yaml);
+    Config cfg = Config::Load(fname);
+    EXPECT_EQ(cfg.merge_mode, MergeMode::Binary);
+    EXPECT_EQ(cfg.max_tapes, 16u);
+    EXPECT_FALSE(cfg.replacement_selection);
+    EXPECT_FALSE(cfg.natural_runs);
+    EXPECT_FALSE(cfg.radix_sort);
+    EXPECT_FALSE(cfg.async_io);
+    EXPECT_FALSE(cfg.compress_temporaries);
+    EXPECT_EQ(cfg.threads, 1u);
+
+    WriteYaml(fname, yaml + "    merge_mode: polyphase\n        max_tapes: 5\n");
+    cfg = Config::Load(fname);
+    EXPECT_EQ(cfg.merge_mode, MergeMode::Polyphase);
+    EXPECT_EQ(cfg.max_tapes, 5u);
+
+    WriteYaml(fname, yaml + "    natural_runs: true\n");
+    EXPECT_TRUE(Config::Load(fname).natural_runs);
+    WriteYaml(fname, yaml + "    compress_temporaries: true\n");
+    EXPECT_TRUE(Config::Load(fname).compress_temporaries);
+
+    EXPECT_EQ(cfg.temp_dir, "tmp");
+    EXPECT_EQ(cfg.temp_preallocate, 0u);
+    WriteYaml(fname, yaml + "    temp_dir: /mnt/nvme/sort\n        temp_preallocate: 4\n");
+    EXPECT_EQ(Config::Load(fname).temp_dir, "/mnt/nvme/sort");
+    EXPECT_EQ(Config::Load(fname).temp_preallocate, 4u);
+
+    WriteYaml(fname, yaml + "    merge_mode: alternating\n");
+    EXPECT_EQ(Config::Load(fname).merge_mode, MergeMode::Alternating);
+    WriteYaml(fname, yaml + "    merge_mode: distribution\n");
+    EXPECT_EQ(Config::Load(fname).merge_mode, MergeMode::Distribution);
+
+    EXPECT_EQ(cfg.record_format, RecordFormat::Int32);
+    EXPECT_FALSE(cfg.stable);
+    EXPECT_TRUE(cfg.index_file.empty());
+    WriteYaml(fname, yaml + "    stable: true\n        index_file: idx.bin\n");
+    EXPECT_TRUE(Config::Load(fname).stable);
+    EXPECT_EQ(Config::Load(fname).index_file, "idx.bin");
+    EXPECT_EQ(cfg.top_k, 0u);
+    EXPECT_FALSE(cfg.top_k_largest);
+    WriteYaml(fname, yaml + "    top_k: 100\n        top_k_largest: true\n");
+    EXPECT_EQ(Config::Load(fname).top_k, 100u);
+    EXPECT_TRUE(Config::Load(fname).top_k_largest);
+    EXPECT_TRUE(cfg.quantiles.empty());
+    WriteYaml(fname, yaml + "    quantiles: [0.5, 0.99]\n");
+    EXPECT_EQ(Config::Load(fname).quantiles, (std::vector<double>{0.5, 0.99}));
+    EXPECT_FALSE(cfg.distinct);
+    EXPECT_TRUE(cfg.counts_file.empty());
+    WriteYaml(fname, yaml + "    distinct: true\n        counts_file: counts.bin\n");
+    EXPECT_TRUE(Config::Load(fname).distinct);
+    EXPECT_EQ(Config::Load(fname).counts_file, "counts.bin");
+    WriteYaml(fname, yaml + "    record_format: kv64\n");
+    EXPECT_EQ(Config::Load(fname).record_format, RecordFormat::KeyValue64);
+    WriteYaml(fname, yaml + "    record_format: int128\n");
+    EXPECT_THROW(Config::Load(fname), std::exception);
+
+    WriteYaml(fname, yaml + "    merge_mode: bubble\n");
+    EXPECT_THROW(Config::Load(fname), std::exception);
+}
@@ -1,4 +1,5 @@
 #include "external_sort.hpp"
+#include "record_tape.hpp"
 #include "tape.hpp"
 
 #include "helpers.hpp"
@@ -7,6 +8,9 @@
 #include <cstdint>
 
 #include <algorithm>
+#include <limits>
+#include <map>
+#include <memory>
 #include <numeric>
 #include <random>
 #include <vector>
@@ -95,3 +99,196 @@ TEST(CountingSortTest, RandomLargeExplicit) {
     ext_sort::CountingSort(in_t, out_t, 32, 0, 500);
     EXPECT_EQ(TapeToVector(out_t), expected);
 }
+
+namespace {
+    // VectorTape, считающая прочитанные элементы - свои и своих временных лент
+    class ReadCountingTape : public VectorTape {
+    public:
+        ReadCountingTape(const std::vector<int32_t>& init, std::shared_ptr<std::size_t> reads)
+            : VectorTape(init), reads_(std::move(reads)) {}
+
+        std::unique_ptr<Tape> CreateTemporary(std::size_t size, std::size_t) const override {
+            return std::make_unique<ReadCountingTape>(std::vector<int32_t>(size, 0), reads_);
+        }
+
+        int32_t Read() override {
+            ++*reads_;
+            return VectorTape::Read();
+        }
+
+        std::size_t ReadBlock(int32_t* out, std::size_t n) override {
+            n = VectorTape::ReadBlock(out, n);
+            *reads_ += n;
+            return n;
+        }
+
+    private:
+        std::shared_ptr<std::size_t> reads_;
+    };
+
+    // Сортирует и возвращает, сколько элементов прочитано со всех лент
+    std::size_t SortCountingReads(const std::vector<int32_t>& input, std::size_t memory_limit,
+                                  bool explicit_range) {
+        auto reads = std::make_shared<std::size_t>(0);
+        ReadCountingTape in_t(input, reads);
+        VectorTape out_t(std::vector<int32_t>(input.size(), 0));
+        if (explicit_range) {
+            ext_sort::CountingSort(in_t, out_t, memory_limit,
+                                   std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::max());
+        } else {
+            ext_sort::CountingSort(in_t, out_t, memory_limit);
+        }
+
+        std::vector<int32_t> expected = input;
+        std::sort(expected.begin(), expected.end());
+        EXPECT_EQ(TapeToVector(out_t), expected);
+        return *reads;
+    }
+
+    // Группирует подсчётом, сверяет с std::map и возвращает, сколько элементов
+    // прочитано со всех лент. with_counts => счётчики пишутся в файл
+    std::size_t GroupCountingReads(const std::vector<int32_t>& input, std::size_t memory_limit,
+                                   bool explicit_range, bool with_counts) {
+        std::map<int32_t, uint64_t> expected;
+        for (int32_t v : input) {
+            ++expected[v];
+        }
+
+        auto reads = std::make_shared<std::size_t>(0);
+        ReadCountingTape in_t(input, reads);
+        VectorTape out_t(std::vector<int32_t>(input.size(), 0));
+        WriteRecordFile("test_group_counts.bin", std::vector<uint64_t>(input.size(), 0));
+        std::size_t groups = 0;
+        {
+            RecordFileTape<uint64_t> counts_t("test_group_counts.bin", Delays{0, 0, 0, 0});
+            RecordFileTape<uint64_t>* counts = with_counts ? &counts_t : nullptr;
+            groups = explicit_range
+                ? ext_sort::CountingGroup(in_t, out_t, counts, memory_limit,
+                                          std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::max())
+                : ext_sort::CountingGroup(in_t, out_t, counts, memory_limit);
+        }
+        std::vector<uint64_t> counts = ReadRecordFile<uint64_t>("test_group_counts.bin");
+
+        EXPECT_EQ(groups, expected.size());
+        std::vector<int32_t> values = TapeToVector(out_t);
+        std::size_t i = 0;
+        for (const auto& [value, count] : expected) {
+            EXPECT_EQ(values[i], value) << i;
+            if (with_counts) {
+                EXPECT_EQ(counts[i], count) << i;
+            }
+            ++i;
+        }
+        return *reads;
+    }
+} // namespace
+
+// Широкий диапазон, мало различных значений: один проход вместо прохода на окно
+TEST(CountingSortTest, WideRangeFewDistinctSinglePass) {
+    std::vector<int32_t> input = RandomVector(20000, -50, 50);
+    input[0] = std::numeric_limits<int32_t>::min();
+    input[1] = std::numeric_limits<int32_t>::max();
+
+    for (bool explicit_range : {true, false}) {
+        EXPECT_EQ(SortCountingReads(input, 16 * 1024, explicit_range), input.size());
+    }
+}
+
+// Различных значений больше, чем помещается в память: раскладка по разделам,
+// всего не больше двух проходов по данным
+TEST(CountingSortTest, ManyDistinctAtMostTwoPasses) {
+    std::vector<int32_t> input = RandomVector(20000, std::numeric_limits<int32_t>::min(),
+                                              std::numeric_limits<int32_t>::max());
+
+    for (bool explicit_range : {true, false}) {
+        EXPECT_LE(SortCountingReads(input, 1024 * 1024, explicit_range), 2 * input.size());
+    }
+
+    // Памяти мало и на разделы - корректно, но уже за большее число проходов
+    auto narrow = RandomVector(1000, -5000, 5000);
+    for (bool explicit_range : {true, false}) {
+        SortCountingReads(narrow, 256, explicit_range);
+    }
+}
+
+// Ранги и квантили без сортировки совпадают с элементами отсортированного входа
+TEST(SelectTest, MatchesSortedInput) {
+    std::vector<int32_t> wide = RandomVector(20000, std::numeric_limits<int32_t>::min(),
+                                             std::numeric_limits<int32_t>::max());
+    std::vector<int32_t> narrow = RandomVector(20000, -100, 100);
+    std::vector<int32_t> equal(5000, 7);
+
+    for (const std::vector<int32_t>* input : {&wide, &narrow, &equal}) {
+        std::vector<int32_t> sorted = *input;
+        std::sort(sorted.begin(), sorted.end());
+        std::size_t n = sorted.size();
+        std::vector<std::size_t> ranks = {n / 2, 0, n - 1, n * 99 / 100, n / 2, 1};
+
+        for (std::size_t memory_limit : {64, 1024, 64 * 1024, 1024 * 1024}) {
+            VectorTape in_t(*input);
+            std::vector<int32_t> selected = ext_sort::Select(in_t, ranks, memory_limit);
+            ASSERT_EQ(selected.size(), ranks.size());
+            for (std::size_t i = 0; i < ranks.size(); ++i) {
+                EXPECT_EQ(selected[i], sorted[ranks[i]]) << "rank=" << ranks[i] << " memory=" << memory_limit;
+            }
+        }
+
+        VectorTape in_t(*input);
+        std::vector<int32_t> quantiles = ext_sort::Quantiles(in_t, {0.0, 0.5, 0.99, 1.0}, 4096);
+        EXPECT_EQ(quantiles, (std::vector<int32_t>{sorted[0], sorted[(n - 1) / 2],
+                                                    sorted[static_cast<std::size_t>(0.99 * (n - 1))], sorted[n - 1]}));
+    }
+}
+
+// Все ранги ищутся в одних проходах: при достаточной памяти их два
+TEST(SelectTest, FewPassesForAllRanks) {
+    std::vector<int32_t> input = RandomVector(50000, std::numeric_limits<int32_t>::min(),
+                                              std::numeric_limits<int32_t>::max());
+    auto reads = std::make_shared<std::size_t>(0);
+    ReadCountingTape in_t(input, reads);
+    ext_sort::SortProfile profile;
+    ext_sort::Quantiles(in_t, {0.5, 0.9, 0.99, 0.999}, 64 * 1024, &profile);
+    EXPECT_EQ(profile.Phases().size(), 2u);
+    EXPECT_EQ(*reads, 2 * input.size());
+
+    VectorTape empty(std::vector<int32_t>{});
+    EXPECT_THROW(ext_sort::Select(empty, {0}, 1024), std::runtime_error);
+    EXPECT_THROW(ext_sort::Quantiles(in_t, {1.5}, 1024), std::runtime_error);
+    EXPECT_THROW(ext_sort::Select(in_t, {0}, 8), std::runtime_error);
+}
+
+// Группировка подсчётом: счётчики пишутся как есть, без развёртывания в повторы
+TEST(CountingGroupTest, MatchesMap) {
+    std::vector<int32_t> few = RandomVector(20000, -50, 50);
+    few[0] = std::numeric_limits<int32_t>::min();
+    std::vector<int32_t> many = RandomVector(20000, -3000, 3000);
+
+    for (bool explicit_range : {true, false}) {
+        for (bool with_counts : {true, false}) {
+            EXPECT_EQ(GroupCountingReads(few, 16 * 1024, explicit_range, with_counts), few.size());
+            GroupCountingReads(many, 1024, explicit_range, with_counts);
+            GroupCountingReads(many, 256, explicit_range, with_counts);
+            GroupCountingReads({}, 1024, explicit_range, with_counts);
+        }
+    }
+
+    VectorTape in_t(std::vector<int32_t>{3, 1, 3, 3});
+    VectorTape out_t(std::vector<int32_t>(4, 0));
+    EXPECT_EQ(ext_sort::CountingGroup(in_t, out_t, nullptr, 1024, 0, 10), 2u);
+    EXPECT_EQ(TapeToVector(out_t), (std::vector<int32_t>{1, 3, 0, 0}));
+}
+
+// Без счётчиков разделы получают посчитанное значение один раз: повторы, собранные
+// гистограммой до раскладки, на ленты-разделы не попадают
+TEST(CountingGroupTest, DistinctShrinksPartitions) {
+    std::vector<int32_t> input = RandomVector(50000, -50, 50);
+    std::vector<int32_t> tail = RandomVector(10000, std::numeric_limits<int32_t>::min(),
+                                             std::numeric_limits<int32_t>::max());
+    input.insert(input.end(), tail.begin(), tail.end());
+
+    std::size_t sort_reads = SortCountingReads(input, 16 * 1024, false);
+    std::size_t distinct_reads = GroupCountingReads(input, 16 * 1024, false, false);
+    std::size_t counts_reads = GroupCountingReads(input, 16 * 1024, false, true);
+    EXPECT_LT(distinct_reads + 40000, sort_reads);
+    EXPECT_EQ(counts_reads, sort_reads);
+}
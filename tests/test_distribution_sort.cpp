@@ -0,0 +1,91 @@
+#include "external_sort.hpp"
+#include "file_tape.hpp"
+
+#include "vector_tape.hpp"
+#include "helpers.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <filesystem>
+#include <limits>
+#include <numeric>
+
+#include <gtest/gtest.h>
+
+
+TEST(DistributionSortTest, FitsInMemory) {
+    std::vector<int32_t> input = {3, -2, 1, 3};
+    VectorTape in_t(input);
+    VectorTape out_t(std::vector<int32_t>(input.size(), 0));
+
+    auto stats = ext_sort::DistributionSort(in_t, out_t, 1024, ext_sort::RunFormation::Sort);
+    EXPECT_EQ(TapeToVector(out_t), (std::vector<int32_t>{-2, 1, 3, 3}));
+    EXPECT_EQ(stats.passes, 0u);
+
+    VectorTape empty(std::vector<int32_t>{});
+    ext_sort::DistributionSort(empty, empty, 1024, ext_sort::RunFormation::Sort);
+    EXPECT_EQ(empty.Size(), 0u);
+}
+
+// Разные распределения, способы сортировки корзин, память и потоки
+TEST(DistributionSortTest, RandomAndSkewed) {
+    std::vector<int32_t> uniform = RandomVector(20000, std::numeric_limits<int32_t>::min(),
+                                                std::numeric_limits<int32_t>::max());
+    std::vector<int32_t> few = RandomVector(20000, -3, 3);
+    std::vector<int32_t> sorted(20000);
+    std::iota(sorted.begin(), sorted.end(), -10000);
+    std::vector<int32_t> reversed(sorted.rbegin(), sorted.rend());
+    std::vector<int32_t> equal(20000, 42);
+    // Почти все значения равны, остальные - вокруг них
+    std::vector<int32_t> skewed = RandomVector(20000, -100, 100);
+    std::replace_if(skewed.begin(), skewed.end(), [](int32_t v) { return v > -90; }, 0);
+
+    for (const std::vector<int32_t>* input : {&uniform, &few, &sorted, &reversed, &equal, &skewed}) {
+        std::vector<int32_t> expected = *input;
+        std::sort(expected.begin(), expected.end());
+
+        for (auto formation : {ext_sort::RunFormation::Sort, ext_sort::RunFormation::RadixSort,
+                               ext_sort::RunFormation::ReplacementSelection}) {
+            for (std::size_t memory_limit : {64, 1024, 64 * 1024}) {
+                for (std::size_t threads : {1, 3}) {
+                    VectorTape in_t(*input);
+                    VectorTape out_t(std::vector<int32_t>(input->size(), 0));
+                    ext_sort::DistributionSort(in_t, out_t, memory_limit, formation, threads);
+                    EXPECT_EQ(TapeToVector(out_t), expected)
+                        << "memory=" << memory_limit << " threads=" << threads;
+                }
+            }
+        }
+    }
+}
+
+// Равномерные значения: одна раскладка, все корзины помещаются в память -
+// каждый элемент записан на временную ленту и прочитан с неё не больше раза
+// (равные разделителю только считаются)
+TEST(DistributionSortTest, UniformTwoPasses) {
+    std::vector<int32_t> input = RandomVector(200000, std::numeric_limits<int32_t>::min(),
+                                              std::numeric_limits<int32_t>::max());
+    std::vector<int32_t> expected = input;
+    std::sort(expected.begin(), expected.end());
+
+    std::filesystem::create_directory("tmp");
+    WriteIntFile("test_distribution_in.bin", input);
+    WriteIntFile("test_distribution_out.bin", std::vector<int32_t>(input.size(), 0));
+    {
+        FileTape in_t("test_distribution_in.bin", Delays{0, 0, 0, 0});
+        FileTape out_t("test_distribution_out.bin", Delays{0, 0, 0, 0});
+        ext_sort::SortProfile profile;
+        auto stats = ext_sort::DistributionSort(in_t, out_t, 256 * 1024, ext_sort::RunFormation::Sort, 1, &profile);
+        EXPECT_EQ(stats.passes, 1u);
+        EXPECT_EQ(stats.distributed_elements, input.size());
+        ASSERT_EQ(profile.Phases().size(), 2u);
+        EXPECT_EQ(profile.Phases()[0].name, "distribute_pass");
+        EXPECT_EQ(profile.Phases()[1].name, "sort_buckets");
+
+        EXPECT_LE(in_t.TemporaryMetrics().writes, input.size());
+        EXPECT_GT(in_t.TemporaryMetrics().writes, input.size() * 99 / 100);
+        EXPECT_EQ(in_t.TemporaryMetrics().reads, in_t.TemporaryMetrics().writes);
+        EXPECT_EQ(out_t.Metrics().writes, input.size());
+    }
+    EXPECT_EQ(ReadIntFile("test_distribution_out.bin"), expected);
+}
@@ -11,6 +11,7 @@
 #include <filesystem>
 #include <fstream>
 #include <new>
+#include <numeric>
 #include <thread>
 
 #include <gtest/gtest.h>
@@ -122,6 +123,110 @@ TEST(FileTapeTest, OutOfRange) {
     EXPECT_FALSE(tape.Rewind(-2));
 }
 
+TEST(FileTapeTest, BlockReadWrite) {
+    const std::string fname = "test_tape_block.bin";
+    std::vector<int32_t> initial = RandomVector(1000, -100, 100);
+    WriteIntFile(fname, initial);
+
+    {
+        FileTape tape(fname, Delays{0,0,0,0}, 64);
+        std::vector<int32_t> block(300);
+        EXPECT_EQ(tape.ReadBlock(block.data(), 300), 300u);
+        EXPECT_EQ(tape.Position(), 300u);
+        EXPECT_TRUE(std::equal(block.begin(), block.end(), initial.begin()));
+
+        // Блок до конца ленты: головка остаётся на последней ячейке, как после Next()
+        tape.Rewind(500);
+        EXPECT_EQ(tape.ReadBlock(block.data(), 300), 200u);
+        EXPECT_EQ(tape.Position(), 999u);
+        EXPECT_TRUE(std::equal(block.begin(), block.begin() + 200, initial.begin() + 800));
+
+        std::iota(block.begin(), block.end(), 0);
+        tape.Reset();
+        tape.Rewind(100);
+        EXPECT_EQ(tape.WriteBlock(block.data(), 300), 300u);
+        EXPECT_EQ(tape.Position(), 400u);
+        std::copy(block.begin(), block.end(), initial.begin() + 100);
+        tape.Reset();
+        EXPECT_EQ(TapeToVector(tape), initial);
+    }
+
+    EXPECT_EQ(ReadIntFile(fname), initial);
+
+    // Задержки блока равны сумме задержек поэлементных операций
+    FileTape slow(fname, Delays{10, 0, 5, 0});
+    std::vector<int32_t> block(4);
+    auto t0 = std::chrono::steady_clock::now();
+    slow.ReadBlock(block.data(), 4);
+    EXPECT_GE(std::chrono::steady_clock::now() - t0, 60ms);
+}
+
+// Чтение назад: окно буфера ставится перед головкой, а не за ней
+TEST(FileTapeTest, BlockReadBackward) {
+    const std::string fname = "test_tape_block_backward.bin";
+    std::vector<int32_t> initial = RandomVector(1000, -100, 100);
+    WriteIntFile(fname, initial);
+
+    FileTape tape(fname, Delays{0,0,0,0}, 64);
+    std::vector<int32_t> block(300);
+    tape.Rewind(999);
+    EXPECT_EQ(tape.ReadBlockBackward(block.data(), 300), 300u);
+    EXPECT_EQ(tape.Position(), 699u);
+    EXPECT_TRUE(std::equal(block.begin(), block.end(), initial.rbegin()));
+
+    // Блок до начала ленты: головка остаётся на первой ячейке, как после Prev()
+    tape.Rewind(-500);
+    EXPECT_EQ(tape.ReadBlockBackward(block.data(), 300), 200u);
+    EXPECT_EQ(tape.Position(), 0u);
+    EXPECT_TRUE(std::equal(block.begin(), block.begin() + 200, initial.rend() - 200));
+
+    // 500 ячеек по 16 в окне
+    EXPECT_LE(tape.Metrics().buffer_misses, 500u / 16 + 2);
+
+    std::filesystem::remove(fname);
+}
+
+TEST(FileTapeTest, SectionsShareFile) {
+    const std::string fname = "test_tape_section.bin";
+    std::vector<int32_t> initial = RandomVector(1000, -100, 100);
+    WriteIntFile(fname, initial);
+
+    {
+        FileTape tape(fname, Delays{0,0,0,0}, 64);
+        tape.Rewind(10);
+        tape.Write(5);
+        initial[10] = 5;
+
+        EXPECT_TRUE(tape.SupportsSections());
+
+        // Участок видит несброшенную запись исходной ленты
+        auto left = tape.OpenSection(0, 500, 64);
+        auto right = tape.OpenSection(500, 500, 64);
+        EXPECT_EQ(left->Size(), 500u);
+        EXPECT_EQ(TapeToVector(*left),
+                  std::vector<int32_t>(initial.begin(), initial.begin() + 500));
+
+        // Запись с конца участка не задевает соседний
+        std::vector<int32_t> block(500, 1);
+        left->Reset();
+        EXPECT_EQ(left->WriteBlock(block.data(), 600), 500u);
+        EXPECT_EQ(left->Position(), 499u);
+        EXPECT_FALSE(left->Next());
+        std::fill(initial.begin(), initial.begin() + 500, 1);
+
+        std::fill(block.begin(), block.end(), 2);
+        right->Rewind(250);
+        right->WriteBlock(block.data(), 250);
+        std::fill(initial.begin() + 750, initial.end(), 2);
+
+        auto nested = right->OpenSection(100, 50, 0);
+        EXPECT_EQ(nested->Read(), initial[600]);
+        EXPECT_THROW(tape.OpenSection(900, 101, 0), std::runtime_error);
+    }
+
+    EXPECT_EQ(ReadIntFile(fname), initial);
+}
+
 // Проверяем, что память не превышает заданный лимит
 TEST(FileTapeTest, MemoryLimitEnforced) {
     const std::string fname = "test_tape_mem.bin";
@@ -153,3 +258,52 @@ TEST(FileTapeTest, MemoryLimitEnforced) {
       EXPECT_LE(max_alloc - start, limit);
     }
 }
+
+// Двойная буферизация с фоновым потоком не меняет содержимое ленты
+TEST(FileTapeTest, AsyncIOMatchesModel) {
+    const std::string fname = "test_tape_async.bin";
+    std::vector<int32_t> model = RandomVector(5000, -1000, 1000);
+    WriteIntFile(fname, model);
+
+    {
+        FileTape tape(fname, Delays{0,0,0,0}, 64, /*async_io=*/true);
+        std::mt19937 gen(7);
+        std::uniform_int_distribution<int> op(0, 9);
+        for (int step = 0; step < 100000; ++step) {
+            std::size_t pos = tape.Position();
+            ASSERT_EQ(tape.Read(), model[pos]);
+            switch (op(gen)) {
+                case 0:
+                    tape.Write(step);
+                    model[pos] = step;
+                    break;
+                case 1:
+                case 2:
+                    tape.Prev();
+                    break;
+                case 3:
+                    tape.Rewind(static_cast<std::ptrdiff_t>(gen() % 200) - 100);
+                    break;
+                default:
+                    tape.Next();
+            }
+            if (step % 20000 == 0) {
+                tape.SetMemoryLimit(step % 40000 == 0 ? 16 : 64);
+            }
+        }
+
+        // Последовательная запись и чтение в обе стороны
+        tape.Reset();
+        for (std::size_t i = 0; i < model.size(); ++i) {
+            tape.Write(static_cast<int32_t>(i));
+            model[i] = static_cast<int32_t>(i);
+            tape.Next();
+        }
+        for (std::size_t i = model.size(); i-- > 0;) {
+            ASSERT_EQ(tape.Read(), model[i]);
+            tape.Prev();
+        }
+    }
+
+    EXPECT_EQ(ReadIntFile(fname), model);
+}
@@ -0,0 +1,56 @@
+#include "growing_tape.hpp"
+
+#include "helpers.hpp"
+#include "vector_tape.hpp"
+
+#include <cstdint>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+
+// Сегменты создаются по мере записи: занято не больше вдвое против записанного
+TEST(GrowingTapeTest, AllocatesAsWritten) {
+    VectorTape origin({});
+    GrowingTape tape(origin, 1000000, 4096);
+    EXPECT_EQ(tape.Size(), 1000000u);
+    EXPECT_EQ(tape.AllocatedCells(), 0u);
+
+    std::vector<int32_t> data = RandomVector(5000, -1000, 1000);
+    EXPECT_EQ(tape.WriteBlock(data.data(), 3000), 3000u);
+    for (std::size_t i = 3000; i < data.size(); ++i) {
+        tape.Write(data[i]);
+        EXPECT_TRUE(tape.Next());
+    }
+    EXPECT_EQ(tape.Position(), data.size());
+    EXPECT_GE(tape.AllocatedCells(), data.size());
+    EXPECT_LE(tape.AllocatedCells(), 2 * data.size());
+
+    // Блок через границы сегментов читается целиком, дальше записанного - нули
+    std::vector<int32_t> read(data.size() + 10, -1);
+    tape.Reset();
+    EXPECT_EQ(tape.ReadBlock(read.data(), read.size()), read.size());
+    EXPECT_EQ(std::vector<int32_t>(read.begin(), read.begin() + data.size()), data);
+    EXPECT_EQ(read.back(), 0);
+    EXPECT_LE(tape.AllocatedCells(), 2 * data.size());
+
+    // Перемотка и поэлементное чтение
+    EXPECT_TRUE(tape.Rewind(-static_cast<std::ptrdiff_t>(tape.Position()) + 4095));
+    EXPECT_EQ(tape.Read(), data[4095]);
+    EXPECT_TRUE(tape.Prev());
+    EXPECT_EQ(tape.Read(), data[4094]);
+    EXPECT_FALSE(tape.Rewind(1000000));
+}
+
+// Лента не длиннее своего размера
+TEST(GrowingTapeTest, BoundedBySize) {
+    VectorTape origin({});
+    GrowingTape tape(origin, 1500, 0);
+
+    std::vector<int32_t> data(2000, 7);
+    EXPECT_EQ(tape.WriteBlock(data.data(), data.size()), 1500u);
+    EXPECT_EQ(tape.Position(), 1499u);
+    EXPECT_FALSE(tape.Next());
+    EXPECT_EQ(tape.AllocatedCells(), 1500u);
+}
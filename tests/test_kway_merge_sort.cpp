@@ -0,0 +1,199 @@
+#include "external_sort.hpp"
+
+#include "vector_tape.hpp"
+#include "helpers.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+#include <gtest/gtest.h>
+
+
+TEST(KWayMergeSortTest, FitsInMemory) {
+    std::vector<int32_t> input = {3, 2, 1};
+    VectorTape in_t(input);
+    VectorTape out_t(std::vector<int32_t>(input.size(), 0));
+
+    auto stats = ext_sort::KWayMergeSort(in_t, out_t, 1024, ext_sort::RunFormation::Sort, 16, false);
+    EXPECT_EQ(TapeToVector(out_t), (std::vector<int32_t>{1,2,3}));
+    EXPECT_EQ(stats.runs, 1u);
+    EXPECT_EQ(stats.passes, 0u);
+}
+
+TEST(KWayMergeSortTest, EmptyInput) {
+    std::vector<int32_t> input;
+    VectorTape in_t(input);
+    VectorTape out_t(input);
+
+    for (bool polyphase : {false, true}) {
+        ext_sort::KWayMergeSort(in_t, out_t, 256, ext_sort::RunFormation::Sort, 16, polyphase);
+        EXPECT_TRUE(TapeToVector(out_t).empty());
+    }
+}
+
+TEST(KWayMergeSortTest, RandomLarge) {
+    std::vector<int32_t> input = RandomVector(10000, -1000, 1000);
+
+    std::vector<int32_t> expected = input;
+    std::sort(expected.begin(), expected.end());
+
+    for (bool polyphase : {false, true}) {
+        for (auto formation : {ext_sort::RunFormation::Sort,
+                               ext_sort::RunFormation::HeapSort,
+                               ext_sort::RunFormation::RadixSort,
+                               ext_sort::RunFormation::ReplacementSelection}) {
+            for (size_t max_tapes : {4, 5, 9, 16}) {
+                for (size_t memory_limit : {8, 64, 512, 8192}) {
+                    VectorTape in_t(input);
+                    VectorTape out_t(std::vector<int32_t>(input.size(), 0));
+                    ext_sort::KWayMergeSort(in_t, out_t, memory_limit, formation, max_tapes, polyphase);
+                    EXPECT_EQ(TapeToVector(out_t), expected);
+                }
+            }
+        }
+    }
+}
+
+// Вход помещается в буфер сортировки: одна серия сразу в выходную ленту,
+// даже если выбор с замещением дал бы две (куча меньше буфера на блоки потоков)
+TEST(KWayMergeSortTest, FitsInMemoryIsSingleRun) {
+    std::vector<int32_t> input = RandomVector(1000, -1000, 1000);
+    std::vector<int32_t> expected = input;
+    std::sort(expected.begin(), expected.end());
+
+    VectorTape in_t(input);
+    VectorTape out_t(std::vector<int32_t>(input.size(), 0));
+    auto stats = ext_sort::KWayMergeSort(in_t, out_t, 8192, ext_sort::RunFormation::ReplacementSelection, 4, false);
+    EXPECT_EQ(TapeToVector(out_t), expected);
+    EXPECT_EQ(stats.runs, 1u);
+    EXPECT_EQ(stats.passes, 0u);
+}
+
+// Упорядоченный по убыванию вход копируется без слияния, почти упорядоченный -
+// одна естественная серия на всё и один проход
+TEST(KWayMergeSortTest, NaturalRuns) {
+    std::vector<int32_t> descending = RandomVector(5000, -1000, 1000);
+    std::sort(descending.rbegin(), descending.rend());
+    std::vector<int32_t> almost = descending;
+    std::reverse(almost.begin(), almost.end());
+    std::swap(almost[100], almost[101]);
+
+    for (const std::vector<int32_t>* input_ptr : {&descending, &almost}) {
+        const std::vector<int32_t>& input = *input_ptr;
+        std::vector<int32_t> expected = input;
+        std::sort(expected.begin(), expected.end());
+        VectorTape in_t(input);
+        VectorTape out_t(std::vector<int32_t>(input.size(), 0));
+        auto stats = ext_sort::KWayMergeSort(in_t, out_t, 1024, ext_sort::RunFormation::NaturalRuns, 8, false);
+        EXPECT_EQ(TapeToVector(out_t), expected);
+        EXPECT_EQ(stats.runs, 1u);
+        EXPECT_EQ(stats.passes, input_ptr == &descending ? 0u : 1u);
+    }
+}
+
+// k-путевое слияние делает ceil(log_k(runs)) проходов вместо ceil(log_2(runs))
+TEST(KWayMergeSortTest, FewerPasses) {
+    std::vector<int32_t> input = RandomVector(256, -1000, 1000);
+
+    // Мало памяти: k = 2, 32 серии по 8 элементов
+    VectorTape in_t(input);
+    VectorTape out_t(std::vector<int32_t>(input.size(), 0));
+    auto stats = ext_sort::KWayMergeSort(in_t, out_t, 64, ext_sort::RunFormation::Sort, 16, false);
+    EXPECT_EQ(stats.runs, 32u);
+    EXPECT_EQ(stats.fan_in, 2u);
+    EXPECT_EQ(stats.passes, 5u);
+
+    // 1 МБ: чанки по 128К элементов, буферов хватает на k = 7
+    input = RandomVector(8 * 131072 + 1, -1000, 1000);
+    std::vector<int32_t> expected = input;
+    std::sort(expected.begin(), expected.end());
+
+    VectorTape in_big(input);
+    VectorTape out_big(std::vector<int32_t>(input.size(), 0));
+    stats = ext_sort::KWayMergeSort(in_big, out_big, 1u << 20, ext_sort::RunFormation::Sort, 16, false);
+    EXPECT_EQ(TapeToVector(out_big), expected);
+    EXPECT_EQ(stats.runs, 9u);
+    EXPECT_EQ(stats.fan_in, 7u);
+    EXPECT_EQ(stats.passes, 2u);
+    EXPECT_EQ(stats.merged_elements, 2 * input.size());
+}
+
+TEST(KWayMergeSortTest, PolyphaseMergesEveryElementOnce) {
+    std::vector<int32_t> input = RandomVector(1000, -50, 50);
+    std::vector<int32_t> expected = input;
+    std::sort(expected.begin(), expected.end());
+
+    VectorTape in_t(input);
+    VectorTape out_t(std::vector<int32_t>(input.size(), 0));
+    auto stats = ext_sort::KWayMergeSort(in_t, out_t, 40, ext_sort::RunFormation::Sort, 3, true);
+    EXPECT_EQ(TapeToVector(out_t), expected);
+    EXPECT_EQ(stats.runs, 200u);
+    EXPECT_EQ(stats.fan_in, 2u);
+    EXPECT_GE(stats.merged_elements, input.size() * stats.passes / 2);
+}
+
+TEST(KWayMergeSortTest, ParallelRunGeneration) {
+    std::vector<int32_t> input = RandomVector(20000, -1000, 1000);
+    std::vector<int32_t> expected = input;
+    std::sort(expected.begin(), expected.end());
+
+    for (bool polyphase : {false, true}) {
+        VectorTape in_t(input);
+        VectorTape out_t(std::vector<int32_t>(input.size(), 0));
+        auto stats = ext_sort::KWayMergeSort(in_t, out_t, 4096, ext_sort::RunFormation::Sort, 16, polyphase, 4);
+        EXPECT_EQ(TapeToVector(out_t), expected);
+        EXPECT_EQ(stats.runs, (input.size() + 101) / 102); // чанки по 2048 / 4 / 5 элементов
+    }
+}
+
+// K в памяти - куча за один проход, иначе слияние с обрезанными сериями.
+// Наименьшие - по возрастанию, наибольшие - по убыванию
+TEST(PartialSortTest, SmallestAndLargest) {
+    std::vector<int32_t> input = RandomVector(10000, -1000, 1000);
+    input.push_back(std::numeric_limits<int32_t>::min());
+    input.push_back(std::numeric_limits<int32_t>::max());
+    std::vector<int32_t> ascending = input;
+    std::sort(ascending.begin(), ascending.end());
+    std::vector<int32_t> descending(ascending.rbegin(), ascending.rend());
+
+    for (std::size_t k : {1, 10, 300, 5000, 20000}) {
+        for (std::size_t memory_limit : {64, 1024, 8192}) {
+            for (bool largest : {false, true}) {
+                std::size_t keep = std::min(k, input.size());
+                VectorTape in_t(input);
+                VectorTape out_t(std::vector<int32_t>(keep, 0));
+                ext_sort::PartialSort(in_t, out_t, k, memory_limit, largest, 4);
+                const std::vector<int32_t>& expected = largest ? descending : ascending;
+                EXPECT_EQ(TapeToVector(out_t), std::vector<int32_t>(expected.begin(), expected.begin() + keep))
+                    << "k=" << k << " memory=" << memory_limit << " largest=" << largest;
+            }
+        }
+    }
+}
+
+// Пока K не больше половины памяти, слияния нет; иначе слитые серии
+// обрезаются до K, и проходы пишут меньше, чем весь вход
+TEST(PartialSortTest, SinglePassAndTruncatedRuns) {
+    std::vector<int32_t> input = RandomVector(20000, -100000, 100000);
+
+    VectorTape in_t(input);
+    VectorTape out_t(std::vector<int32_t>(100, 0));
+    auto stats = ext_sort::PartialSort(in_t, out_t, 100, 1024);
+    EXPECT_EQ(stats.runs, 1u);
+    EXPECT_EQ(stats.passes, 0u);
+
+    VectorTape in_big(input);
+    VectorTape out_big(std::vector<int32_t>(1000, 0));
+    stats = ext_sort::PartialSort(in_big, out_big, 1000, 1024, false, 4);
+    EXPECT_EQ(stats.runs, 157u);
+    EXPECT_GE(stats.passes, 2u);
+    EXPECT_LT(stats.merged_elements, stats.passes * input.size());
+}
+
+TEST(KWayMergeSortTest, TooFewTapes) {
+    std::vector<int32_t> input = RandomVector(100, 0, 10);
+    VectorTape in_t(input);
+    VectorTape out_t(std::vector<int32_t>(input.size(), 0));
+    EXPECT_THROW(ext_sort::KWayMergeSort(in_t, out_t, 16, ext_sort::RunFormation::Sort, 3, false), std::runtime_error);
+}
@@ -9,6 +9,7 @@
 #include <algorithm>
 #include <filesystem>
 #include <fstream>
+#include <map>
 #include <vector>
 
 #include <gtest/gtest.h>
@@ -57,6 +58,7 @@ TEST(FileSortTest, ChunkMergeSortRandom) {
           shift_ms: 0
           rewind_ms: 0
         memory_limit_bytes: 40
+        threads: 3
         strict_stack_limit: )";
 
     for (auto strict_stack_limit : {"true", "false"}) {
@@ -70,6 +72,238 @@ TEST(FileSortTest, ChunkMergeSortRandom) {
     }
 }
 
+TEST(FileSortTest, MergeModesReplacementSelection) {
+    const std::string input = "test_fs_kway_in.bin";
+    const std::string output = "test_fs_kway_out.bin";
+    const std::string cfg = "test_fs_kway.yaml";
+
+    auto data = RandomVector(1000, -5000, 5000);
+    WriteIntFile(input, data);
+
+    std::string yaml = R"(
+        delays:
+          read_ms: 0
+          write_ms: 0
+          shift_ms: 0
+          rewind_ms: 0
+        memory_limit_bytes: 40
+        strict_stack_limit: false
+        replacement_selection: true
+        max_tapes: 5
+        merge_mode: )";
+
+    for (auto merge_mode : {"binary", "kway", "polyphase", "distribution"}) {
+      for (auto tapes : {"\n        async_io: true", "\n        mmap_tapes: true"}) {
+        WriteYaml(cfg, yaml + merge_mode + tapes);
+
+        ext_sort::FileSort(input, output, cfg);
+        auto sorted = ReadIntFile(output);
+        std::vector<int32_t> expected = data;
+        std::sort(expected.begin(), expected.end());
+        EXPECT_EQ(sorted, expected);
+      }
+    }
+}
+
+TEST(FileSortTest, AutoPlan) {
+    const std::string input = "test_fs_plan_in.bin";
+    const std::string output = "test_fs_plan_out.bin";
+    const std::string cfg = "test_fs_plan.yaml";
+
+    std::string yaml = R"(
+        delays:
+          read_ms: 1
+          write_ms: 1
+          shift_ms: 0
+          rewind_ms: 10
+          virtual_time: true
+        memory_limit_bytes: 4096
+        strict_stack_limit: false
+        auto_plan: true
+    )";
+    WriteYaml(cfg, yaml);
+
+    for (auto data : {RandomVector(5000, -5, 5), RandomVector(5000, -1000000, 1000000)}) {
+        WriteIntFile(input, data);
+
+        ext_sort::FileSort(input, output, cfg);
+        auto sorted = ReadIntFile(output);
+        std::sort(data.begin(), data.end());
+        EXPECT_EQ(sorted, data);
+    }
+}
+
+// 8 байт ключа и 8 байт нагрузки
+TEST(FileSortTest, KeyValueRecords) {
+    const std::string input = "test_fs_records_in.bin";
+    const std::string output = "test_fs_records_out.bin";
+    const std::string cfg = "test_fs_records.yaml";
+
+    std::string yaml = R"(
+        delays:
+          read_ms: 0
+          write_ms: 0
+          shift_ms: 0
+          rewind_ms: 0
+        memory_limit_bytes: 2048
+        strict_stack_limit: false
+        record_format: kv64
+    )";
+    WriteYaml(cfg, yaml);
+
+    std::vector<ext_sort::KeyValue64> data;
+    for (int32_t v : RandomVector(3000, 0, 100000)) {
+        data.push_back({static_cast<uint64_t>(v), data.size()});
+    }
+    WriteRecordFile(input, data);
+
+    ext_sort::FileSort(input, output, cfg);
+    auto sorted = ReadRecordFile<ext_sort::KeyValue64>(output);
+    ASSERT_EQ(sorted.size(), data.size());
+    for (std::size_t i = 0; i < sorted.size(); ++i) {
+        EXPECT_EQ(sorted[i].key, data[sorted[i].value].key);
+        if (i > 0) {
+            EXPECT_LE(sorted[i - 1].key, sorted[i].key);
+        }
+    }
+}
+
+TEST(FileSortTest, IndexFile) {
+    const std::string input = "test_fs_argsort_in.bin";
+    const std::string output = "test_fs_argsort_out.bin";
+    const std::string index = "test_fs_argsort_idx.bin";
+    const std::string cfg = "test_fs_argsort.yaml";
+
+    std::string yaml = R"(
+        delays:
+          read_ms: 0
+          write_ms: 0
+          shift_ms: 0
+          rewind_ms: 0
+        memory_limit_bytes: 2048
+        strict_stack_limit: false
+        index_file: test_fs_argsort_idx.bin
+    )";
+    WriteYaml(cfg, yaml);
+
+    std::vector<int32_t> data = RandomVector(3000, -50, 50);
+    WriteIntFile(input, data);
+
+    ext_sort::FileSort(input, output, cfg);
+    std::vector<int32_t> sorted = ReadIntFile(output);
+    std::vector<uint64_t> positions = ReadRecordFile<uint64_t>(index);
+    ASSERT_EQ(sorted.size(), data.size());
+    ASSERT_EQ(positions.size(), data.size());
+    for (std::size_t i = 0; i < sorted.size(); ++i) {
+        EXPECT_EQ(sorted[i], data[positions[i]]);
+        if (i > 0) {
+            EXPECT_LE(sorted[i - 1], sorted[i]);
+        }
+    }
+}
+
+// top_k: в выходном файле только K наименьших или наибольших значений
+TEST(FileSortTest, TopK) {
+    const std::string input = "test_fs_topk_in.bin";
+    const std::string output = "test_fs_topk_out.bin";
+    const std::string cfg = "test_fs_topk.yaml";
+
+    std::string yaml = R"(
+        delays:
+          read_ms: 0
+          write_ms: 0
+          shift_ms: 0
+          rewind_ms: 0
+        memory_limit_bytes: 1024
+        strict_stack_limit: false
+        top_k: 500
+    )";
+
+    std::vector<int32_t> data = RandomVector(5000, -10000, 10000);
+    WriteIntFile(input, data);
+    std::vector<int32_t> sorted = data;
+    std::sort(sorted.begin(), sorted.end());
+
+    WriteYaml(cfg, yaml);
+    ext_sort::FileSort(input, output, cfg);
+    EXPECT_EQ(ReadIntFile(output), std::vector<int32_t>(sorted.begin(), sorted.begin() + 500));
+
+    WriteYaml(cfg, yaml + "    top_k_largest: true\n");
+    ext_sort::FileSort(input, output, cfg);
+    EXPECT_EQ(ReadIntFile(output), std::vector<int32_t>(sorted.rbegin(), sorted.rbegin() + 500));
+}
+
+// quantiles: в выходном файле только квантили входа, в порядке конфига
+TEST(FileSortTest, Quantiles) {
+    const std::string input = "test_fs_quantiles_in.bin";
+    const std::string output = "test_fs_quantiles_out.bin";
+    const std::string cfg = "test_fs_quantiles.yaml";
+
+    std::string yaml = R"(
+        delays:
+          read_ms: 0
+          write_ms: 0
+          shift_ms: 0
+          rewind_ms: 0
+        memory_limit_bytes: 1024
+        strict_stack_limit: false
+        quantiles: [0.99, 0.5, 0]
+    )";
+    WriteYaml(cfg, yaml);
+
+    std::vector<int32_t> data = RandomVector(5000, -10000, 10000);
+    WriteIntFile(input, data);
+    std::sort(data.begin(), data.end());
+
+    ext_sort::FileSort(input, output, cfg);
+    EXPECT_EQ(ReadIntFile(output), (std::vector<int32_t>{data[4949], data[2499], data[0]}));
+}
+
+// distinct и counts_file: выход и файл счётчиков обрезаны до числа различных значений
+TEST(FileSortTest, DistinctAndCounts) {
+    const std::string input = "test_fs_group_in.bin";
+    const std::string output = "test_fs_group_out.bin";
+    const std::string counts = "test_fs_group_counts.bin";
+    const std::string cfg = "test_fs_group.yaml";
+
+    std::string yaml = R"(
+        delays:
+          read_ms: 0
+          write_ms: 0
+          shift_ms: 0
+          rewind_ms: 0
+        memory_limit_bytes: 1024
+        strict_stack_limit: false
+    )";
+
+    std::vector<int32_t> data = RandomVector(5000, -100, 100);
+    WriteIntFile(input, data);
+    std::map<int32_t, uint64_t> expected;
+    for (int32_t v : data) {
+        ++expected[v];
+    }
+    std::vector<int32_t> distinct;
+    std::vector<uint64_t> expected_counts;
+    for (const auto& [value, count] : expected) {
+        distinct.push_back(value);
+        expected_counts.push_back(count);
+    }
+
+    for (const std::string range : {"", "    value_range: [-100, 100]\n"}) {
+        WriteYaml(cfg, yaml + "    distinct: true\n" + range);
+        ext_sort::FileSort(input, output, cfg);
+        EXPECT_EQ(ReadIntFile(output), distinct);
+
+        WriteYaml(cfg, yaml + "    counts_file: " + counts + "\n" + range);
+        ext_sort::FileSort(input, output, cfg);
+        EXPECT_EQ(ReadIntFile(output), distinct);
+        EXPECT_EQ(ReadRecordFile<uint64_t>(counts), expected_counts);
+    }
+
+    WriteYaml(cfg, yaml + "    distinct: true\n        top_k: 10\n");
+    EXPECT_THROW(ext_sort::FileSort(input, output, cfg), std::runtime_error);
+}
+
 TEST(FileSortTest, MissingInputFile) {
     const std::string input = "nonexistent_in.bin";
     const std::string output = "should_not_create.bin";
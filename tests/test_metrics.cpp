@@ -0,0 +1,151 @@
+#include "external_sort.hpp"
+#include "file_tape.hpp"
+#include "metrics.hpp"
+
+#include "vector_tape.hpp"
+#include "helpers.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+
+// Счётчики FileTape: окно на 10 ячеек, чтение заходит в три окна
+TEST(MetricsTest, FileTapeCounters) {
+    const std::string fname = "test_metrics_tape.bin";
+    WriteIntFile(fname, RandomVector(100, 0, 1000));
+
+    FileTape tape(fname, Delays{1, 1, 0, 0}, 10 * sizeof(int32_t));
+    for (int i = 0; i < 3; ++i) {
+        tape.Read();
+        tape.Next();
+    }
+    tape.Write(7);
+
+    std::vector<int32_t> block(20);
+    EXPECT_EQ(tape.ReadBlock(block.data(), block.size()), 20u);
+    tape.Reset();
+
+    TapeMetrics m = tape.Metrics();
+    EXPECT_EQ(m.reads, 23u);
+    EXPECT_EQ(m.writes, 1u);
+    EXPECT_EQ(m.shifts, 23u);
+    EXPECT_EQ(m.rewinds, 1u);
+    EXPECT_EQ(m.buffer_misses, 3u);
+    EXPECT_EQ(m.io_calls, 4u); // три окна прочитаны, одно грязное записано
+    EXPECT_EQ(m.bytes_read, 30 * sizeof(int32_t));
+    EXPECT_EQ(m.bytes_written, 10 * sizeof(int32_t));
+    EXPECT_EQ(m.delay_ms, 24u);
+
+    std::filesystem::remove(fname);
+}
+
+// Временные ленты и их участки отчитываются при закрытии, в том числе созданные от временных.
+// Участки самой ленты входят в её счётчики
+TEST(MetricsTest, TemporariesReportOnClose) {
+    std::filesystem::create_directory("tmp");
+    const std::string fname = "test_metrics_origin.bin";
+    WriteIntFile(fname, RandomVector(10, 0, 1000));
+
+    FileTape origin(fname, Delays{0, 0, 0, 0}, 64);
+    std::vector<int32_t> block(10, 1);
+    {
+        auto tmp = origin.CreateTemporary(10, 64);
+        tmp->WriteBlock(block.data(), 10);
+
+        auto nested = tmp->CreateTemporary(5, 64);
+        nested->WriteBlock(block.data(), 5);
+
+        auto section = origin.OpenSection(2, 5, 64);
+        section->ReadBlock(block.data(), 5);
+
+        auto tmp_section = tmp->OpenSection(0, 3, 64);
+        tmp_section->ReadBlock(block.data(), 3);
+
+        EXPECT_EQ(origin.TemporaryMetrics().writes, 0u);
+    }
+
+    TapeMetrics m = origin.TemporaryMetrics();
+    EXPECT_EQ(m.writes, 15u);
+    EXPECT_EQ(m.reads, 3u);
+    EXPECT_EQ(m.bytes_written, 15 * sizeof(int32_t));
+    EXPECT_EQ(origin.Metrics().reads, 5u);
+
+    std::filesystem::remove(fname);
+}
+
+TEST(MetricsTest, ChunkMergeSortPhases) {
+    std::vector<int32_t> input = RandomVector(1000, -1000, 1000);
+    VectorTape in_t(input);
+    VectorTape out_t(std::vector<int32_t>(input.size(), 0));
+
+    ext_sort::SortProfile profile;
+    ext_sort::ChunkMergeSort(in_t, out_t, 512, ext_sort::RunFormation::Sort, 1, &profile);
+
+    // 64 элемента в чанке => 16 серий и 4 прохода слияния, последний - в выходную ленту
+    const std::vector<ext_sort::PhaseTiming>& phases = profile.Phases();
+    ASSERT_EQ(phases.size(), 5u);
+    EXPECT_EQ(phases.front().name, "sort_chunks");
+    for (std::size_t i = 1; i + 1 < phases.size(); ++i) {
+        EXPECT_EQ(phases[i].name, "merge_pass");
+    }
+    EXPECT_EQ(phases.back().name, "final_merge");
+    for (const ext_sort::PhaseTiming& phase : phases) {
+        EXPECT_GE(phase.ms, 0.0);
+    }
+
+    std::sort(input.begin(), input.end());
+    EXPECT_EQ(TapeToVector(out_t), input);
+}
+
+// Узкий диапазон считается плотными счётчиками, широкий с малым числом
+// различных значений - разреженной гистограммой; оба - за один проход
+TEST(MetricsTest, CountingSortPasses) {
+    std::vector<int32_t> narrow = RandomVector(500, 0, 199);
+    VectorTape narrow_in(narrow);
+    VectorTape narrow_out(std::vector<int32_t>(narrow.size(), 0));
+
+    ext_sort::SortProfile dense;
+    ext_sort::CountingSort(narrow_in, narrow_out, 4096, 0, 199, &dense);
+    ASSERT_EQ(dense.Phases().size(), 1u);
+    EXPECT_EQ(dense.Phases()[0].name, "count_window");
+
+    std::vector<int32_t> wide = {1000000000, 0, -1000000000, 0, 1000000000};
+    VectorTape wide_in(wide);
+    VectorTape wide_out(std::vector<int32_t>(wide.size(), 0));
+
+    ext_sort::SortProfile sparse;
+    ext_sort::CountingSort(wide_in, wide_out, 4096, &sparse);
+    ASSERT_EQ(sparse.Phases().size(), 1u);
+    EXPECT_EQ(sparse.Phases()[0].name, "histogram_pass");
+    EXPECT_EQ(TapeToVector(wide_out), (std::vector<int32_t>{-1000000000, 0, 0, 1000000000, 1000000000}));
+}
+
+TEST(MetricsTest, Json) {
+    ext_sort::SortProfile profile;
+    profile.Add("sort_chunks", 1.5, 10);
+    profile.Add("merge_pass", 2, 20);
+
+    TapeMetrics input;
+    input.reads = 3;
+    input.delay_ms = 4;
+
+    std::string json = ext_sort::MetricsJson(profile, {{"input", input}, {"temporary", TapeMetrics{}}}, 30);
+    EXPECT_EQ(json,
+              "{\n"
+              "  \"virtual_ms\": 30,\n"
+              "  \"phases\": [\n"
+              "    {\"name\": \"sort_chunks\", \"ms\": 1.5, \"virtual_ms\": 10},\n"
+              "    {\"name\": \"merge_pass\", \"ms\": 2, \"virtual_ms\": 20}\n"
+              "  ],\n"
+              "  \"tapes\": {\n"
+              "    \"input\": {\"reads\": 3, \"writes\": 0, \"shifts\": 0, \"rewinds\": 0, "
+              "\"buffer_misses\": 0, \"io_calls\": 0, \"bytes_read\": 0, \"bytes_written\": 0, \"delay_ms\": 4},\n"
+              "    \"temporary\": {\"reads\": 0, \"writes\": 0, \"shifts\": 0, \"rewinds\": 0, "
+              "\"buffer_misses\": 0, \"io_calls\": 0, \"bytes_read\": 0, \"bytes_written\": 0, \"delay_ms\": 0}\n"
+              "  }\n"
+              "}\n");
+}
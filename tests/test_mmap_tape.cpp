@@ -0,0 +1,182 @@
+#include "delays.hpp"
+#include "external_sort.hpp"
+#include "mmap_tape.hpp"
+
+#include "helpers.hpp"
+
+#include <cstdint>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+
+using namespace std::chrono_literals;
+
+
+TEST(MmapTapeTest, ReadWriteAndPosition) {
+    const std::string fname = "test_mmap_tape.bin";
+    std::vector<int32_t> initial = {10, 20, 30};
+    WriteIntFile(fname, initial);
+
+    {
+        MmapTape tape(fname, Delays{30, 0, 20, 0});
+        EXPECT_EQ(tape.Size(), initial.size());
+        EXPECT_EQ(tape.Position(), 0u);
+
+        auto t0 = std::chrono::steady_clock::now();
+        EXPECT_EQ(tape.Read(), 10);
+        EXPECT_GE(std::chrono::steady_clock::now() - t0, 30ms);
+
+        t0 = std::chrono::steady_clock::now();
+        EXPECT_TRUE(tape.Next());
+        EXPECT_GE(std::chrono::steady_clock::now() - t0, 20ms);
+        tape.Write(99);
+        EXPECT_EQ(tape.Read(), 99);
+
+        EXPECT_TRUE(tape.Next());
+        EXPECT_FALSE(tape.Next());
+        EXPECT_FALSE(tape.Rewind(-3));
+        EXPECT_TRUE(tape.Rewind(-2));
+        EXPECT_FALSE(tape.Prev());
+    }
+
+    EXPECT_EQ(ReadIntFile(fname), (std::vector<int32_t>{10, 99, 30}));
+}
+
+// Окно меньше файла: произвольные перемещения и запись дают то же, что и вектор
+TEST(MmapTapeTest, WindowedAccessMatchesModel) {
+    const std::string fname = "test_mmap_tape_model.bin";
+    std::vector<int32_t> model = RandomVector(20000, -1000, 1000);
+    WriteIntFile(fname, model);
+
+    {
+        MmapTape tape(fname, Delays{0,0,0,0}, 4096);
+        std::mt19937 gen(11);
+        for (int step = 0; step < 100000; ++step) {
+            std::size_t pos = tape.Position();
+            ASSERT_EQ(tape.Read(), model[pos]);
+            switch (gen() % 8) {
+                case 0:
+                    tape.Write(step);
+                    model[pos] = step;
+                    break;
+                case 1:
+                    tape.Prev();
+                    break;
+                case 2:
+                    tape.Rewind(static_cast<std::ptrdiff_t>(gen() % 4000) - 2000);
+                    break;
+                default:
+                    tape.Next();
+            }
+        }
+        tape.SetMemoryLimit(0);
+        tape.Reset();
+        EXPECT_EQ(TapeToVector(tape), model);
+    }
+
+    EXPECT_EQ(ReadIntFile(fname), model);
+}
+
+TEST(MmapTapeTest, CreateTemporaryAndSort) {
+    std::filesystem::create_directory("tmp");
+    const std::string fname = "test_mmap_tape_sort.bin";
+    std::vector<int32_t> data = RandomVector(50000, -100000, 100000);
+    WriteIntFile(fname, data);
+    WriteIntFile("test_mmap_tape_sorted.bin", std::vector<int32_t>(data.size(), 0));
+
+    MmapTape input(fname, Delays{0,0,0,0});
+    MmapTape output("test_mmap_tape_sorted.bin", Delays{0,0,0,0});
+
+    {
+        auto tmp = input.CreateTemporary(5, 128);
+        EXPECT_EQ(tmp->Size(), 5u);
+        tmp->Rewind(4);
+        tmp->Write(42);
+        EXPECT_EQ(tmp->Read(), 42);
+    }
+
+    ext_sort::ChunkMergeSort(input, output, 16384, false);
+
+    std::vector<int32_t> expected = data;
+    std::sort(expected.begin(), expected.end());
+    EXPECT_EQ(TapeToVector(output), expected);
+
+    // Параллельное слияние через участки отображения
+    WriteIntFile("test_mmap_tape_sorted_parallel.bin", std::vector<int32_t>(data.size(), 0));
+    MmapTape parallel_output("test_mmap_tape_sorted_parallel.bin", Delays{0,0,0,0});
+    ext_sort::ChunkMergeSort(input, parallel_output, 16384, ext_sort::RunFormation::Sort, 4);
+    EXPECT_EQ(TapeToVector(parallel_output), expected);
+}
+
+TEST(MmapTapeTest, BlockReadWriteAcrossWindows) {
+    const std::string fname = "test_mmap_tape_block.bin";
+    std::vector<int32_t> initial = RandomVector(5000, -100, 100);
+    WriteIntFile(fname, initial);
+
+    MmapTape tape(fname, Delays{0,0,0,0}, 4096);
+    std::vector<int32_t> block(3000);
+    tape.Rewind(500);
+    EXPECT_EQ(tape.ReadBlock(block.data(), 3000), 3000u);
+    EXPECT_EQ(tape.Position(), 3500u);
+    EXPECT_TRUE(std::equal(block.begin(), block.end(), initial.begin() + 500));
+
+    std::fill(block.begin(), block.end(), 7);
+    EXPECT_EQ(tape.WriteBlock(block.data(), 3000), 1500u);
+    EXPECT_EQ(tape.Position(), 4999u);
+    std::fill(initial.begin() + 3500, initial.end(), 7);
+    tape.Reset();
+    EXPECT_EQ(TapeToVector(tape), initial);
+}
+
+TEST(MmapTapeTest, BlockReadBackwardAcrossWindows) {
+    const std::string fname = "test_mmap_tape_block_backward.bin";
+    std::vector<int32_t> initial = RandomVector(5000, -100, 100);
+    WriteIntFile(fname, initial);
+
+    MmapTape tape(fname, Delays{0,0,0,0}, 4096);
+    std::vector<int32_t> block(3000);
+    tape.Rewind(4999);
+    EXPECT_EQ(tape.ReadBlockBackward(block.data(), 3000), 3000u);
+    EXPECT_EQ(tape.Position(), 1999u);
+    EXPECT_TRUE(std::equal(block.begin(), block.end(), initial.rbegin()));
+
+    EXPECT_EQ(tape.ReadBlockBackward(block.data(), 3000), 2000u);
+    EXPECT_EQ(tape.Position(), 0u);
+    EXPECT_TRUE(std::equal(block.begin(), block.begin() + 2000, initial.rend() - 2000));
+}
+
+TEST(MmapTapeTest, SectionAtUnalignedOffset) {
+    const std::string fname = "test_mmap_tape_section.bin";
+    std::vector<int32_t> initial = RandomVector(5000, -100, 100);
+    WriteIntFile(fname, initial);
+
+    {
+        MmapTape tape(fname, Delays{0,0,0,0}, 4096);
+        auto section = tape.OpenSection(1234, 2000, 4096);
+        EXPECT_EQ(section->Size(), 2000u);
+        EXPECT_EQ(TapeToVector(*section),
+                  std::vector<int32_t>(initial.begin() + 1234, initial.begin() + 3234));
+
+        // Назад через границу окна и страницы
+        section->Reset();
+        section->Rewind(1999);
+        for (int i = 0; i < 1500; ++i) {
+            section->Write(-i);
+            initial[1234 + 1999 - i] = -i;
+            section->Prev();
+        }
+
+        std::vector<int32_t> block(3000, 9);
+        section->Reset();
+        EXPECT_EQ(section->WriteBlock(block.data(), 3000), 2000u);
+        std::fill(initial.begin() + 1234, initial.begin() + 3234, 9);
+    }
+
+    EXPECT_EQ(ReadIntFile(fname), initial);
+}
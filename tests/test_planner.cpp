@@ -0,0 +1,152 @@
+#include "planner.hpp"
+
+#include "vector_tape.hpp"
+#include "helpers.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+
+namespace {
+    // Миллион элементов, 1 МиБ памяти: 8 чанков по 128 Ки элементов
+    ext_sort::PlanInput millionElements(const Delays& delays, std::vector<int32_t> sample) {
+        return ext_sort::PlanInput{
+            delays, 1024 * 1024, 1000000, 16, 1, ext_sort::RunFormation::Sort,
+            std::nullopt, std::nullopt, std::move(sample)
+        };
+    }
+} // namespace
+
+// Мало различных значений - подсчёт за один проход
+TEST(PlannerTest, FewDistinctValuesPreferCounting) {
+    std::vector<int32_t> sample = RandomVector(4096, 0, 9);
+
+    ext_sort::SortPlan plan = ext_sort::ChoosePlan(millionElements(Delays{1, 1, 0, 10}, sample));
+    EXPECT_EQ(plan.strategy, ext_sort::Strategy::Counting);
+    EXPECT_EQ(plan.passes, 1u);
+}
+
+TEST(PlannerTest, PlansSortedByCost) {
+    std::vector<int32_t> sample = RandomVector(4096, -1000000000, 1000000000);
+    std::vector<ext_sort::SortPlan> plans = ext_sort::EstimatePlans(millionElements(Delays{1, 1, 0, 10}, sample));
+
+    ASSERT_GT(plans.size(), 3u);
+    for (std::size_t i = 1; i < plans.size(); ++i) {
+        EXPECT_LE(plans[i - 1].tape_ms, plans[i].tape_ms);
+    }
+    // Попарное слияние 8 серий - три прохода (последний - сразу в выходную ленту),
+    // k-путевое - один
+    auto chunk = std::find_if(plans.begin(), plans.end(), [](const ext_sort::SortPlan& p) {
+        return p.strategy == ext_sort::Strategy::ChunkMerge && p.formation == ext_sort::RunFormation::Sort;
+    });
+    ASSERT_NE(chunk, plans.end());
+    EXPECT_EQ(chunk->runs, 8u);
+    EXPECT_EQ(chunk->passes, 4u);
+    EXPECT_EQ(plans.front().strategy, ext_sort::Strategy::KWayMerge);
+    EXPECT_EQ(plans.front().passes, 2u);
+
+}
+
+// Упорядоченная выборка и естественные серии - один проход копирования
+TEST(PlannerTest, NaturalRunsOnPresortedInput) {
+    std::vector<int32_t> sample = RandomVector(4096, -1000000000, 1000000000);
+    std::sort(sample.rbegin(), sample.rend());
+    ext_sort::PlanInput input = millionElements(Delays{1, 1, 0, 10}, sample);
+    input.formation = ext_sort::RunFormation::NaturalRuns;
+
+    ext_sort::SortPlan plan = ext_sort::ChoosePlan(input);
+    EXPECT_EQ(plan.formation, ext_sort::RunFormation::NaturalRuns);
+    EXPECT_EQ(plan.runs, 1u);
+    EXPECT_EQ(plan.passes, 1u);
+}
+
+// Попарное слияние без перемоток между проходами: проходов столько же, но дешевле
+TEST(PlannerTest, AlternatingMergeSavesRewinds) {
+    std::vector<int32_t> sample = RandomVector(4096, -1000000000, 1000000000);
+    std::vector<ext_sort::SortPlan> plans = ext_sort::EstimatePlans(millionElements(Delays{1, 1, 1, 10}, sample));
+
+    auto find = [&plans](ext_sort::Strategy strategy) {
+        return std::find_if(plans.begin(), plans.end(), [strategy](const ext_sort::SortPlan& p) {
+            return p.strategy == strategy && p.formation == ext_sort::RunFormation::Sort;
+        });
+    };
+    auto chunk = find(ext_sort::Strategy::ChunkMerge);
+    auto alternating = find(ext_sort::Strategy::AlternatingMerge);
+    ASSERT_NE(chunk, plans.end());
+    ASSERT_NE(alternating, plans.end());
+    EXPECT_EQ(alternating->passes, chunk->passes);
+    EXPECT_DOUBLE_EQ(alternating->moved, chunk->moved);
+    EXPECT_LT(alternating->tape_ms, chunk->tape_ms);
+}
+
+// Около 20000 различных значений: подсчёт за два прохода, как и k-путевое слияние
+// четырёх серий выбора с замещением. Решают перемотки: подсчёт перематывает
+// ленты длиной во весь вход, слияние - ленты вчетверо короче, но их больше
+TEST(PlannerTest, RewindCostFlipsTheChoice) {
+    std::vector<int32_t> sample = RandomVector(4096, 0, 19999);
+
+    ext_sort::SortPlan fast_rewind = ext_sort::ChoosePlan(millionElements(Delays{1, 1, 1, 10}, sample));
+    EXPECT_EQ(fast_rewind.strategy, ext_sort::Strategy::Counting);
+    EXPECT_EQ(fast_rewind.passes, 2u);
+
+    // Перемотка не быстрее сдвигов
+    ext_sort::SortPlan slow_rewind = ext_sort::ChoosePlan(millionElements(Delays{1, 1, 1, 1000000000}, sample));
+    EXPECT_EQ(slow_rewind.strategy, ext_sort::Strategy::KWayMerge);
+    EXPECT_EQ(slow_rewind.formation, ext_sort::RunFormation::ReplacementSelection);
+    EXPECT_EQ(slow_rewind.passes, 2u);
+}
+
+// Упорядоченная выборка - выбор с замещением даст одну серию
+TEST(PlannerTest, SortedSampleUsesReplacementSelection) {
+    std::vector<int32_t> data(100000);
+    for (std::size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<int32_t>(i);
+    }
+    VectorTape tape(data);
+    tape.Rewind(500);
+
+    std::vector<int32_t> sample = ext_sort::SampleTape(tape, 4096);
+    EXPECT_EQ(sample.size(), 4096u);
+    EXPECT_EQ(tape.Position(), 0u);
+
+    ext_sort::PlanInput input{
+        Delays{1, 1, 0, 10}, 64 * 1024, data.size(), 16, 1, ext_sort::RunFormation::Sort,
+        std::nullopt, std::nullopt, sample
+    };
+    ext_sort::SortPlan plan = ext_sort::ChoosePlan(input);
+    EXPECT_NE(plan.strategy, ext_sort::Strategy::Counting);
+    EXPECT_EQ(plan.formation, ext_sort::RunFormation::ReplacementSelection);
+    EXPECT_EQ(plan.runs, 1u);
+}
+
+// Выборка - по всей ленте, а не с её начала: упорядоченное начало
+// не выдаёт вход за упорядоченный
+TEST(PlannerTest, SampleSpansWholeTape) {
+    std::vector<int32_t> data(100000);
+    for (std::size_t i = 0; i < 50000; ++i) {
+        data[i] = static_cast<int32_t>(i);
+    }
+    std::vector<int32_t> tail = RandomVector(50000, -1000000000, 1000000000);
+    std::copy(tail.begin(), tail.end(), data.begin() + 50000);
+    VectorTape tape(data);
+
+    std::vector<int32_t> sample = ext_sort::SampleTape(tape, 4096);
+    EXPECT_EQ(sample.size(), 4096u);
+    EXPECT_EQ(tape.Position(), 0u);
+    EXPECT_TRUE(std::is_sorted(sample.begin(), sample.begin() + 2000));
+    EXPECT_FALSE(std::is_sorted(sample.begin(), sample.end()));
+
+    ext_sort::PlanInput input{
+        Delays{1, 1, 0, 10}, 64 * 1024, data.size(), 16, 1, ext_sort::RunFormation::NaturalRuns,
+        std::nullopt, std::nullopt, sample
+    };
+    ext_sort::SortPlan plan = ext_sort::ChoosePlan(input);
+    EXPECT_GT(plan.runs, 1u);
+    EXPECT_GT(plan.passes, 1u);
+
+    // Лента короче выборки читается целиком
+    VectorTape short_tape({3, 1, 2});
+    EXPECT_EQ(ext_sort::SampleTape(short_tape, 4096), (std::vector<int32_t>{3, 1, 2}));
+}
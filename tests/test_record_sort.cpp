@@ -0,0 +1,280 @@
+#include "file_tape.hpp"
+#include "record.hpp"
+#include "record_sort.hpp"
+#include "record_tape.hpp"
+
+#include "helpers.hpp"
+#include "vector_tape.hpp"
+
+#include <cstdint>
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <limits>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+
+namespace {
+    // Сортирует записи через файлы и RecordFileTape
+    template <typename Record, typename KeyOf>
+    std::vector<Record> sortRecords(const std::vector<Record>& data, std::size_t memory_limit,
+                                    ext_sort::MergeStats* stats = nullptr, bool stable = false) {
+        std::filesystem::create_directory("tmp");
+        const std::string in_name = "test_records_in.bin";
+        const std::string out_name = "test_records_out.bin";
+        WriteRecordFile(in_name, data);
+        WriteRecordFile(out_name, std::vector<Record>(data.size()));
+        {
+            RecordFileTape<Record> input(in_name, Delays{0, 0, 0, 0});
+            RecordFileTape<Record> output(out_name, Delays{0, 0, 0, 0});
+            ext_sort::MergeStats result = ext_sort::RecordMergeSort<Record, KeyOf>(input, output, memory_limit, 6,
+                                                                                       stable);
+            if (stats) {
+                *stats = result;
+            }
+        }
+        std::vector<Record> sorted = ReadRecordFile<Record>(out_name);
+        std::filesystem::remove(in_name);
+        std::filesystem::remove(out_name);
+        return sorted;
+    }
+} // namespace
+
+// Полный порядок IEEE 754: знак нуля и NaN тоже упорядочены
+TEST(RecordSortTest, FloatKeysTotalOrder) {
+    const double inf = std::numeric_limits<double>::infinity();
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    std::vector<double> ordered = {-nan, -inf, -1e300, -1.5, -0.0, 0.0, 1e-300, 2.5, inf, nan};
+
+    ext_sort::ScalarKey<double> key;
+    for (std::size_t i = 1; i < ordered.size(); ++i) {
+        EXPECT_LT(key(ordered[i - 1]), key(ordered[i])) << i;
+    }
+
+    ext_sort::ScalarKey<float> float_key;
+    EXPECT_LT(float_key(-2.0f), float_key(-1.0f));
+    EXPECT_LT(float_key(-0.0f), float_key(0.0f));
+    EXPECT_LT(float_key(1.0f), float_key(std::numeric_limits<float>::infinity()));
+}
+
+// Нагрузка переезжает вместе с ключом, проходов слияния больше одного
+TEST(RecordSortTest, KeyValueRecords) {
+    std::mt19937_64 gen(2025);
+    std::vector<ext_sort::KeyValue64> data(20000);
+    for (std::size_t i = 0; i < data.size(); ++i) {
+        data[i] = {gen() % 5000, i};
+    }
+
+    ext_sort::MergeStats stats;
+    auto sorted = sortRecords<ext_sort::KeyValue64, ext_sort::KeyValue64Key>(data, 4096, &stats);
+    EXPECT_GT(stats.passes, 1u);
+    EXPECT_EQ(stats.fan_in, 3u);
+
+    ASSERT_EQ(sorted.size(), data.size());
+    for (std::size_t i = 1; i < sorted.size(); ++i) {
+        EXPECT_LE(sorted[i - 1].key, sorted[i].key);
+    }
+    for (const ext_sort::KeyValue64& record : sorted) {
+        EXPECT_EQ(record.key, data[record.value].key);
+    }
+}
+
+TEST(RecordSortTest, ScalarRecords) {
+    std::mt19937_64 gen(7);
+    std::vector<int64_t> ints(5000);
+    for (int64_t& v : ints) {
+        v = static_cast<int64_t>(gen());
+    }
+    std::vector<int64_t> expected_ints = ints;
+    std::sort(expected_ints.begin(), expected_ints.end());
+    EXPECT_EQ((sortRecords<int64_t, ext_sort::ScalarKey<int64_t>>(ints, 1024)), expected_ints);
+
+    std::uniform_real_distribution<double> dist(-1e6, 1e6);
+    std::vector<double> doubles(5000);
+    for (double& v : doubles) {
+        v = dist(gen);
+    }
+    std::vector<double> expected_doubles = doubles;
+    std::sort(expected_doubles.begin(), expected_doubles.end());
+    EXPECT_EQ((sortRecords<double, ext_sort::ScalarKey<double>>(doubles, 1024)), expected_doubles);
+
+    // Всё помещается в память
+    std::vector<uint64_t> small = {5, 1, std::numeric_limits<uint64_t>::max(), 0};
+    EXPECT_EQ((sortRecords<uint64_t, ext_sort::ScalarKey<uint64_t>>(small, 1024)),
+              (std::vector<uint64_t>{0, 1, 5, std::numeric_limits<uint64_t>::max()}));
+    EXPECT_TRUE((sortRecords<uint64_t, ext_sort::ScalarKey<uint64_t>>({}, 1024)).empty());
+}
+
+// Ключ из байтов сравнивается как memcmp, нагрузка не влияет на порядок
+TEST(RecordSortTest, ByteKeys) {
+    using Record = ext_sort::BytesRecord<3, 5>;
+    std::mt19937 gen(3);
+    std::vector<Record> data(3000);
+    for (Record& record : data) {
+        for (uint8_t& b : record.bytes) {
+            b = static_cast<uint8_t>(gen());
+        }
+    }
+
+    auto sorted = sortRecords<Record, ext_sort::BytesKey<3>>(data, 512);
+    ASSERT_EQ(sorted.size(), data.size());
+    ext_sort::BytesKey<3> key;
+    EXPECT_TRUE(std::is_sorted(sorted.begin(), sorted.end(),
+                               [&key](const Record& a, const Record& b) { return key(a) < key(b); }));
+    auto bytes_less = [](const Record& a, const Record& b) { return a.bytes < b.bytes; };
+    std::sort(data.begin(), data.end(), bytes_less);
+    std::sort(sorted.begin(), sorted.end(), bytes_less);
+    EXPECT_TRUE(std::equal(data.begin(), data.end(), sorted.begin(),
+                           [](const Record& a, const Record& b) { return a.bytes == b.bytes; }));
+}
+
+TEST(RecordSortTest, InvalidFileSize) {
+    const std::string fname = "test_records_odd.bin";
+    WriteIntFile(fname, {1, 2, 3});
+    EXPECT_THROW(RecordFileTape<int64_t>(fname, Delays{0, 0, 0, 0}), std::runtime_error);
+    std::filesystem::remove(fname);
+}
+
+// Равные ключи в stable-режиме остаются в порядке входа (нагрузка - исходный индекс)
+TEST(RecordSortTest, StableKeepsInputOrder) {
+    std::mt19937_64 gen(11);
+    std::vector<ext_sort::KeyValue64> data(20000);
+    for (std::size_t i = 0; i < data.size(); ++i) {
+        data[i] = {gen() % 50, i};
+    }
+
+    ext_sort::MergeStats stats;
+    auto sorted = sortRecords<ext_sort::KeyValue64, ext_sort::KeyValue64Key>(data, 4096, &stats, true);
+    EXPECT_GT(stats.passes, 1u);
+    ASSERT_EQ(sorted.size(), data.size());
+    for (std::size_t i = 1; i < sorted.size(); ++i) {
+        ASSERT_LE(sorted[i - 1].key, sorted[i].key);
+        if (sorted[i - 1].key == sorted[i].key) {
+            EXPECT_LT(sorted[i - 1].value, sorted[i].value) << i;
+        }
+    }
+}
+
+// Позиции - перестановка входа: values[positions[i]] == output[i], у равных - по возрастанию
+TEST(RecordSortTest, ArgSort) {
+    std::filesystem::create_directory("tmp");
+    const std::string in_name = "test_argsort_in.bin";
+    const std::string out_name = "test_argsort_out.bin";
+    const std::string pos_name = "test_argsort_pos.bin";
+    std::vector<int32_t> data = RandomVector(10000, -100, 100);
+    WriteIntFile(in_name, data);
+    WriteIntFile(out_name, std::vector<int32_t>(data.size()));
+    WriteRecordFile(pos_name, std::vector<uint64_t>(data.size()));
+
+    const Delays delays{0, 0, 0, 0};
+    ext_sort::MergeStats stats;
+    {
+        FileTape input(in_name, delays, 1024);
+        FileTape output(out_name, delays);
+        RecordFileTape<uint64_t> positions(pos_name, delays);
+        auto sink = std::make_shared<MetricsSink>();
+        ext_sort::TemporaryFactory<ext_sort::IndexedValue> make_temporary =
+            [&delays, sink](std::size_t size, std::size_t buffer_bytes) {
+                return RecordFileTape<ext_sort::IndexedValue>::CreateTemporaryFile("argsort", size, buffer_bytes,
+                                                                                   delays, sink);
+            };
+        stats = ext_sort::ArgSort(input, output, positions, 4096, 6, make_temporary);
+        EXPECT_GT(sink->Total().writes, 0u);
+    }
+    EXPECT_GT(stats.passes, 1u);
+
+    std::vector<int32_t> sorted = ReadIntFile(out_name);
+    std::vector<uint64_t> positions = ReadRecordFile<uint64_t>(pos_name);
+    std::vector<int32_t> expected = data;
+    std::sort(expected.begin(), expected.end());
+    EXPECT_EQ(sorted, expected);
+    ASSERT_EQ(positions.size(), data.size());
+    for (std::size_t i = 0; i < positions.size(); ++i) {
+        ASSERT_LT(positions[i], data.size());
+        EXPECT_EQ(data[positions[i]], sorted[i]);
+        if (i > 0 && sorted[i - 1] == sorted[i]) {
+            EXPECT_LT(positions[i - 1], positions[i]) << i;
+        }
+    }
+
+    std::filesystem::remove(in_name);
+    std::filesystem::remove(out_name);
+    std::filesystem::remove(pos_name);
+}
+
+// Только различные значения: повторы объединяются уже в сериях, поэтому
+// на малом числе различных значений слияние переносит меньше входа
+TEST(RecordSortTest, GroupSortDistinct) {
+    for (int32_t spread : {20, 5000, std::numeric_limits<int32_t>::max()}) {
+        std::vector<int32_t> data = RandomVector(20000, -spread, spread);
+        std::vector<int32_t> expected = data;
+        std::sort(expected.begin(), expected.end());
+        expected.erase(std::unique(expected.begin(), expected.end()), expected.end());
+
+        for (std::size_t memory_limit : {256, 4096, 1024 * 1024}) {
+            VectorTape input(data);
+            VectorTape output(std::vector<int32_t>(data.size(), 0));
+            ext_sort::MergeStats stats = ext_sort::GroupSort(input, output, nullptr, memory_limit, 6, nullptr);
+            ASSERT_EQ(stats.output_elements, expected.size()) << spread << " " << memory_limit;
+            std::vector<int32_t> result = TapeToVector(output);
+            result.resize(stats.output_elements);
+            EXPECT_EQ(result, expected);
+            if (spread == 20 && memory_limit == 4096) {
+                EXPECT_GT(stats.passes, 1u);
+                EXPECT_LT(stats.merged_elements, data.size());
+            }
+        }
+    }
+}
+
+// Значения со счётчиками (sort | uniq -c) через временные ленты записей ValueCount
+TEST(RecordSortTest, GroupSortCounts) {
+    std::filesystem::create_directory("tmp");
+    const std::string counts_name = "test_group_counts.bin";
+    std::vector<int32_t> data = RandomVector(20000, -300, 300);
+    std::map<int32_t, uint64_t> expected;
+    for (int32_t v : data) {
+        ++expected[v];
+    }
+
+    const Delays delays{0, 0, 0, 0};
+    for (std::size_t memory_limit : {512, 4096, 1024 * 1024}) {
+        WriteRecordFile(counts_name, std::vector<uint64_t>(data.size()));
+        VectorTape input(data);
+        VectorTape output(std::vector<int32_t>(data.size(), 0));
+        ext_sort::MergeStats stats;
+        auto sink = std::make_shared<MetricsSink>();
+        {
+            RecordFileTape<uint64_t> counts(counts_name, delays);
+            ext_sort::TemporaryFactory<ext_sort::ValueCount> make_temporary =
+                [&delays, sink](std::size_t size, std::size_t buffer_bytes) {
+                    return RecordFileTape<ext_sort::ValueCount>::CreateTemporaryFile("group", size, buffer_bytes,
+                                                                                     delays, sink);
+                };
+            stats = ext_sort::GroupSort(input, output, &counts, memory_limit, 6, make_temporary);
+        }
+        ASSERT_EQ(stats.output_elements, expected.size());
+        if (memory_limit == 4096) {
+            EXPECT_GT(stats.passes, 1u);
+            // Без объединения серии и промежуточные проходы записали бы passes * N записей
+            EXPECT_LT(sink->Total().writes, stats.passes * data.size() / 2);
+            EXPECT_LT(stats.merged_elements, stats.passes * data.size() / 2);
+        }
+
+        std::vector<int32_t> values = TapeToVector(output);
+        std::vector<uint64_t> counts = ReadRecordFile<uint64_t>(counts_name);
+        std::size_t i = 0;
+        for (const auto& [value, count] : expected) {
+            EXPECT_EQ(values[i], value) << i;
+            EXPECT_EQ(counts[i], count) << i;
+            ++i;
+        }
+    }
+    std::filesystem::remove(counts_name);
+}
@@ -0,0 +1,140 @@
+#include "stream_sort.hpp"
+#include "stream_tape.hpp"
+#include "temp_pool.hpp"
+
+#include "helpers.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace {
+
+// Поток с содержимым файла filename, как stdin
+std::unique_ptr<std::FILE, int (*)(std::FILE*)> OpenRead(const std::string& filename) {
+    return {std::fopen(filename.c_str(), "rb"), &std::fclose};
+}
+
+std::unique_ptr<std::FILE, int (*)(std::FILE*)> OpenWrite(const std::string& filename) {
+    return {std::fopen(filename.c_str(), "wb"), &std::fclose};
+}
+
+// Сортирует data через потоковые ленты и возвращает выход и статистику
+std::vector<int32_t> StreamSort(const std::vector<int32_t>& data, std::size_t memory,
+                                std::size_t max_tapes, ext_sort::MergeStats& stats,
+                                TapeMetrics& temporary,
+                                ext_sort::RunFormation formation = ext_sort::RunFormation::Sort) {
+    WriteIntFile("test_stream_in.bin", data);
+    auto pool = std::make_shared<TempTapePool>("tmp/test_stream");
+    {
+        auto in = OpenRead("test_stream_in.bin");
+        auto out = OpenWrite("test_stream_out.bin");
+        StreamInputTape in_t(in.get());
+        StreamOutputTape out_t(out.get());
+        stats = ext_sort::StreamMergeSort(in_t, out_t, memory, formation, max_tapes,
+                                          pool, Delays{0, 0, 0, 0});
+        EXPECT_EQ(in_t.Size(), data.size());
+        EXPECT_EQ(out_t.Size(), data.size());
+        temporary = in_t.TemporaryMetrics();
+    }
+    // Накопитель серий удалён, временные ленты вернулись в пул
+    EXPECT_EQ(std::distance(std::filesystem::directory_iterator("tmp/test_stream"),
+                            std::filesystem::directory_iterator()),
+              static_cast<std::ptrdiff_t>(pool->Files()));
+    return ReadIntFile("test_stream_out.bin");
+}
+
+} // namespace
+
+// Чтение блоками и по ячейке: размер растёт по мере чтения, запись копится до Flush
+TEST(StreamTapeTest, ReadAndWrite) {
+    std::vector<int32_t> data = RandomVector(1000, -100, 100);
+    WriteIntFile("test_stream_in.bin", data);
+
+    auto in = OpenRead("test_stream_in.bin");
+    auto out = OpenWrite("test_stream_out.bin");
+    StreamInputTape in_t(in.get(), 64);
+    StreamOutputTape out_t(out.get(), 64);
+    std::vector<int32_t> block(300);
+
+    EXPECT_EQ(in_t.Read(), data[0]);
+    EXPECT_EQ(in_t.Size(), 16u);
+    EXPECT_TRUE(in_t.Next());
+    EXPECT_THROW(in_t.Reset(), std::runtime_error);
+    EXPECT_FALSE(in_t.Prev());
+    EXPECT_THROW(in_t.ReadBlockBackward(block.data(), 1), std::runtime_error);
+    EXPECT_THROW(in_t.Write(1), std::runtime_error);
+    out_t.Write(data[0]);
+
+    std::size_t read = 1;
+    while (std::size_t got = in_t.ReadBlock(block.data(), block.size())) {
+        out_t.WriteBlock(block.data(), got);
+        read += got;
+    }
+    EXPECT_EQ(read, data.size());
+    EXPECT_TRUE(in_t.Exhausted());
+    EXPECT_EQ(in_t.Size(), data.size());
+    EXPECT_EQ(in_t.Position(), data.size());
+    EXPECT_THROW(in_t.Read(), std::runtime_error);
+
+    EXPECT_EQ(out_t.Size(), data.size());
+    EXPECT_THROW(out_t.Read(), std::runtime_error);
+    out_t.Flush();
+    EXPECT_EQ(ReadIntFile("test_stream_out.bin"), data);
+    EXPECT_EQ(out_t.Metrics().writes, data.size());
+    EXPECT_EQ(out_t.Metrics().bytes_written, data.size() * sizeof(int32_t));
+}
+
+// Поток, оборванный посреди ячейки, - ошибка, а не тихая потеря байтов
+TEST(StreamTapeTest, TruncatedCell) {
+    WriteIntFile("test_stream_in.bin", {1, 2, 3});
+    std::filesystem::resize_file("test_stream_in.bin", 10);
+
+    auto in = OpenRead("test_stream_in.bin");
+    StreamInputTape in_t(in.get());
+    std::vector<int32_t> block(8);
+    EXPECT_THROW(in_t.ReadBlock(block.data(), block.size()), std::runtime_error);
+}
+
+// Вход уместился в память: сортировка сразу в выход, без временных файлов
+TEST(StreamMergeSortTest, InMemory) {
+    std::vector<int32_t> data = RandomVector(200, -1000, 1000);
+    std::vector<int32_t> expected = data;
+    std::sort(expected.begin(), expected.end());
+
+    ext_sort::MergeStats stats;
+    TapeMetrics temporary;
+    EXPECT_EQ(StreamSort(data, 4096, 4, stats, temporary), expected);
+    EXPECT_EQ(stats.runs, 1u);
+    EXPECT_EQ(stats.passes, 0u);
+    EXPECT_EQ(temporary.bytes_written, 0u);
+
+    EXPECT_TRUE(StreamSort({}, 4096, 4, stats, temporary).empty());
+    EXPECT_EQ(stats.runs, 0u);
+}
+
+// Серий больше, чем сливается за раз: промежуточные проходы и последний - в выход
+TEST(StreamMergeSortTest, MultiPass) {
+    std::vector<int32_t> data = RandomVector(20000, -5000, 5000);
+    std::vector<int32_t> expected = data;
+    std::sort(expected.begin(), expected.end());
+
+    for (auto formation : {ext_sort::RunFormation::Sort, ext_sort::RunFormation::RadixSort,
+                           ext_sort::RunFormation::ReplacementSelection}) {
+        ext_sort::MergeStats stats;
+        TapeMetrics temporary;
+        EXPECT_EQ(StreamSort(data, 1024, 4, stats, temporary, formation), expected);
+        EXPECT_EQ(stats.fan_in, 2u); // при такой памяти - попарно
+        EXPECT_GT(stats.runs, stats.fan_in * stats.fan_in);
+        EXPECT_GE(stats.passes, 3u);
+        EXPECT_EQ(stats.merged_elements, stats.passes * data.size());
+        // Накопитель серий и каждый промежуточный проход
+        EXPECT_EQ(temporary.writes, stats.passes * data.size());
+    }
+}
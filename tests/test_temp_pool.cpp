@@ -0,0 +1,175 @@
+#include "external_sort.hpp"
+#include "file_tape.hpp"
+#include "mmap_tape.hpp"
+#include "record.hpp"
+#include "record_tape.hpp"
+#include "temp_pool.hpp"
+
+#include "helpers.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <sys/stat.h>
+
+namespace {
+    // Сколько байт файл занимает на диске
+    std::size_t diskUsage(const std::string& path) {
+        struct stat st{};
+        ::stat(path.c_str(), &st);
+        return static_cast<std::size_t>(st.st_blocks) * 512;
+    }
+} // namespace
+
+
+// Свободный файл выдаётся повторно, недостающий - удлиняется или создаётся
+TEST(TempTapePoolTest, AcquireAndRelease) {
+    std::string first;
+    {
+        TempTapePool pool("tmp/test_pool", 2, 4096);
+        EXPECT_EQ(pool.Files(), 2u);
+        EXPECT_EQ(pool.DiskBytes(), 8192u);
+
+        first = pool.Acquire(100);
+        EXPECT_EQ(std::filesystem::file_size(first), 4096u);
+        EXPECT_EQ(pool.Reused(), 1u);
+
+        // Подходящих свободных нет: удлиняется второй
+        std::string second = pool.Acquire(5000);
+        EXPECT_NE(second, first);
+        EXPECT_EQ(std::filesystem::file_size(second), 5000u);
+        EXPECT_EQ(pool.Reused(), 1u);
+
+        std::string third = pool.Acquire(10);
+        EXPECT_EQ(pool.Files(), 3u);
+        EXPECT_EQ(pool.DiskBytes(), 4096u + 5000u + 16u);
+
+        // Место на диске выделено только заранее созданным файлам,
+        // новые и удлинённые - с дырой
+        std::string big = pool.Acquire(64u << 20);
+        EXPECT_EQ(std::filesystem::file_size(big), 64u << 20);
+        EXPECT_LT(diskUsage(big), 1u << 20);
+        pool.Release(big);
+
+        // Из свободных выбирается наименьший подходящий
+        pool.Release(second);
+        pool.Release(first);
+        EXPECT_EQ(pool.Acquire(3000), first);
+        EXPECT_EQ(pool.Reused(), 2u);
+
+        EXPECT_THROW(pool.Release("tmp/test_pool/unknown.bin"), std::runtime_error);
+        EXPECT_TRUE(std::filesystem::exists(third));
+    }
+    EXPECT_FALSE(std::filesystem::exists(first));
+}
+
+// Потоки одновременно берут файлы: занятые файлы не выдаются второй раз
+TEST(TempTapePoolTest, ConcurrentAcquire) {
+    TempTapePool pool("tmp/test_pool", 4, 1024);
+
+    std::vector<std::future<std::vector<std::string>>> running;
+    for (int t = 0; t < 4; ++t) {
+        running.push_back(std::async(std::launch::async, [&pool] {
+            std::vector<std::string> held;
+            for (int i = 0; i < 50; ++i) {
+                std::string a = pool.Acquire(512);
+                std::string b = pool.Acquire(2048);
+                held.push_back(a + " " + b);
+                pool.Release(a);
+                pool.Release(b);
+            }
+            held.push_back(pool.Acquire(100));
+            return held;
+        }));
+    }
+
+    std::set<std::string> last;
+    for (auto& r : running) {
+        std::vector<std::string> held = r.get();
+        last.insert(held.back());
+        for (std::size_t i = 0; i + 1 < held.size(); ++i) {
+            std::string a = held[i].substr(0, held[i].find(' '));
+            EXPECT_NE(a, held[i].substr(held[i].find(' ') + 1));
+        }
+    }
+    EXPECT_EQ(last.size(), 4u);
+    EXPECT_LE(pool.Files(), 8u);
+}
+
+// Вторая сортировка с тем же пулом не создаёт файлов: все временные ленты - из пула
+TEST(TempTapePoolTest, SortsReuseFiles) {
+    std::vector<int32_t> input = RandomVector(5000, -1000, 1000);
+    std::vector<int32_t> expected = input;
+    std::sort(expected.begin(), expected.end());
+
+    auto pool = std::make_shared<TempTapePool>("tmp/test_pool");
+    std::size_t files = 0;
+    for (int sort = 0; sort < 2; ++sort) {
+        WriteIntFile("test_pool_in.bin", input);
+        WriteIntFile("test_pool_out.bin", std::vector<int32_t>(input.size(), 0));
+        {
+            FileTape in_t("test_pool_in.bin", Delays{0, 0, 0, 0});
+            FileTape out_t("test_pool_out.bin", Delays{0, 0, 0, 0});
+            in_t.SetTemporaryPool(pool);
+            ext_sort::ChunkMergeSort(in_t, out_t, 1024, ext_sort::RunFormation::Sort, 2);
+        }
+        EXPECT_EQ(ReadIntFile("test_pool_out.bin"), expected);
+
+        // Попарное слияние держит четыре временные ленты всю сортировку
+        if (sort == 0) {
+            files = pool->Files();
+            EXPECT_EQ(files, 4u);
+            EXPECT_EQ(pool->Reused(), 0u);
+        } else {
+            EXPECT_EQ(pool->Files(), files);
+            EXPECT_EQ(pool->Reused(), files);
+        }
+    }
+    EXPECT_EQ(pool->DiskBytes(), files * input.size() * sizeof(int32_t));
+}
+
+// Временные ленты MmapTape, CompressedTape и RecordFileTape тоже создаются в каталоге пула
+TEST(TempTapePoolTest, AllTapesUsePool) {
+    auto pool = std::make_shared<TempTapePool>("tmp/test_pool_all");
+    WriteIntFile("test_pool_all.bin", std::vector<int32_t>(100, 1));
+
+    {
+        MmapTape origin("test_pool_all.bin", Delays{0, 0, 0, 0});
+        origin.SetTemporaryPool(pool);
+        auto tmp = origin.CreateTemporary(5, 0);
+        EXPECT_EQ(tmp->Size(), 5u);
+        tmp->Write(42);
+        EXPECT_EQ(tmp->Read(), 42);
+        EXPECT_EQ(pool->Files(), 1u);
+    }
+
+    // Файл на 5 ячеек int32 (24 байта) не кратен записи KeyValue64 и всё равно выдаётся
+    {
+        auto tmp = RecordFileTape<ext_sort::KeyValue64>::CreateTemporaryFile("test", 1, 0, Delays{0, 0, 0, 0},
+                                                                   std::make_shared<MetricsSink>(), pool);
+        EXPECT_EQ(tmp->Size(), 1u);
+        tmp->Write(ext_sort::KeyValue64{7, 8});
+        EXPECT_EQ(tmp->Read().key, 7u);
+        EXPECT_EQ(pool->Files(), 1u);
+        EXPECT_EQ(pool->Reused(), 1u);
+    }
+
+    {
+        FileTape origin("test_pool_all.bin", Delays{0, 0, 0, 0}, 0, false, true);
+        origin.SetTemporaryPool(pool);
+        auto tmp = origin.CreateTemporary(100, 64);
+        auto nested = tmp->CreateTemporary(100, 64);
+        std::size_t files = 0;
+        for (const auto& entry : std::filesystem::directory_iterator("tmp/test_pool_all")) {
+            files += entry.path().filename().string().rfind("compressed", 0) == 0;
+        }
+        EXPECT_EQ(files, 2u);
+    }
+}
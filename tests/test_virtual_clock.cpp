@@ -0,0 +1,115 @@
+#include "external_sort.hpp"
+#include "file_tape.hpp"
+#include "virtual_clock.hpp"
+
+#include "helpers.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <future>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+
+// В режиме virtual_time задержки не выдерживаются, но время лент идёт
+TEST(VirtualClockTest, DelaysAreNotSlept) {
+    const std::string fname = "test_virtual_tape.bin";
+    WriteIntFile(fname, RandomVector(50, 0, 1000));
+
+    VirtualClock::Set(0);
+    FileTape tape(fname, Delays{100, 100, 10, 1000, true});
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < 50; ++i) {
+        tape.Read();
+        tape.Next();
+    }
+    tape.Reset();
+    auto wall = std::chrono::steady_clock::now() - t0;
+
+    // 50 чтений, 49 сдвигов (последний Next не удался), перемотка дешевле сдвигов не бывает
+    EXPECT_EQ(VirtualClock::Now(), 50 * 100u + 49 * 10u + 490u);
+    EXPECT_EQ(tape.Metrics().delay_ms, VirtualClock::Now());
+    EXPECT_LT(wall, std::chrono::seconds(1));
+
+    std::filesystem::remove(fname);
+}
+
+// Ленты в разных потоках работают одновременно, лента в одном потоке - последовательно
+TEST(VirtualClockTest, ParallelTapesOverlap) {
+    const std::string first_name = "test_virtual_first.bin";
+    const std::string second_name = "test_virtual_second.bin";
+    WriteIntFile(first_name, RandomVector(10, 0, 1000));
+    WriteIntFile(second_name, RandomVector(10, 0, 1000));
+
+    FileTape first(first_name, Delays{5, 5, 0, 0, true});
+    FileTape second(second_name, Delays{7, 7, 0, 0, true});
+    std::vector<int32_t> block(10);
+
+    VirtualClock::Set(100);
+    auto readAll = [&block](Tape& tape, std::size_t start) {
+        VirtualClock::Set(start);
+        tape.ReadBlock(block.data(), block.size());
+        return VirtualClock::Now();
+    };
+    auto a = std::async(std::launch::async, readAll, std::ref(first), VirtualClock::Now());
+    auto b = std::async(std::launch::async, readAll, std::ref(second), VirtualClock::Now());
+    std::size_t a_end = a.get();
+    std::size_t b_end = b.get();
+    EXPECT_EQ(a_end, 150u);
+    EXPECT_EQ(b_end, 170u);
+
+    VirtualClock::AdvanceTo(a_end);
+    VirtualClock::AdvanceTo(b_end);
+    EXPECT_EQ(VirtualClock::Now(), 170u);
+
+    // Дальше обе ленты - в этом потоке: их операции складываются
+    first.Reset();
+    second.Reset();
+    first.Read();
+    second.Read();
+    EXPECT_EQ(VirtualClock::Now(), 182u);
+
+    std::filesystem::remove(first_name);
+    std::filesystem::remove(second_name);
+}
+
+// В один поток время сортировки - сумма задержек всех лент,
+// при параллельном слиянии проходы лент перекрываются
+TEST(VirtualClockTest, ParallelSortTakesLessVirtualTime) {
+    std::filesystem::create_directory("tmp");
+    std::vector<int32_t> data = RandomVector(20000, -100000, 100000);
+
+    std::size_t elapsed[2];
+    std::size_t tapes_total[2];
+    std::size_t threads[2] = {1, 4};
+    for (int i = 0; i < 2; ++i) {
+        const std::string in_name = "test_virtual_sort_in.bin";
+        const std::string out_name = "test_virtual_sort_out.bin";
+        WriteIntFile(in_name, data);
+        WriteIntFile(out_name, std::vector<int32_t>(data.size(), 0));
+
+        Delays delays{1, 1, 0, 10, true};
+        FileTape input(in_name, delays);
+        FileTape output(out_name, delays);
+
+        VirtualClock::Set(0);
+        ext_sort::ChunkMergeSort(input, output, 16 * 1024, ext_sort::RunFormation::Sort, threads[i]);
+        elapsed[i] = VirtualClock::Now();
+
+        TapeMetrics all = input.Metrics();
+        all += output.Metrics();
+        all += input.TemporaryMetrics();
+        all += output.TemporaryMetrics();
+        tapes_total[i] = all.delay_ms;
+
+        std::filesystem::remove(in_name);
+        std::filesystem::remove(out_name);
+    }
+
+    EXPECT_EQ(elapsed[0], tapes_total[0]);
+    EXPECT_LT(elapsed[1], tapes_total[1]);
+    EXPECT_LT(elapsed[1], elapsed[0]);
+}
@@ -1,28 +1,60 @@
 #include "tape.hpp"
 
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
 #include <vector>
 
 // Простая реализация Tape для тестирования: хранит данные в памяти, игнорирует ограничение по памяти
 class VectorTape : public Tape {
   public:
     VectorTape(const std::vector<int32_t>& init)
-        : data_(init), pos_(0) {}
+        : data_(std::make_shared<std::vector<int32_t>>(init)), pos_(0) {}
 
     std::unique_ptr<Tape> CreateTemporary(std::size_t size, std::size_t) const override {
         return std::make_unique<VectorTape>(std::vector<int32_t>(size, 0));
     }
 
+    // Участок делит данные с исходной лентой
+    std::unique_ptr<Tape> OpenSection(std::size_t first, std::size_t length, std::size_t) override {
+        auto section = std::make_unique<VectorTape>(std::vector<int32_t>());
+        section->data_ = data_;
+        section->base_ = base_ + first;
+        section->length_ = length;
+        section->is_section_ = true;
+        return section;
+    }
+
+    bool SupportsSections() const override { return true; }
+
     int32_t Read() override {
-        return data_.at(pos_);
+        if (pos_ >= size()) {
+            throw std::out_of_range("VectorTape read out of range");
+        }
+        return (*data_)[base_ + pos_];
     }
 
     void Write(int32_t value) override {
-        if (pos_ >= data_.size()) data_.resize(pos_ + 1);
-        data_[pos_] = value;
+        if (!is_section_ && pos_ >= data_->size()) data_->resize(pos_ + 1);
+        (*data_)[base_ + pos_] = value;
+    }
+
+    std::size_t ReadBlock(int32_t* out, std::size_t n) override {
+        n = std::min(n, size() - std::min(pos_, size()));
+        std::copy_n(data_->begin() + base_ + pos_, n, out);
+        pos_ += n;
+        return n;
+    }
+
+    std::size_t WriteBlock(const int32_t* in, std::size_t n) override {
+        n = std::min(n, size() - std::min(pos_, size()));
+        std::copy_n(in, n, data_->begin() + base_ + pos_);
+        pos_ += n;
+        return n;
     }
 
     bool Next() override {
-        if (pos_ + 1 > data_.size()) {
+        if (pos_ + 1 > size()) {
             return false;
         }
         ++pos_;
@@ -39,18 +71,23 @@ class VectorTape : public Tape {
 
     bool Rewind(std::ptrdiff_t offset) override {
         auto new_pos = static_cast<std::ptrdiff_t>(pos_) + offset;
-        if (new_pos < 0 || static_cast<std::size_t>(new_pos) > data_.size()) {
+        if (new_pos < 0 || static_cast<std::size_t>(new_pos) > size()) {
             return false;
         }
         pos_ = static_cast<std::size_t>(new_pos);
         return true;
     }
 
-    std::size_t Size() const override { return data_.size(); }
+    std::size_t Size() const override { return size(); }
     std::size_t Position() const override { return pos_; }
     void SetMemoryLimit(std::size_t /*bytes*/) override {}
 
 private:
-    std::vector<int32_t> data_;
+    std::size_t size() const { return is_section_ ? length_ : data_->size(); }
+
+    std::shared_ptr<std::vector<int32_t>> data_;
     std::size_t pos_;
-};
\ No newline at end of file
+    std::size_t base_ = 0;
+    std::size_t length_ = 0;
+    bool is_section_ = false;
+};